@@ -31,6 +31,10 @@ class AbstractSampleSource
 public:
     virtual ~AbstractSampleSource() {};
     virtual std::type_index sampleType() = 0;
+    // File samples per sample of this source: 1 unless a decimating stage
+    // (TunerDecimator) sits upstream. PlotView's ranges are in file samples;
+    // Plot::sourceRange() maps them onto a source with this.
+    virtual size_t decimation() { return 1; }
     void subscribe(Subscriber *subscriber);
     int subscriberCount();
     void unsubscribe(Subscriber *subscriber);
@@ -0,0 +1,270 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "disktilecache.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char kTileMagic[4] = { 'I', 'T', 'I', 'L' };
+const uint32_t kTileVersion = 2;   // 2: int16 dB (sampleconvert::kDbStep)
+const qint64 kHeaderBytes = 4 + sizeof(uint32_t) + sizeof(uint64_t);
+const qint64 kDefaultBudgetMB = 2048;
+
+} // namespace
+
+DiskTileCache &DiskTileCache::instance()
+{
+    static DiskTileCache cache;
+    return cache;
+}
+
+DiskTileCache::DiskTileCache()
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty())
+        base = QDir::tempPath();
+    root_ = base + "/tiles";
+    QSettings settings;
+    budget_ = settings.value("DiskTileCacheMB", kDefaultBudgetMB).toLongLong() << 20;
+    scanThread_ = std::thread([this]() { scan(); });
+}
+
+DiskTileCache::~DiskTileCache()
+{
+    cancel_.store(true, std::memory_order_release);
+    if (scanThread_.joinable())
+        scanThread_.join();
+}
+
+QString DiskTileCache::pathFor(const QString &name) const
+{
+    return root_ + "/" + name;
+}
+
+void DiskTileCache::scan()
+{
+    // Seed the LRU from what previous sessions left behind, most recently
+    // used (latest mtime) first. The walk runs without the lock; tiles put
+    // or hit meanwhile are already indexed at the front and keep their place.
+    struct Found {
+        qint64 mtime;
+        Entry entry;
+    };
+    std::vector<Found> found;
+    QDirIterator it(root_, QStringList() << "*.tile", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        if (cancel_.load(std::memory_order_acquire))
+            return;
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const QString name = QDir(root_).relativeFilePath(info.filePath());
+        found.push_back({ info.lastModified().toMSecsSinceEpoch(), { name, info.size() } });
+    }
+    std::sort(found.begin(), found.end(),
+              [](const Found &a, const Found &b) { return a.mtime > b.mtime; });
+
+    std::vector<QString> victims;
+    {
+        QMutexLocker lock(&mutex_);
+        for (auto &f : found) {
+            const std::string key = f.entry.name.toStdString();
+            if (index_.find(key) != index_.end())
+                continue;
+            usage_ += f.entry.bytes;
+            lru_.push_back(std::move(f.entry));
+            index_[key] = std::prev(lru_.end());
+        }
+        scanned_ = true;
+        // A disabled cache (budget 0) leaves what's on disk alone until it's
+        // re-enabled with a budget to evict against.
+        if (budget_ > 0)
+            victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+void DiskTileCache::touchLocked(const QString &name)
+{
+    auto it = index_.find(name.toStdString());
+    if (it != index_.end())
+        lru_.splice(lru_.begin(), lru_, it->second);
+}
+
+void DiskTileCache::forgetLocked(const QString &name)
+{
+    auto it = index_.find(name.toStdString());
+    if (it == index_.end())
+        return;
+    usage_ -= it->second->bytes;
+    lru_.erase(it->second);
+    index_.erase(it);
+}
+
+std::vector<QString> DiskTileCache::evictLocked()
+{
+    std::vector<QString> victims;
+    while (usage_ > budget_ && !lru_.empty()) {
+        const Entry &victim = lru_.back();
+        victims.push_back(pathFor(victim.name));
+        usage_ -= victim.bytes;
+        index_.erase(victim.name.toStdString());
+        lru_.pop_back();
+    }
+    return victims;
+}
+
+void DiskTileCache::removeFiles(const std::vector<QString> &paths)
+{
+    for (const QString &path : paths)
+        QFile::remove(path);
+}
+
+bool DiskTileCache::get(const QString &name, int16_t *dest, size_t count)
+{
+    {
+        QMutexLocker lock(&mutex_);
+        if (budget_ <= 0)
+            return false;
+        // Before the startup scan is in, a tile from an earlier session may
+        // be on disk without being indexed yet, so only try the file.
+        if (scanned_ && index_.find(name.toStdString()) == index_.end())
+            return false;
+    }
+
+    QFile f(pathFor(name));
+    bool ok = f.open(QIODevice::ReadOnly);
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t stored = 0;
+    const qint64 bytes = static_cast<qint64>(count * sizeof(int16_t));
+    ok = ok && f.read(magic, 4) == 4 && memcmp(magic, kTileMagic, 4) == 0 &&
+         f.read(reinterpret_cast<char*>(&version), sizeof(version)) == sizeof(version) &&
+         version == kTileVersion &&
+         f.read(reinterpret_cast<char*>(&stored), sizeof(stored)) == sizeof(stored) &&
+         stored == count &&
+         f.read(reinterpret_cast<char*>(dest), bytes) == bytes;
+    if (ok) {
+        // Carry the recency over to the next session's scan.
+        f.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    } else if (f.isOpen()) {
+        // Truncated, or from another version.
+        f.close();
+        QFile::remove(pathFor(name));
+    }
+
+    std::vector<QString> victims;
+    {
+        QMutexLocker lock(&mutex_);
+        if (!ok) {
+            forgetLocked(name);
+            return false;
+        }
+        if (index_.find(name.toStdString()) != index_.end()) {
+            touchLocked(name);
+            return true;
+        }
+        // A hit the startup scan hasn't indexed yet; the scan skips it.
+        lru_.push_front({ name, kHeaderBytes + bytes });
+        index_[name.toStdString()] = lru_.begin();
+        usage_ += kHeaderBytes + bytes;
+        victims = evictLocked();
+    }
+    removeFiles(victims);
+    return true;
+}
+
+void DiskTileCache::put(const QString &name, const int16_t *src, size_t count)
+{
+    {
+        QMutexLocker lock(&mutex_);
+        if (budget_ <= 0)
+            return;
+        if (index_.find(name.toStdString()) != index_.end())
+            return;
+    }
+
+    const QString path = pathFor(name);
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return;
+    const uint64_t stored = count;
+    const qint64 bytes = static_cast<qint64>(count * sizeof(int16_t));
+    f.write(kTileMagic, 4);
+    f.write(reinterpret_cast<const char*>(&kTileVersion), sizeof(kTileVersion));
+    f.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+    f.write(reinterpret_cast<const char*>(src), bytes);
+    if (!f.commit()) {
+        // Best effort: a full disk just means this tile is recomputed later.
+        qDebug() << "tile cache: could not write" << path << f.errorString();
+        return;
+    }
+
+    std::vector<QString> victims;
+    {
+        QMutexLocker lock(&mutex_);
+        if (index_.find(name.toStdString()) != index_.end())
+            return;   // another worker stored the same tile meanwhile
+        lru_.push_front({ name, kHeaderBytes + bytes });
+        index_[name.toStdString()] = lru_.begin();
+        usage_ += kHeaderBytes + bytes;
+        victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+void DiskTileCache::setBudget(qint64 bytes)
+{
+    std::vector<QString> victims;
+    {
+        QMutexLocker lock(&mutex_);
+        budget_ = std::max<qint64>(0, bytes);
+        // Before the scan, usage only covers this session's tiles; the scan
+        // evicts against the new budget when it merges.
+        if (scanned_)
+            victims = evictLocked();
+    }
+    removeFiles(victims);
+}
+
+qint64 DiskTileCache::budget() const
+{
+    QMutexLocker lock(&mutex_);
+    return budget_;
+}
+
+qint64 DiskTileCache::usage() const
+{
+    QMutexLocker lock(&mutex_);
+    return usage_;
+}
@@ -0,0 +1,95 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Second-level, on-disk cache of spectrogram tiles, in the same packed
+// 16-bit dB format as fftCache.
+//
+// SpectrogramPlot's fftCache/imageCache are in-memory and die with every
+// invalidateEvent and every restart, so reopening a capture used to pay the
+// full FFT cost again. Computed tiles are also written here, one file per
+// tile under the app cache dir, named by the caller from the source's
+// content key plus the full TileCacheKey — so a changed file, format or
+// render setting simply never matches its old tiles, which age out.
+//
+// The total size is held under a byte budget with LRU eviction. Recency is
+// tracked in memory for the session and carried across sessions through
+// the files' mtimes (bumped on every hit), which seed the order on startup.
+// That seeding walks the whole cache directory, so it runs on a thread of
+// its own; until it's merged in, a lookup that isn't indexed yet just tries
+// the file.
+//
+// get()/put() are thread-safe and meant to be called from tile workers;
+// file I/O (including eviction's deletes) runs outside the index lock.
+class DiskTileCache
+{
+public:
+    static DiskTileCache &instance();
+
+    // Copy a cached tile of exactly `count` values into dest. False on a miss
+    // (or a damaged/short file, which is dropped).
+    bool get(const QString &name, int16_t *dest, size_t count);
+    // Store a tile, evicting least-recently-used tiles to stay within budget.
+    void put(const QString &name, const int16_t *src, size_t count);
+
+    // Byte budget for the whole cache. Defaults to the "DiskTileCacheMB"
+    // setting (2 GB, "Tile disk cache" in the dock); 0 disables the cache.
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+    qint64 usage() const;
+
+private:
+    struct Entry {
+        QString name;
+        qint64 bytes;
+    };
+
+    DiskTileCache();
+    ~DiskTileCache();
+    QString pathFor(const QString &name) const;
+    void scan();
+    void touchLocked(const QString &name);
+    // Drop least-recently-used entries until usage fits the budget and
+    // return their paths, for the caller to delete once it has unlocked.
+    std::vector<QString> evictLocked();
+    static void removeFiles(const std::vector<QString> &paths);
+    void forgetLocked(const QString &name);
+
+    QString root_;
+    std::atomic<bool> cancel_{false};
+    std::thread scanThread_;
+    mutable QMutex mutex_;                        // guards everything below
+    bool scanned_ = false;                        // startup scan merged in
+    qint64 budget_ = 0;
+    qint64 usage_ = 0;
+    std::list<Entry> lru_;                        // front = most-recently-used
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
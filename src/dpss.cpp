@@ -0,0 +1,145 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "dpss.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Bisection steps per eigenvalue: the Gershgorin interval is ~size²/2
+// wide, and 64 halvings take that well below double resolution.
+const int kBisectionSteps = 64;
+const int kInverseIterations = 3;
+const double kTinyPivot = 1e-300;
+
+// Symmetric tridiagonal matrix: diag[n], and off[n] coupling n - 1 and n
+// (off[0] unused).
+struct Tridiagonal {
+    std::vector<double> diag;
+    std::vector<double> off;
+};
+
+// Number of eigenvalues of t below x.
+int countBelow(const Tridiagonal &t, double x)
+{
+    int count = 0;
+    double q = 1.0;
+    for (size_t n = 0; n < t.diag.size(); n++) {
+        q = t.diag[n] - x - (n > 0 ? t.off[n] * t.off[n] / q : 0.0);
+        if (q == 0.0)
+            q = -kTinyPivot;
+        if (q < 0.0)
+            count++;
+    }
+    return count;
+}
+
+// Solve (t - lambda·I) x = b, overwriting b with x (Thomas algorithm).
+// Near-zero pivots are nudged rather than refused: inverse iteration
+// wants the huge solution they give.
+void solveShifted(const Tridiagonal &t, double lambda, std::vector<double> &b,
+                  std::vector<double> &upper)
+{
+    const size_t n = t.diag.size();
+    upper.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        double pivot = t.diag[i] - lambda;
+        if (i > 0) {
+            pivot -= t.off[i] * upper[i - 1];
+            b[i] -= t.off[i] * b[i - 1];
+        }
+        if (std::abs(pivot) < kTinyPivot)
+            pivot = kTinyPivot;
+        upper[i] = (i + 1 < n) ? t.off[i + 1] / pivot : 0.0;
+        b[i] /= pivot;
+    }
+    for (size_t i = n - 1; i-- > 0;)
+        b[i] -= upper[i] * b[i + 1];
+}
+
+void normalise(std::vector<double> &v)
+{
+    double energy = 0.0;
+    for (double x : v)
+        energy += x * x;
+    const double scale = energy > 0.0 ? 1.0 / std::sqrt(energy) : 0.0;
+    for (double &x : v)
+        x *= scale;
+}
+
+} // namespace
+
+std::vector<float> dpssTapers(int size, int count, double nw)
+{
+    std::vector<float> tapers;
+    if (size <= 0 || count <= 0)
+        return tapers;
+    count = std::min(count, size);
+    tapers.resize(static_cast<size_t>(size) * count);
+
+    const double w = nw / size;
+    const double cosW = std::cos(2.0 * M_PI * w);
+    Tridiagonal t;
+    t.diag.resize(size);
+    t.off.assign(size, 0.0);
+    for (int n = 0; n < size; n++) {
+        const double c = (size - 1 - 2.0 * n) / 2.0;
+        t.diag[n] = c * c * cosW;
+        if (n > 0)
+            t.off[n] = n * static_cast<double>(size - n) / 2.0;
+    }
+
+    // Gershgorin bounds on the spectrum.
+    double lo = t.diag[0], hi = t.diag[0];
+    for (int n = 0; n < size; n++) {
+        const double r = t.off[n] + (n + 1 < size ? t.off[n + 1] : 0.0);
+        lo = std::min(lo, t.diag[n] - r);
+        hi = std::max(hi, t.diag[n] + r);
+    }
+
+    std::vector<double> v(size), upper;
+    for (int k = 0; k < count; k++) {
+        // The k-th largest eigenvalue is the (size - 1 - k)-th from the
+        // bottom: the point where countBelow steps past that index.
+        const int index = size - 1 - k;
+        double a = lo, b = hi;
+        for (int step = 0; step < kBisectionSteps; step++) {
+            const double mid = 0.5 * (a + b);
+            if (countBelow(t, mid) > index)
+                b = mid;
+            else
+                a = mid;
+        }
+        const double lambda = 0.5 * (a + b);
+
+        // Any start vector with a component along the wanted eigenvector
+        // converges; a fixed irregular one has both symmetries.
+        for (int n = 0; n < size; n++)
+            v[n] = 1.0 + 0.5 * std::sin(0.7 * n + k);
+        for (int it = 0; it < kInverseIterations; it++) {
+            solveShifted(t, lambda, v, upper);
+            normalise(v);
+        }
+        std::copy(v.begin(), v.end(), tapers.begin() + static_cast<size_t>(k) * size);
+    }
+    return tapers;
+}
@@ -0,0 +1,36 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <vector>
+
+// Discrete prolate spheroidal (Slepian) sequences for multitaper spectra.
+//
+// Returns the first `count` tapers of length `size` with time-bandwidth
+// product `nw` (half-bandwidth nw/size cycles per sample), back to back,
+// each scaled to unit energy. Taper k is the eigenvector of the k-th
+// largest eigenvalue of the tridiagonal matrix that commutes with the
+// concentration problem (Percival & Walden, "Spectral Analysis for
+// Physical Applications", §8.3): eigenvalues by Sturm-sequence bisection,
+// vectors by inverse iteration, so O(count · size) rather than a full
+// eigendecomposition. The sign of each taper is arbitrary; the spectrogram
+// only uses |X|².
+std::vector<float> dpssTapers(int size, int count, double nw);
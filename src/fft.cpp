@@ -20,25 +20,216 @@
 #include "fft.h"
 #include "string.h"
 
-FFT::FFT(int size)
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+std::mutex plannerMutex;
+// The longest planForWisdom holds plannerMutex at a stretch.
+const double kPlanSliceSeconds = 0.05;
+std::atomic<int> planLevel{ static_cast<int>(FFTPlanLevel::Measure) };
+std::function<void(const FFTPlanShape &)> missHandler;   // guarded by plannerMutex
+
+unsigned levelFlags(FFTPlanLevel level)
+{
+    switch (level) {
+    case FFTPlanLevel::Estimate: return FFTW_ESTIMATE;
+    case FFTPlanLevel::Measure:  return FFTW_MEASURE;
+    case FFTPlanLevel::Patient:  return FFTW_PATIENT;
+    }
+    return FFTW_ESTIMATE;
+}
+
+// `make(flags)` creates the plan on the caller's buffers.
+fftwf_plan makePlan(const FFTPlanShape &shape, const std::function<fftwf_plan(unsigned)> &make)
+{
+    std::function<void(const FFTPlanShape &)> report;
+    fftwf_plan plan;
+    {
+        std::lock_guard<std::mutex> lock(plannerMutex);
+        const FFTPlanLevel level = fftplan::level();
+        if (level == FFTPlanLevel::Estimate)
+            return make(FFTW_ESTIMATE);
+        plan = make(levelFlags(level) | FFTW_WISDOM_ONLY);
+        if (!plan && missHandler) {
+            plan = make(FFTW_ESTIMATE);
+            report = missHandler;
+        } else if (!plan) {
+            plan = make(levelFlags(level));
+        }
+    }
+    if (report)
+        report(shape);
+    return plan;
+}
+
+void destroyPlan(fftwf_plan plan)
+{
+    if (!plan) return;
+    std::lock_guard<std::mutex> lock(plannerMutex);
+    fftwf_destroy_plan(plan);
+}
+
+fftwf_plan planC2C(int size, int batch, fftwf_complex *in, fftwf_complex *out, unsigned flags)
+{
+    if (batch == 1)
+        return fftwf_plan_dft_1d(size, in, out, FFTW_FORWARD, flags);
+    // Frames are packed back to back: unit stride within a frame,
+    // size between frames.
+    int n[] = { size };
+    return fftwf_plan_many_dft(1, n, batch, in, nullptr, 1, size,
+                               out, nullptr, 1, size, FFTW_FORWARD, flags);
+}
+
+fftwf_plan planR2C(int size, int batch, float *in, fftwf_complex *out, unsigned flags)
+{
+    const int bins = size / 2 + 1;
+    int n[] = { size };
+    return fftwf_plan_many_dft_r2c(1, n, batch, in, nullptr, 1, size,
+                                   out, nullptr, 1, bins, flags);
+}
+
+} // namespace
+
+namespace fftplan {
+
+void setLevel(FFTPlanLevel level)
+{
+    planLevel.store(static_cast<int>(level));
+}
+
+FFTPlanLevel level()
+{
+    return static_cast<FFTPlanLevel>(planLevel.load());
+}
+
+void setMissHandler(std::function<void(const FFTPlanShape &)> handler)
+{
+    std::lock_guard<std::mutex> lock(plannerMutex);
+    missHandler = std::move(handler);
+}
+
+void planForWisdom(const FFTPlanShape &shape, FFTPlanLevel level, double timeLimit)
+{
+    // FFTW's planner isn't reentrant, so planning holds plannerMutex, and
+    // every FFT the app builds (on the GUI thread too) waits on that lock.
+    // A Measure or Patient plan of a tile-sized batch can take seconds, so
+    // it runs in kPlanSliceSeconds slices with the lock dropped in between.
+    // A slice that runs out of time still leaves wisdom for the sub-problems
+    // it finished, which the next slice starts from; the shape is done once
+    // its plan can be made from wisdom alone, or when `timeLimit` runs out.
+    const size_t total = static_cast<size_t>(shape.size) * shape.batch;
+    void *in = fftwf_malloc(sizeof(fftwf_complex) * total);
+    void *out = fftwf_malloc(sizeof(fftwf_complex) * total);
+    auto plan = [&](unsigned flags) {
+        return shape.real
+            ? planR2C(shape.size, shape.batch, static_cast<float*>(in),
+                      static_cast<fftwf_complex*>(out), flags)
+            : planC2C(shape.size, shape.batch, static_cast<fftwf_complex*>(in),
+                      static_cast<fftwf_complex*>(out), flags);
+    };
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::duration<double>(timeLimit > 0 ? timeLimit : 1e9);
+    for (;;) {
+        bool done;
+        {
+            std::lock_guard<std::mutex> lock(plannerMutex);
+            fftwf_set_timelimit(kPlanSliceSeconds);
+            if (fftwf_plan p = plan(levelFlags(level)))
+                fftwf_destroy_plan(p);
+            fftwf_set_timelimit(FFTW_NO_TIMELIMIT);
+            fftwf_plan wise = plan(levelFlags(level) | FFTW_WISDOM_ONLY);
+            done = wise != nullptr;
+            if (wise)
+                fftwf_destroy_plan(wise);
+        }
+        if (done || std::chrono::steady_clock::now() >= deadline)
+            break;
+        // std::mutex isn't fair: give a waiting makePlan the chance to take
+        // the lock before the next slice does.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    fftwf_free(in);
+    fftwf_free(out);
+}
+
+std::string exportWisdom()
+{
+    std::lock_guard<std::mutex> lock(plannerMutex);
+    char *text = fftwf_export_wisdom_to_string();
+    if (!text)
+        return std::string();
+    std::string wisdom(text);
+    free(text);
+    return wisdom;
+}
+
+bool importWisdom(const std::string &wisdom)
+{
+    std::lock_guard<std::mutex> lock(plannerMutex);
+    return fftwf_import_wisdom_from_string(wisdom.c_str()) != 0;
+}
+
+} // namespace fftplan
+
+FFT::FFT(int size, int batch)
 {
     fftSize = size;
+    batchCount = batch;
 
-    fftwIn = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
-    fftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * fftSize);
-    fftwPlan = fftwf_plan_dft_1d(fftSize, fftwIn, fftwOut, FFTW_FORWARD, FFTW_MEASURE);
+    const size_t total = static_cast<size_t>(fftSize) * batchCount;
+    fftwIn = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * total);
+    fftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * total);
+    fftwPlan = makePlan({ false, fftSize, batchCount }, [this](unsigned flags) {
+        return planC2C(fftSize, batchCount, fftwIn, fftwOut, flags);
+    });
 }
 
 FFT::~FFT()
 {
-    if (fftwPlan) fftwf_destroy_plan(fftwPlan);
+    destroyPlan(fftwPlan);
     if (fftwIn) fftwf_free(fftwIn);
     if (fftwOut) fftwf_free(fftwOut);
 }
 
 void FFT::process(void *dest, void *source)
 {
-    memcpy(fftwIn, source, fftSize * sizeof(fftwf_complex));
+    const size_t bytes = static_cast<size_t>(fftSize) * batchCount * sizeof(fftwf_complex);
+    memcpy(fftwIn, source, bytes);
+    fftwf_execute(fftwPlan);
+    memcpy(dest, fftwOut, bytes);
+}
+
+void FFT::execute()
+{
+    fftwf_execute(fftwPlan);
+}
+
+RealFFT::RealFFT(int size, int batch)
+{
+    fftSize = size;
+    batchCount = batch;
+
+    const int bins = getBins();
+    fftwIn = (float*)fftwf_malloc(sizeof(float) * static_cast<size_t>(fftSize) * batchCount);
+    fftwOut = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * static_cast<size_t>(bins) * batchCount);
+    fftwPlan = makePlan({ true, fftSize, batchCount }, [this](unsigned flags) {
+        return planR2C(fftSize, batchCount, fftwIn, fftwOut, flags);
+    });
+}
+
+RealFFT::~RealFFT()
+{
+    destroyPlan(fftwPlan);
+    if (fftwIn) fftwf_free(fftwIn);
+    if (fftwOut) fftwf_free(fftwOut);
+}
+
+void RealFFT::execute()
+{
     fftwf_execute(fftwPlan);
-    memcpy(dest, fftwOut, fftSize * sizeof(fftwf_complex));
 }
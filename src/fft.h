@@ -20,20 +20,109 @@
 #pragma once
 
 #include <fftw3.h>
+#include <functional>
+#include <string>
+
+// How hard FFTW searches for a fast plan. Estimate is instant; Measure and
+// Patient time candidate algorithms and can take from milliseconds to
+// seconds per shape, which is why the app only runs them in the background
+// (see FFTWisdom) and builds its own plans from the resulting wisdom.
+enum class FFTPlanLevel {
+    Estimate = 0,
+    Measure,
+    Patient,
+};
+
+// One transform shape, as FFTW's wisdom keys it.
+struct FFTPlanShape {
+    bool real;    // r2c rather than c2c
+    int size;
+    int batch;
+};
+
+// Process-wide planning policy for FFT and RealFFT. FFTW's planner and
+// wisdom aren't thread-safe, so every plan create/destroy in the app goes
+// through one lock in here; execute stays lock-free.
+//
+// A new plan comes from wisdom at level() or better if there is some. If
+// not, and a miss handler is installed, it's planned FFTW_ESTIMATE (never
+// stalls) and the shape is reported so a background planner can produce
+// the wisdom for next time. With no handler (the tools) it's planned at
+// level() on the spot.
+namespace fftplan {
+
+void setLevel(FFTPlanLevel level);
+FFTPlanLevel level();
+// Called (outside the planner lock, on the planning thread) for every
+// shape that had to fall back to FFTW_ESTIMATE.
+void setMissHandler(std::function<void(const FFTPlanShape &)> handler);
+// Plan `shape` at `level` on scratch buffers purely for the wisdom it
+// leaves behind, bounded by `timeLimit` seconds (<= 0 for none). Plans in
+// short slices so other planners wait at most one slice for the lock.
+void planForWisdom(const FFTPlanShape &shape, FFTPlanLevel level, double timeLimit);
+std::string exportWisdom();
+bool importWisdom(const std::string &wisdom);
+
+} // namespace fftplan
 
 class FFT
 {
 public:
-    FFT(int size);
+    // `batch` > 1 plans that many contiguous size-point transforms as one
+    // fftwf_plan_many_dft, so a whole spectrogram tile costs one execute
+    // instead of one per column. tools/fft_batch_bench compares the two.
+    FFT(int size, int batch = 1);
     ~FFT();
     void process(void *dest, void *source);
+    // Batched use: fill input() with getBatch() frames of getSize() samples
+    // back to back, execute(), then read output() in the same layout. Saves
+    // process()'s two copies. Like process(), safe to call concurrently on
+    // different FFT objects.
+    fftwf_complex *input() { return fftwIn; }
+    const fftwf_complex *output() const { return fftwOut; }
+    void execute();
     int getSize() {
         return fftSize;
     }
+    int getBatch() const {
+        return batchCount;
+    }
 
 private:
     int fftSize;
+    int batchCount;
     fftwf_complex *fftwIn = nullptr;
     fftwf_complex *fftwOut = nullptr;
     fftwf_plan fftwPlan = nullptr;
 };
+
+// Real-input counterpart of FFT: `batch` frames of `size` real samples in,
+// size/2 + 1 complex bins per frame out (the rest are the conjugate mirror).
+// Half the arithmetic and half the input bandwidth of the c2c transform for
+// real-valued captures.
+class RealFFT
+{
+public:
+    RealFFT(int size, int batch = 1);
+    ~RealFFT();
+    float *input() { return fftwIn; }
+    const fftwf_complex *output() const { return fftwOut; }
+    void execute();
+    int getSize() const {
+        return fftSize;
+    }
+    int getBatch() const {
+        return batchCount;
+    }
+    // Complex bins per frame in output().
+    int getBins() const {
+        return fftSize / 2 + 1;
+    }
+
+private:
+    int fftSize;
+    int batchCount;
+    float *fftwIn = nullptr;
+    fftwf_complex *fftwOut = nullptr;
+    fftwf_plan fftwPlan = nullptr;
+};
@@ -0,0 +1,160 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fftwisdom.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <algorithm>
+
+namespace {
+
+// Upper bound on one background plan. Patient planning of a tile-sized
+// batch can otherwise run for a long time, and quitting waits for it.
+const double kPlanTimeLimit = 5.0;
+
+bool sameShape(const FFTPlanShape &a, const FFTPlanShape &b)
+{
+    return a.real == b.real && a.size == b.size && a.batch == b.batch;
+}
+
+} // namespace
+
+FFTWisdom &FFTWisdom::instance()
+{
+    static FFTWisdom wisdom;
+    return wisdom;
+}
+
+FFTWisdom::FFTWisdom()
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::AppConfigLocation);
+    if (base.isEmpty())
+        base = QDir::tempPath();
+    path_ = base + "/fftw-wisdom";
+
+    QFile f(path_);
+    if (f.open(QIODevice::ReadOnly)) {
+        if (!fftplan::importWisdom(f.readAll().toStdString()))
+            qDebug() << "fftw: ignoring unreadable wisdom" << path_;
+    }
+
+    QSettings settings;
+    const int stored = settings.value("FFTPlanningLevel", static_cast<int>(FFTPlanLevel::Measure)).toInt();
+    level_ = static_cast<FFTPlanLevel>(std::max(0, std::min(stored, static_cast<int>(FFTPlanLevel::Patient))));
+    fftplan::setLevel(level_);
+    fftplan::setMissHandler([this](const FFTPlanShape &shape) { enqueue(shape); });
+
+    thread_ = std::thread([this]() { run(); });
+}
+
+FFTWisdom::~FFTWisdom()
+{
+    fftplan::setMissHandler(nullptr);
+    stop_ = true;
+    wake_.notify_all();
+    if (thread_.joinable())
+        thread_.join();
+}
+
+void FFTWisdom::setLevel(FFTPlanLevel level)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        if (level == level_)
+            return;
+        level_ = level;
+        fftplan::setLevel(level);
+        // Everything in use this session is worth having at the new level.
+        queue_.clear();
+        if (level != FFTPlanLevel::Estimate)
+            queue_.insert(queue_.end(), seen_.begin(), seen_.end());
+    }
+    wake_.notify_all();
+    emit wisdomUpdated();
+}
+
+FFTPlanLevel FFTWisdom::level() const
+{
+    return fftplan::level();
+}
+
+void FFTWisdom::enqueue(const FFTPlanShape &shape)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        auto same = [&](const FFTPlanShape &s) { return sameShape(s, shape); };
+        if (std::find_if(seen_.begin(), seen_.end(), same) != seen_.end())
+            return;   // queued or planned already; don't replan on every rebuild
+        seen_.push_back(shape);
+        queue_.push_back(shape);
+    }
+    wake_.notify_all();
+}
+
+void FFTWisdom::run()
+{
+    for (;;) {
+        FFTPlanShape shape;
+        FFTPlanLevel level;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex_);
+            wake_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+            if (stop_)
+                return;
+            shape = queue_.front();
+            queue_.pop_front();
+            level = level_;
+        }
+        fftplan::planForWisdom(shape, level, kPlanTimeLimit);
+        if (stop_)
+            return;
+        save();
+
+        // Let the plots rebuild once per burst rather than once per shape.
+        bool drained;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            drained = queue_.empty();
+        }
+        if (drained)
+            emit wisdomUpdated();
+    }
+}
+
+void FFTWisdom::save()
+{
+    QMutexLocker lock(&saveMutex_);
+    const std::string wisdom = fftplan::exportWisdom();
+    if (wisdom.empty())
+        return;
+    QDir().mkpath(QFileInfo(path_).path());
+    QSaveFile f(path_);
+    if (!f.open(QIODevice::WriteOnly))
+        return;
+    f.write(wisdom.data(), static_cast<qint64>(wisdom.size()));
+    if (!f.commit())
+        qDebug() << "fftw: could not write wisdom" << path_ << f.errorString();
+}
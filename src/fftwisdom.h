@@ -0,0 +1,80 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "fft.h"
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// FFTW wisdom that persists across sessions, and the background planner
+// that produces it.
+//
+// Building a plan FFTW_MEASURE / FFTW_PATIENT on the GUI thread stalls
+// every FFT size change and work-set rebuild, so FFT planning is split
+// (see fftplan in fft.h): plans the app builds come from wisdom when there
+// is some and are FFTW_ESTIMATE otherwise, and every shape that missed is
+// queued here to be planned properly on a worker thread. The result goes
+// to <config dir>/fftw-wisdom straight away, and wisdomUpdated() tells the
+// plots to rebuild their plans from it, so a size is only ever slow to plan
+// once per machine and planning level.
+class FFTWisdom : public QObject
+{
+    Q_OBJECT
+
+public:
+    static FFTWisdom &instance();
+    ~FFTWisdom();
+
+    // Planning level for new plans. Defaults to the "FFTPlanningLevel"
+    // setting (Measure). Raising it replans the shapes used this session in
+    // the background; any change emits wisdomUpdated().
+    void setLevel(FFTPlanLevel level);
+    FFTPlanLevel level() const;
+
+signals:
+    // New wisdom (or a new level) is in: plans built before now may be
+    // slower than what a rebuild would get. May be emitted from the
+    // planner thread.
+    void wisdomUpdated();
+
+private:
+    FFTWisdom();
+    void enqueue(const FFTPlanShape &shape);
+    void run();
+    void save();
+
+    QString path_;
+    QMutex saveMutex_;                 // one wisdom write at a time
+
+    std::mutex queueMutex_;            // guards queue_, seen_, level_
+    std::condition_variable wake_;
+    std::deque<FFTPlanShape> queue_;
+    std::vector<FFTPlanShape> seen_;   // every shape planned this session
+    FFTPlanLevel level_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
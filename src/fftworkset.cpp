@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fftworkset.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Sets a thread keeps. Two covers a worker alternating between a plot's
+// old and new generation while jobs queued before a size change drain,
+// without letting dead generations pile up.
+const size_t kSetsPerThread = 2;
+
+struct LocalSet {
+    fftworkset::Key key;
+    std::unique_ptr<FftWorkSet> set;
+};
+
+bool sameKey(const fftworkset::Key &a, const fftworkset::Key &b)
+{
+    return a.generation == b.generation && a.size == b.size &&
+           a.cols == b.cols && a.realInput == b.realInput;
+}
+
+std::unique_ptr<FftWorkSet> build(const fftworkset::Key &key)
+{
+    const int size = key.size;
+    auto set = std::make_unique<FftWorkSet>();
+    set->fftH.reset(new FFT(size));
+    set->fftTile.reset(new FFT(size, key.cols));
+    if (key.realInput)
+        set->fftTileReal.reset(new RealFFT(size, key.cols));
+    set->bufH.resize(size);
+    set->outH.resize(size);
+    set->size = size;
+    return set;
+}
+
+} // namespace
+
+uint64_t fftworkset::newGeneration()
+{
+    static std::atomic<uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+FftWorkSet &fftworkset::local(const Key &key)
+{
+    // Most recently used first.
+    thread_local std::vector<LocalSet> sets;
+    for (size_t i = 0; i < sets.size(); i++) {
+        if (!sameKey(sets[i].key, key))
+            continue;
+        std::rotate(sets.begin(), sets.begin() + i, sets.begin() + i + 1);
+        return *sets[0].set;
+    }
+    if (sets.size() >= kSetsPerThread)
+        sets.pop_back();
+    sets.insert(sets.begin(), LocalSet{key, build(key)});
+    return *sets[0].set;
+}
@@ -0,0 +1,79 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "fft.h"
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// FFT plans + scratch buffers used by the spectrogram tile computes.
+// Each FFTW plan owns its in/out buffers, so tiles computing in parallel
+// need one of these each.
+struct FftWorkSet {
+    std::unique_ptr<FFT> fftH;
+    std::unique_ptr<FFT> fftTile;   // batched: one plan over a tile's columns
+    // Batched r2c plan, only built for real-valued inputs.
+    std::unique_ptr<RealFFT> fftTileReal;
+    std::vector<std::complex<float>> bufH, outH;
+    // Reassigned tiles: the h, t·h and h' frames of a block of columns as
+    // one batched plan, and the per-bin power and offsets of that block.
+    // Built on the first reassigned tile, since most sets never see one.
+    std::unique_ptr<FFT> fftReassign;
+    std::vector<float> splatPower, splatCol, splatBin;
+    // Welch / multitaper tiles: the K frames of each column in a block,
+    // built on first use like fftReassign.
+    std::unique_ptr<FFT> fftAverage;
+    // Linear-power accumulator: cols * fftSize for reassigned and decimated
+    // tiles, one column for averaged ones.
+    std::vector<float> accum;
+    int size = 0;               // FFT size this set was built for
+};
+
+// Work sets owned by the thread that uses them, so tile workers never
+// contend for a shared pool.
+//
+// Each thread keeps the sets it used most recently, keyed by the whole
+// shape plus a generation. An owner (SpectrogramPlot) takes a generation
+// from newGeneration() and takes a fresh one whenever its plans must be
+// rebuilt (FFT size change, new wisdom); sets of an abandoned generation
+// age out as the thread builds new ones, and are freed with the thread
+// when QThreadPool retires it. Plans are built on first use by the
+// calling thread: fftplan serialises planning and serves it from wisdom
+// or FFTW_ESTIMATE, so that's cheap enough to do on a worker.
+namespace fftworkset {
+
+struct Key {
+    uint64_t generation = 0;
+    int size = 0;            // FFT size
+    int cols = 0;            // columns per tile, the batch of fftTile / fftTileReal
+    bool realInput = false;  // build fftTileReal too
+};
+
+// Unique across the process (and never 0), so generations of different
+// owners can't collide.
+uint64_t newGeneration();
+
+// The calling thread's set for `key`, built now if it has none. Stays
+// valid until this thread calls local() again with a different key.
+FftWorkSet &local(const Key &key);
+
+} // namespace fftworkset
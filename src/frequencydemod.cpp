@@ -184,6 +184,14 @@ void FrequencyDemod::setCheapDemod(bool enabled)
     invalidate();
 }
 
+int FrequencyDemod::effectivePredemodDecimation(int m)
+{
+    // M is picked against the file rate (PlotView::autoTuneFmLpf); a
+    // decimating tuner upstream has already taken decimation() of it.
+    const int upstream = static_cast<int>(decimation());
+    return std::max(1, m / std::max(1, upstream));
+}
+
 void FrequencyDemod::setPredemodDecimation(int m)
 {
     if (m < 1) m = 1;
@@ -418,17 +426,20 @@ bool FrequencyDemod::fillBatchCache(size_t needStart, size_t needEnd)
         decim    = predemodDecim_;
         squelch  = squelchFrac_;
     }
-    if (decim < 1) decim = 1;
+    decim = effectivePredemodDecimation(decim);
 
     // Aim for a generous batch: at least 4× the requested range, with
     // settle-many samples of margin on each side, and never less than 1 M
     // samples (so casual panning stays in cache). Capped so a 100 GB file
     // doesn't try to allocate ridiculous amounts of memory.
+    // Behind a decimating tuner each sample spans several file samples, so
+    // the minimum shrinks to cover the same stretch of the capture.
     constexpr size_t kMinBatch = 1'000'000;
     constexpr size_t kMaxBatch = 8'000'000;
+    const size_t minBatch = std::max<size_t>(kMinBatch / decimation(), 65536);
     const size_t reqLen = needEnd - needStart;
     size_t margin = std::max<size_t>(settle, 4096);
-    size_t want   = std::max(kMinBatch, reqLen + 2 * margin);
+    size_t want   = std::max(minBatch, reqLen + 2 * margin);
     if (want > kMaxBatch) want = kMaxBatch;
     size_t centre = needStart + reqLen / 2;
     size_t half   = want / 2;
@@ -674,7 +685,7 @@ std::unique_ptr<float[]> FrequencyDemod::getSamples(size_t start, size_t length)
         QMutexLocker ml(&mutex);
         method   = postLpfMethod_;
         cutoffHz = postLpfCutoffHz_;
-        decim    = predemodDecim_;
+        decim    = effectivePredemodDecimation(predemodDecim_);
     }
 
     // Fall through to the per-tile SampleBuffer path only when (a) Kaiser
@@ -140,4 +140,6 @@ private:
     std::atomic<uint64_t> cacheEpoch_{1};
     void invalidateBatchCache();
     bool fillBatchCache(size_t needStart, size_t needEnd);
+    // predemodDecim_ less whatever decimation the source already applied.
+    int effectivePredemodDecimation(int m);
 };
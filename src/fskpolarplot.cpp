@@ -243,7 +243,7 @@ void FskPolarPlot::paintBack(QPainter &painter, QRect &rect, range_t<size_t> sam
 void FskPolarPlot::paintMid(QPainter &painter, QRect &rect, range_t<size_t> sampleRange)
 {
     if (selectionEnabled && selectedRange.maximum > selectedRange.minimum)
-        sampleRange = selectedRange;
+        sampleRange = sourceRange(selectedRange);
 
     const size_t delay = delayForRate();
 
@@ -79,7 +79,7 @@ private:
     bool symbolTimed_ = true;
     unsigned dataEpoch_ = 0;
     bool selectionEnabled = false;
-    range_t<size_t> selectedRange{0, 0};
+    range_t<size_t> selectedRange{0, 0};   // file samples, as PlotView's
 
     // Off-GUI-thread render pipeline (mirrors TracePlot's float path).
     QFutureWatcher<QImage> *watcher_ = nullptr;
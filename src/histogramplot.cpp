@@ -143,7 +143,7 @@ void HistogramPlot::paintBack(QPainter &painter, QRect &rect, range_t<size_t> sa
 void HistogramPlot::paintMid(QPainter &painter, QRect &rect, range_t<size_t> sampleRange)
 {
     if (selectionEnabled && selectedRange.maximum > selectedRange.minimum)
-        sampleRange = selectedRange;
+        sampleRange = sourceRange(selectedRange);
 
     if (!floatSource || sampleRange.maximum <= sampleRange.minimum)
         return;
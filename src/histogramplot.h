@@ -52,7 +52,7 @@ private:
     std::shared_ptr<SampleSource<float>> floatSource;
     unsigned dataEpoch_ = 0;
     bool selectionEnabled = false;
-    range_t<size_t> selectedRange{0, 0};
+    range_t<size_t> selectedRange{0, 0};   // file samples, as PlotView's
 
     QFutureWatcher<QImage> *watcher_ = nullptr;
     QImage image_;
@@ -0,0 +1,195 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "inputblockcache.h"
+#include <QMutexLocker>
+#include <algorithm>
+#include <cstring>
+#include "memorybudget.h"
+
+InputBlockCache::InputBlockCache(std::shared_ptr<SampleSource<std::complex<float>>> src) : SampleBuffer(src)
+{
+    budgetId_ = MemoryBudget::instance().track(MemoryBudget::InputBlocks, [this]() {
+        QMutexLocker lk(&mutex_);
+        return static_cast<qint64>(cachedBytes_);
+    });
+}
+
+InputBlockCache::~InputBlockCache()
+{
+    MemoryBudget::instance().untrack(budgetId_);
+}
+
+void InputBlockCache::work(void *input, void *output, int count, size_t sampleid)
+{
+    std::memcpy(output, input, count * sizeof(std::complex<float>));
+}
+
+void InputBlockCache::invalidateEvent()
+{
+    // New file (or more of an inflating one): bump the epoch BEFORE
+    // forwarding, so the tuners' refills already miss.
+    epoch_.fetch_add(1, std::memory_order_release);
+    SampleBuffer::invalidateEvent();
+}
+
+InputBlockCache::Block InputBlockCache::fetch(size_t blockIdx)
+{
+    const size_t total = count();
+    const size_t start = blockIdx * kBlock;
+    if (start >= total)
+        return nullptr;
+    const size_t length = std::min(kBlock, total - start);
+    // A cf32 file comes back as a view straight into the mmap, so this is
+    // the only copy.
+    auto view = src->getSampleView(start, length);
+    if (!view)
+        return nullptr;
+    return std::make_shared<std::vector<std::complex<float>>>(view.data, view.data + length);
+}
+
+InputBlockCache::Block InputBlockCache::block(size_t blockIdx)
+{
+    const uint64_t nowEpoch = epoch_.load(std::memory_order_acquire);
+    const size_t total = count();
+    const size_t start = blockIdx * kBlock;
+    if (start >= total)
+        return nullptr;
+    // A block cut short by the end of a still-inflating input is refetched
+    // once more of it is there.
+    const size_t wanted = std::min(kBlock, total - start);
+
+    std::promise<Block> promise;
+    std::shared_future<Block> inFlight;
+    bool stale = false;
+    {
+        QMutexLocker lk(&mutex_);
+        // As in TunerTransform: only an OLDER map is dropped; a worker still
+        // draining an older epoch just reads around the cache.
+        if (mapEpoch_ < nowEpoch) {
+            blocks_.clear();
+            pending_.clear();
+            lru_.clear();
+            cachedBytes_ = 0;
+            mapEpoch_ = nowEpoch;
+        }
+        if (mapEpoch_ != nowEpoch) {
+            stale = true;
+        } else {
+            auto it = blocks_.find(blockIdx);
+            if (it != blocks_.end() && it->second->size() >= wanted) {
+                lru_.remove(blockIdx);
+                lru_.push_front(blockIdx);
+                return it->second;
+            }
+            auto p = pending_.find(blockIdx);
+            if (p != pending_.end())
+                inFlight = p->second;
+            else
+                pending_.emplace(blockIdx, promise.get_future().share());
+        }
+    }
+    if (stale)
+        return fetch(blockIdx);
+    if (inFlight.valid())
+        return inFlight.get();
+
+    Block blk = fetch(blockIdx);
+    {
+        QMutexLocker lk(&mutex_);
+        // A newer epoch has already cleared our pending entry along with
+        // the map; anything under this index now belongs to it.
+        if (mapEpoch_ == nowEpoch) {
+            pending_.erase(blockIdx);
+            if (blk && epoch_.load(std::memory_order_acquire) == nowEpoch) {
+                const size_t quota = static_cast<size_t>(MemoryBudget::instance().quota(MemoryBudget::InputBlocks));
+                auto it = blocks_.find(blockIdx);
+                if (it != blocks_.end()) {
+                    cachedBytes_ -= it->second->size() * sizeof(std::complex<float>);
+                    it->second = blk;
+                    lru_.remove(blockIdx);
+                } else {
+                    blocks_.emplace(blockIdx, blk);
+                }
+                lru_.push_front(blockIdx);
+                cachedBytes_ += blk->size() * sizeof(std::complex<float>);
+                while (cachedBytes_ > quota && lru_.size() > 1) {
+                    auto victim = blocks_.find(lru_.back());
+                    cachedBytes_ -= victim->second->size() * sizeof(std::complex<float>);
+                    blocks_.erase(victim);
+                    lru_.pop_back();
+                }
+            }
+        }
+    }
+    promise.set_value(blk);
+    return blk;
+}
+
+std::unique_ptr<std::complex<float>[]> InputBlockCache::getSamples(size_t start, size_t length)
+{
+    const size_t total = count();
+    if (start >= total || length > total - start)
+        return nullptr;
+    if (length == 0)
+        return std::make_unique<std::complex<float>[]>(0);
+
+    const size_t b0 = start / kBlock;
+    const size_t b1 = (start + length - 1) / kBlock;
+    // As in TunerTransform: a read over 3/4 of the quota (an export or a
+    // full-range tuner pass) would flush every other reader's blocks, so it
+    // goes straight upstream without being cached.
+    const size_t quota = static_cast<size_t>(MemoryBudget::instance().quota(MemoryBudget::InputBlocks));
+    if ((b1 - b0 + 1) * kBlock * sizeof(std::complex<float>) > quota / 4 * 3)
+        return src->getSamples(start, length);
+
+    auto result = std::make_unique<std::complex<float>[]>(length);
+    for (size_t b = b0; b <= b1; ++b) {
+        Block blk = block(b);
+        const size_t blkStart = b * kBlock;
+        const size_t copyStart = std::max(start, blkStart);
+        const size_t copyEnd = std::min(start + length, blkStart + kBlock);
+        if (!blk || blk->size() < copyEnd - blkStart)
+            return nullptr;
+        std::memcpy(result.get() + (copyStart - start),
+                    blk->data() + (copyStart - blkStart),
+                    (copyEnd - copyStart) * sizeof(std::complex<float>));
+    }
+    return result;
+}
+
+SampleView<std::complex<float>> InputBlockCache::viewSamples(size_t start, size_t length)
+{
+    // Only a range inside one block can be lent out as is; anything wider
+    // goes through getSamples()'s copy.
+    if (length == 0 || start / kBlock != (start + length - 1) / kBlock)
+        return {};
+    const size_t total = count();
+    if (start >= total || length > total - start)
+        return {};
+    Block blk = block(start / kBlock);
+    const size_t offset = start % kBlock;
+    if (!blk || blk->size() < offset + length)
+        return {};
+    SampleView<std::complex<float>> view;
+    view.data = blk->data() + offset;
+    view.length = length;
+    view.keepAlive = std::move(blk);
+    return view;
+}
@@ -0,0 +1,76 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "samplebuffer.h"
+#include <QMutex>
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Shared cache of converted input IQ between an InputSource and the
+// TunerTransforms (and TunerDecimators) of one spectrogram. Each tuner
+// keeps its own block cache of tuned IQ, but they all start from the same
+// capture: without this, two channels over the same stretch of file each
+// read and format-convert it (and for a .zst input, decompress it) again.
+//
+// getSamples() serves kBlock-aligned absolute blocks. A hit is a copy under
+// a short lock, or no copy at all when the range sits inside one block
+// (viewSamples hands out the block itself). A miss by a second reader
+// while the first is still fetching the same block waits for that fetch
+// instead of issuing its own, so tuners painting the same view in parallel
+// share one read. Invalidated (epoch bump) only when the input itself
+// changes; retuning only reads it. Capped in bytes by the MemoryBudget
+// InputBlocks quota, and reads over 3/4 of that skip it.
+class InputBlockCache : public SampleBuffer<std::complex<float>, std::complex<float>>
+{
+public:
+    InputBlockCache(std::shared_ptr<SampleSource<std::complex<float>>> src);
+    ~InputBlockCache();
+    // Identity; getSamples() below is overridden so this is never reached.
+    void work(void *input, void *output, int count, size_t sampleid) override;
+    bool workIsReentrant() override { return true; }
+    std::unique_ptr<std::complex<float>[]> getSamples(size_t start, size_t length) override;
+    SampleView<std::complex<float>> viewSamples(size_t start, size_t length) override;
+    void invalidateEvent() override;
+    bool realSignal() override { return src->realSignal(); }
+
+private:
+    using Block = std::shared_ptr<const std::vector<std::complex<float>>>;
+    static constexpr size_t kBlock = 65536;       // samples per cache block
+
+    // Block `blockIdx` from the cache, from a fetch already in flight, or
+    // read now. Null past the end of the input or on a failed read.
+    Block block(size_t blockIdx);
+    Block fetch(size_t blockIdx);
+
+    QMutex                mutex_;                  // guards everything below
+    std::atomic<uint64_t> epoch_{1};
+    uint64_t              mapEpoch_ = 0;           // epoch the current map belongs to
+    std::unordered_map<size_t, Block> blocks_;     // blockIndex -> data
+    std::unordered_map<size_t, std::shared_future<Block>> pending_; // fetches in flight
+    std::list<size_t>     lru_;                     // front = most-recently-used
+    size_t                cachedBytes_ = 0;
+    int                   budgetId_ = 0;
+};
@@ -19,6 +19,9 @@
  */
 
 #include "inputsource.h"
+#include "sampleconvert.h"
+#include "zstdinflater.h"
+#include "zstdseekable.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -27,7 +30,9 @@
 
 #include <stdexcept>
 #include <algorithm>
+#include <cstdint>
 #include <ctime>
+#include <limits>
 #include <vector>
 
 #include <QFileInfo>
@@ -47,12 +52,17 @@
 #include <QDir>
 #include <QDateTime>
 #include <QCryptographicHash>
+#include <QDebug>
+#include <QTimer>
 
 #ifdef HAVE_ZSTD
 #include <zstd.h>
 #endif
 
 
+// The integer and real adapters below hand off to the runtime-dispatched
+// kernels in sampleconvert.{h,cpp}. std::complex<T> is layout-compatible with
+// T[2], so the complex formats convert as a flat run of 2·length scalars.
 class ComplexF32SampleAdapter : public SampleAdapter {
 public:
     size_t sampleSize() override {
@@ -63,6 +73,15 @@ public:
         auto s = reinterpret_cast<const std::complex<float>*>(src);
         std::copy(&s[start], &s[start + length], dest);
     }
+
+    const std::complex<float> *directRange(const void* const src, size_t start) override {
+        // Container members (tar/SigMF archive) start at a 512-byte boundary
+        // so this holds in practice, but a misaligned offset must fall back
+        // to the copying path rather than hand out an unaligned pointer.
+        if (reinterpret_cast<uintptr_t>(src) % alignof(std::complex<float>) != 0)
+            return nullptr;
+        return reinterpret_cast<const std::complex<float>*>(src) + start;
+    }
 };
 
 class ComplexF64SampleAdapter : public SampleAdapter {
@@ -106,12 +125,8 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const std::complex<int16_t>*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const std::complex<int16_t>& v) -> std::complex<float> {
-                const float k = 1.0f / 32768.0f;
-                return { v.real() * k, v.imag() * k };
-            }
-        );
+        sampleconvert::active().s16(reinterpret_cast<const int16_t*>(&s[start]), length * 2,
+                                    reinterpret_cast<float*>(dest));
     }
 };
 
@@ -123,12 +138,8 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const std::complex<int8_t>*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const std::complex<int8_t>& v) -> std::complex<float> {
-                const float k = 1.0f / 128.0f;
-                return { v.real() * k, v.imag() * k };
-            }
-        );
+        sampleconvert::active().s8(reinterpret_cast<const int8_t*>(&s[start]), length * 2,
+                                   reinterpret_cast<float*>(dest));
     }
 };
 
@@ -140,12 +151,8 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const std::complex<uint8_t>*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const std::complex<uint8_t>& v) -> std::complex<float> {
-                const float k = 1.0f / 128.0f;
-                return { (v.real() - 127.4f) * k, (v.imag() - 127.4f) * k };
-            }
-        );
+        sampleconvert::active().u8(reinterpret_cast<const uint8_t*>(&s[start]), length * 2,
+                                   reinterpret_cast<float*>(dest));
     }
 };
 
@@ -157,11 +164,7 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const float*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const float& v) -> std::complex<float> {
-                return {v, 0.0f};
-            }
-        );
+        sampleconvert::active().f32Real(&s[start], length, dest);
     }
 };
 
@@ -189,12 +192,7 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const int16_t*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const int16_t& v) -> std::complex<float> {
-                const float k = 1.0f / 32768.0f;
-                return { v * k, 0.0f };
-            }
-        );
+        sampleconvert::active().s16Real(&s[start], length, dest);
     }
 };
 
@@ -206,12 +204,7 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const int8_t*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const int8_t& v) -> std::complex<float> {
-                const float k = 1.0f / 128.0f;
-                return { v * k, 0.0f };
-            }
-        );
+        sampleconvert::active().s8Real(&s[start], length, dest);
     }
 };
 
@@ -223,12 +216,7 @@ public:
 
     void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) override {
         auto s = reinterpret_cast<const uint8_t*>(src);
-        std::transform(&s[start], &s[start + length], dest,
-            [](const uint8_t& v) -> std::complex<float> {
-                const float k = 1.0f / 128.0f;
-                return { (v - 127.4f) * k, 0 };
-            }
-        );
+        sampleconvert::active().u8Real(&s[start], length, dest);
     }
 };
 
@@ -258,12 +246,38 @@ static qint64 tarOctal(const char *buf, size_t len)
     return strtoll(tmp, nullptr, 8);
 }
 
-static std::vector<TarEntry> parseTar(const uchar *data, qint64 totalSize)
+// Reader over an mmap'd archive: every in-range read is a memcpy.
+static InputSource::ArchiveReader mmapReader(const uchar *data)
+{
+    return [data](qint64 pos, qint64 len, char *dst) {
+        memcpy(dst, data + pos, static_cast<size_t>(len));
+        return true;
+    };
+}
+
+// Read a whole tar member's payload into a QByteArray (manifests, metas).
+static QByteArray readTarEntry(const InputSource::ArchiveReader &read, const TarEntry &e)
+{
+    QByteArray bytes(static_cast<int>(e.size), Qt::Uninitialized);
+    if (!read(e.dataOffset, e.size, bytes.data()))
+        throw std::runtime_error(("archive: cannot read member " + e.name).toStdString());
+    return bytes;
+}
+
+// `enough`, when set, is consulted after each member and ends the walk once
+// it returns true — for archives whose tail is still being inflated, where
+// reading the next header would block until the whole data member is in.
+using TarStop = std::function<bool(const std::vector<TarEntry> &)>;
+
+static std::vector<TarEntry> parseTar(const InputSource::ArchiveReader &read, qint64 totalSize,
+                                      const TarStop &enough = nullptr)
 {
     std::vector<TarEntry> entries;
     qint64 pos = 0;
+    char hdr[512];
     while (pos + 512 <= totalSize) {
-        const char *hdr = reinterpret_cast<const char*>(data + pos);
+        if (!read(pos, 512, hdr))
+            break;
         bool allZero = true;
         for (int i = 0; i < 512; ++i) { if (hdr[i]) { allZero = false; break; } }
         // A zero block is the end-of-archive marker. We DON'T stop here:
@@ -295,85 +309,29 @@ static std::vector<TarEntry> parseTar(const uchar *data, qint64 totalSize)
         // we care about; skip directories, links, etc.
         if (typeflag == '0' || typeflag == '\0') {
             entries.push_back({name, dataStart, sz});
+            if (enough && enough(entries))
+                break;
         }
         pos = dataStart + ((sz + 511) / 512) * 512;
     }
     return entries;
 }
 
-// Transparent .zst support: stream-decompress a zstd file to disk. We can't
-// mmap compressed bytes (the whole sample pipeline reads via mmap), so the
-// pragmatic approach is to inflate to a cache file once and mmap that. The
-// decompressed output is whatever was compressed — typically a SigMF archive
-// (.sigmf tarball), an iq.tar, or a plain raw IQ file — and openFile is then
-// re-entered on it by suffix.
-
-#ifdef HAVE_ZSTD
-static void zstdDecompressToFile(const QString &src, const QString &dst)
+// Strip the .zst suffix to recover the inner filename (and thus its real
+// suffix, which openFile dispatches on): foo.sigmf.zst -> foo.sigmf.
+static QString zstInnerName(const QFileInfo &zstInfo)
 {
-    QFile in(src);
-    if (!in.open(QIODevice::ReadOnly))
-        throw std::runtime_error(("zstd: cannot open " + src + ": " + in.errorString()).toStdString());
-    QFile out(dst);
-    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate))
-        throw std::runtime_error(("zstd: cannot write " + dst + ": " + out.errorString()).toStdString());
-
-    const size_t inCap = ZSTD_DStreamInSize();
-    const size_t outCap = ZSTD_DStreamOutSize();
-    std::vector<char> inBuf(inCap), outBuf(outCap);
-
-    ZSTD_DCtx *dctx = ZSTD_createDCtx();
-    if (dctx == nullptr)
-        throw std::runtime_error("zstd: failed to create decompression context");
-
-    size_t lastRet = 0;
-    qint64 n;
-    try {
-        while ((n = in.read(inBuf.data(), inCap)) > 0) {
-            ZSTD_inBuffer input = { inBuf.data(), static_cast<size_t>(n), 0 };
-            while (input.pos < input.size) {
-                ZSTD_outBuffer output = { outBuf.data(), outCap, 0 };
-                size_t ret = ZSTD_decompressStream(dctx, &output, &input);
-                if (ZSTD_isError(ret))
-                    throw std::runtime_error(std::string("zstd: ") + ZSTD_getErrorName(ret));
-                if (out.write(outBuf.data(), output.pos) != static_cast<qint64>(output.pos))
-                    throw std::runtime_error(("zstd: write failed: " + out.errorString()).toStdString());
-                lastRet = ret;
-            }
-        }
-        if (n < 0)
-            throw std::runtime_error(("zstd: read failed: " + in.errorString()).toStdString());
-        // A non-zero final return means the last frame ended mid-block, i.e. the
-        // input was truncated. Zero means we landed on a clean frame boundary.
-        if (lastRet != 0)
-            throw std::runtime_error("zstd: truncated or incomplete input stream");
-    } catch (...) {
-        ZSTD_freeDCtx(dctx);
-        out.remove();
-        throw;
-    }
-    ZSTD_freeDCtx(dctx);
-    if (!out.flush())
-        throw std::runtime_error(("zstd: flush failed: " + out.errorString()).toStdString());
-}
-#endif
-
-// Decompress `zstPath` into a per-source cache directory and return the path of
-// the inflated file. The cache key folds in size + mtime so a changed source
-// re-inflates, and a complete previous inflation is reused as-is.
-static QString decompressZstToCache(const QFileInfo &zstInfo)
-{
-#ifndef HAVE_ZSTD
-    (void)zstInfo;
-    throw std::runtime_error(
-        "This build has no zstd support; cannot open .zst input. "
-        "Install libzstd-dev (or libzstd) and rebuild.");
-#else
-    // Strip the .zst suffix to recover the inner filename (and thus its real
-    // suffix, which openFile dispatches on): foo.sigmf.zst -> foo.sigmf.
     QString innerName = zstInfo.fileName();
     innerName.chop(QString(".").length() + QString(zstInfo.suffix()).length()); // drop ".zst"
+    return innerName;
+}
 
+// Per-source scratch directory for a .zst input: holds the frame index for
+// the seekable path, or the inflated copy (+ its .done marker) for the
+// fallback path. The key folds in size + mtime so a changed source is
+// re-indexed / re-inflated.
+static QDir zstCacheDir(const QFileInfo &zstInfo)
+{
     QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
     if (base.isEmpty())
         base = QDir::tempPath();
@@ -389,24 +347,16 @@ static QString decompressZstToCache(const QFileInfo &zstInfo)
     QDir cacheDir(base + "/zst-cache/" + key);
     if (!cacheDir.exists() && !cacheDir.mkpath("."))
         throw std::runtime_error(("zstd: cannot create cache dir " + cacheDir.path()).toStdString());
+    return cacheDir;
+}
 
-    QString outPath = cacheDir.filePath(innerName);
-    QString donePath = outPath + ".done";
-
-    // Reuse a prior complete inflation. The .done marker guards against a
-    // half-written output left behind by an interrupted run.
-    if (QFileInfo::exists(outPath) && QFileInfo::exists(donePath))
-        return outPath;
-
-    zstdDecompressToFile(zstInfo.absoluteFilePath(), outPath);
+// How far into a still-inflating .zst the open may read to find the layout.
+// Archives that keep their metadata further in open once the inflate is done.
+constexpr uint64_t kInflateProbeBytes = 1u << 20;
 
-    QFile marker(donePath);
-    if (marker.open(QIODevice::WriteOnly))
-        marker.close();
-
-    return outPath;
-#endif
-}
+// Thrown by the probe reader for a read past kInflateProbeBytes, so the
+// archive parsers give up on the prefix instead of waiting for the rest.
+struct InflateProbeLimit {};
 
 } // namespace
 
@@ -422,15 +372,45 @@ InputSource::~InputSource()
 
 void InputSource::cleanup()
 {
-    if (mmapData != nullptr) {
-        inputFile->unmap(mmapData);
-        mmapData = nullptr;
-    }
+    // The mapping itself goes away once the last reader drops its snapshot
+    // (or view token); until then only our references are cleared.
+    mapping_.reset();
+    zstdStream_.reset();
+    // Cancels an unfinished inflate; its partial output has no .done marker
+    // and is redone on the next open.
+    inflater_.reset();
+    inflating_.reset();
+    if (inflatePoll_)
+        inflatePoll_->stop();
+    publish();
+}
 
-    if (inputFile != nullptr) {
-        delete inputFile;
-        inputFile = nullptr;
-    }
+void InputSource::publish()
+{
+    auto backing = std::make_shared<Backing>();
+    backing->mapping = mapping_;
+    backing->stream = zstdStream_;
+    backing->inflater = inflater_;
+    backing->adapter = sampleAdapter;
+    backing->dataOffset = dataOffset;
+    backing->sampleCount = sampleCount;
+    std::atomic_store(&backing_, std::shared_ptr<const Backing>(std::move(backing)));
+}
+
+void InputSource::adoptMapping(std::unique_ptr<QFile> file, uchar *data)
+{
+    QFile *raw = file.release();
+    std::shared_ptr<uchar> mapping(data, [raw](uchar *p) {
+        raw->unmap(p);
+        delete raw;
+    });
+    mapping_ = std::move(mapping);
+    zstdStream_.reset();
+    inflater_.reset();
+    inflating_.reset();
+    if (inflatePoll_)
+        inflatePoll_->stop();
+    publish();
 }
 
 QJsonObject InputSource::readMetaData(const QString &filename)
@@ -445,6 +425,64 @@ QJsonObject InputSource::readMetaData(const QString &filename)
     return parseMetaDocument(bytes);
 }
 
+std::vector<Annotation> InputSource::parseMetaAnnotations(const QJsonObject &root)
+{
+    std::vector<Annotation> result;
+    auto global = root["global"].toObject();
+
+    if(root.contains("annotations") && root["annotations"].isArray()) {
+
+        size_t offset = 0;
+
+        if (global.contains("core:offset")) {
+            offset = global["offset"].toDouble();
+        }
+
+        auto annotations = root["annotations"].toArray();
+
+        for (auto annotation_ref : annotations) {
+            if (annotation_ref.isObject()) {
+                auto sigmf_annotation = annotation_ref.toObject();
+
+                const size_t sample_start = sigmf_annotation["core:sample_start"].toDouble();
+
+                if (sample_start < offset)
+                    continue;
+
+                const size_t rel_sample_start = sample_start - offset;
+
+                const size_t sample_count = sigmf_annotation["core:sample_count"].toDouble();
+                auto sampleRange = range_t<size_t>{rel_sample_start, rel_sample_start + sample_count - 1};
+
+                const double freq_lower_edge = sigmf_annotation["core:freq_lower_edge"].toDouble();
+                const double freq_upper_edge = sigmf_annotation["core:freq_upper_edge"].toDouble();
+                auto frequencyRange = range_t<double>{freq_lower_edge, freq_upper_edge};
+
+                auto label = sigmf_annotation["core:label"].toString();
+                auto description = sigmf_annotation["core:description"].toString();
+                auto comment = sigmf_annotation["core:comment"].toString();
+
+                auto sigmf_color = sigmf_annotation["presentation:color"].toString();
+                // SigMF uses the format "#RRGGBBAA" for alpha-channel colors, QT uses "#AARRGGBB".
+                // Test length first: an annotation may carry no presentation:color (then
+                // toString() is empty), and at(0) on an empty QString is out of bounds —
+                // a latent crash in debug builds / UB in release. && short-circuits so
+                // at(0) only runs once we know there are 9 chars.
+                if ((sigmf_color.length() == 9) && (sigmf_color.at(0) == '#')) {
+                    sigmf_color = "#" + sigmf_color.mid(7,2) + sigmf_color.mid(1,6);
+                }
+                auto boxColor = QString::fromStdString("white");
+                if (QColor::isValidColor(sigmf_color)) {
+                    boxColor = sigmf_color;
+                }
+
+                result.emplace_back(sampleRange, frequencyRange, label, description, comment, boxColor);
+            }
+        }
+    }
+    return result;
+}
+
 QJsonObject InputSource::parseMetaDocument(const QByteArray &bytes)
 {
     QJsonDocument d = QJsonDocument::fromJson(bytes);
@@ -514,63 +552,30 @@ QJsonObject InputSource::parseMetaDocument(const QByteArray &bytes)
         }
     }
 
-    if(root.contains("annotations") && root["annotations"].isArray()) {
-
-        size_t offset = 0;
-
-        if (global.contains("core:offset")) {
-            offset = global["offset"].toDouble();
-        }
-
-        auto annotations = root["annotations"].toArray();
-
-        for (auto annotation_ref : annotations) {
-            if (annotation_ref.isObject()) {
-                auto sigmf_annotation = annotation_ref.toObject();
-
-                const size_t sample_start = sigmf_annotation["core:sample_start"].toDouble();
-
-                if (sample_start < offset)
-                    continue;
-
-                const size_t rel_sample_start = sample_start - offset;
-
-                const size_t sample_count = sigmf_annotation["core:sample_count"].toDouble();
-                auto sampleRange = range_t<size_t>{rel_sample_start, rel_sample_start + sample_count - 1};
-
-                const double freq_lower_edge = sigmf_annotation["core:freq_lower_edge"].toDouble();
-                const double freq_upper_edge = sigmf_annotation["core:freq_upper_edge"].toDouble();
-                auto frequencyRange = range_t<double>{freq_lower_edge, freq_upper_edge};
-
-                auto label = sigmf_annotation["core:label"].toString();
-                auto description = sigmf_annotation["core:description"].toString();
-                auto comment = sigmf_annotation["core:comment"].toString();
-
-                auto sigmf_color = sigmf_annotation["presentation:color"].toString();
-                // SigMF uses the format "#RRGGBBAA" for alpha-channel colors, QT uses "#AARRGGBB".
-                // Test length first: an annotation may carry no presentation:color (then
-                // toString() is empty), and at(0) on an empty QString is out of bounds —
-                // a latent crash in debug builds / UB in release. && short-circuits so
-                // at(0) only runs once we know there are 9 chars.
-                if ((sigmf_color.length() == 9) && (sigmf_color.at(0) == '#')) {
-                    sigmf_color = "#" + sigmf_color.mid(7,2) + sigmf_color.mid(1,6);
-                }
-                auto boxColor = QString::fromStdString("white");
-                if (QColor::isValidColor(sigmf_color)) {
-                    boxColor = sigmf_color;
-                }
-
-                annotationList.emplace_back(sampleRange, frequencyRange, label, description, comment, boxColor);
-            }
-        }
-    }
+    auto annotations = parseMetaAnnotations(root);
+    annotationList.insert(annotationList.end(), annotations.begin(), annotations.end());
 
     return root;
 }
 
-void InputSource::openIqTar(const uchar *data, qint64 size)
+void InputSource::openIqTar(const ArchiveReader &read, qint64 size, bool partial)
 {
-    auto entries = parseTar(data, size);
+    // R&S writes the manifest (and its stylesheet) ahead of the data file, so
+    // a partial walk can stop at the first member that's neither.
+    TarStop enough;
+    if (partial) {
+        enough = [](const std::vector<TarEntry> &es) {
+            bool haveXml = false;
+            for (const auto &e : es) {
+                if (e.name.endsWith(".xml", Qt::CaseInsensitive))
+                    haveXml = true;
+                else if (haveXml && !e.name.endsWith(".xslt", Qt::CaseInsensitive))
+                    return true;
+            }
+            return false;
+        };
+    }
+    auto entries = parseTar(read, size, enough);
 
     const TarEntry *xmlEntry = nullptr;
     for (const auto &e : entries) {
@@ -579,8 +584,7 @@ void InputSource::openIqTar(const uchar *data, qint64 size)
     if (!xmlEntry)
         throw std::runtime_error("iq.tar: no XML manifest found in archive");
 
-    QByteArray xmlBytes(reinterpret_cast<const char*>(data + xmlEntry->dataOffset),
-                        static_cast<int>(xmlEntry->size));
+    QByteArray xmlBytes = readTarEntry(read, *xmlEntry);
     QXmlStreamReader xml(xmlBytes);
 
     QString dataFilename, format, dataType;
@@ -650,9 +654,20 @@ void InputSource::openIqTar(const uchar *data, qint64 size)
     frequency = centerFreq;
 }
 
-bool InputSource::openSigmfArchive(const uchar *data, qint64 size)
+bool InputSource::openSigmfArchive(const ArchiveReader &read, qint64 size, bool partial)
 {
-    auto entries = parseTar(data, size);
+    TarStop enough;
+    if (partial) {
+        enough = [](const std::vector<TarEntry> &es) {
+            bool haveMeta = false, haveData = false;
+            for (const auto &e : es) {
+                haveMeta |= e.name.endsWith(".sigmf-meta", Qt::CaseInsensitive);
+                haveData |= e.name.endsWith(".sigmf-data", Qt::CaseInsensitive);
+            }
+            return haveMeta && haveData;
+        };
+    }
+    auto entries = parseTar(read, size, enough);
 
     const TarEntry *metaEntry = nullptr;
     const TarEntry *dataEntry = nullptr;
@@ -667,8 +682,7 @@ bool InputSource::openSigmfArchive(const uchar *data, qint64 size)
     if (!metaEntry || !dataEntry)
         return false;
 
-    QByteArray metaBytes(reinterpret_cast<const char*>(data + metaEntry->dataOffset),
-                         static_cast<int>(metaEntry->size));
+    QByteArray metaBytes = readTarEntry(read, *metaEntry);
     // parseMetaDocument picks the sample adapter and sets sampleRate /
     // frequency / annotations exactly as the .sigmf-* pair path does. Because
     // parseTar reads through EOF padding, metaEntry is the LAST .sigmf-meta in
@@ -721,10 +735,266 @@ void InputSource::setGlobalTitle(const QString &text)
     for (auto &cb : _annotCbs) if (cb) cb();
 }
 
+void InputSource::selectAdapterForSuffix(const std::string &suffix)
+{
+    if ((suffix == "cfile") || (suffix == "cf32")  || (suffix == "fc32")) {
+        sampleAdapter = std::make_unique<ComplexF32SampleAdapter>();
+        _datatype = "cf32_le";
+    }
+    else if ((suffix == "cf64")  || (suffix == "fc64")) {
+        sampleAdapter = std::make_unique<ComplexF64SampleAdapter>();
+        _datatype = "cf64_le";
+    }
+    else if ((suffix == "cs32") || (suffix == "sc32") || (suffix == "c32")) {
+        sampleAdapter = std::make_unique<ComplexS32SampleAdapter>();
+        _datatype = "ci32_le";
+    }
+    else if ((suffix == "cs16") || (suffix == "sc16") || (suffix == "c16")) {
+        sampleAdapter = std::make_unique<ComplexS16SampleAdapter>();
+        _datatype = "ci16_le";
+    }
+    else if ((suffix == "cs8") || (suffix == "sc8") || (suffix == "c8")) {
+        sampleAdapter = std::make_unique<ComplexS8SampleAdapter>();
+        _datatype = "ci8";
+    }
+    else if ((suffix == "cu8") || (suffix == "uc8")) {
+        sampleAdapter = std::make_unique<ComplexU8SampleAdapter>();
+        _datatype = "cu8";
+    }
+    else if (suffix == "f32") {
+        sampleAdapter = std::make_unique<RealF32SampleAdapter>();
+        _realSignal = true;
+        _datatype = "rf32_le";
+    }
+    else if (suffix == "f64") {
+        sampleAdapter = std::make_unique<RealF64SampleAdapter>();
+        _realSignal = true;
+        _datatype = "rf64_le";
+    }
+    else if (suffix == "s16") {
+        sampleAdapter = std::make_unique<RealS16SampleAdapter>();
+        _realSignal = true;
+        _datatype = "ri16_le";
+    }
+    else if (suffix == "s8") {
+        sampleAdapter = std::make_unique<RealS8SampleAdapter>();
+        _realSignal = true;
+        _datatype = "ri8";
+    }
+    else if (suffix == "u8") {
+        sampleAdapter = std::make_unique<RealU8SampleAdapter>();
+        _realSignal = true;
+        _datatype = "ru8";
+    }
+    else {
+        sampleAdapter = std::make_unique<ComplexF32SampleAdapter>();
+        _datatype = "cf32_le";
+    }
+}
+
+void InputSource::openZstdContents(const QFileInfo &zstInfo, const ArchiveReader &read,
+                                   qint64 size, bool growing)
+{
+    // Same dispatch as the plain-file path, but over the decompressed byte
+    // space: the inner name's suffix picks archive vs raw, and the archive
+    // parsers read headers/manifests through `read` rather than an mmap.
+    // Archives carry their member sizes, so even a growing stream yields the
+    // real sampleCount; a growing raw stream has none until it's done, and
+    // count() clamps to what has arrived meanwhile.
+    const QString innerName = zstInnerName(zstInfo);
+    const std::string innerSuffix = QFileInfo(innerName).suffix().toLower().toStdString();
+    auto rawCount = [&]() {
+        return growing ? std::numeric_limits<size_t>::max()
+                       : static_cast<size_t>(size) / sampleAdapter->sampleSize();
+    };
+
+    annotationList.clear();
+    dataOffset = 0;
+    if (innerName.endsWith(".iq.tar", Qt::CaseInsensitive)) {
+        openIqTar(read, size, growing);
+    } else if (innerSuffix == "sigmf" || innerSuffix == "tar") {
+        if (!openSigmfArchive(read, size, growing)) {
+            if (innerSuffix != "tar")
+                throw std::runtime_error("sigmf archive: no .sigmf-meta/.sigmf-data found in archive");
+            // Plain tar without SigMF members: raw IQ, as for an uncompressed .tar.
+            selectAdapterForSuffix(innerSuffix);
+            sampleCount = rawCount();
+        }
+    } else {
+        selectAdapterForSuffix(innerSuffix);
+        sampleCount = rawCount();
+    }
+}
+
+void InputSource::openSeekableZstd(const QFileInfo &zstInfo, std::shared_ptr<ZstdSeekable> stream)
+{
+    // Only the frames the header/manifest reads touch get decoded here.
+    ArchiveReader read = [stream](qint64 pos, qint64 len, char *dst) {
+        return stream->read(static_cast<uint64_t>(pos), static_cast<size_t>(len), dst);
+    };
+    openZstdContents(zstInfo, read, static_cast<qint64>(stream->size()), false);
+
+    cleanup();
+    zstdStream_ = std::move(stream);
+    publish();
+    invalidate();
+}
+
+void InputSource::openInflatingZstd(const QFileInfo &zstInfo, std::shared_ptr<ZstdInflater> inflater)
+{
+    // Header reads wait for the inflater to get that far, but only within
+    // the first kInflateProbeBytes. Raw streams and the usual archive layouts
+    // (meta or manifest first) are settled well inside that; a SigMF archive
+    // with its meta after the data, an iq.tar without a leading manifest or
+    // a plain tar would otherwise hold the GUI thread until the whole stream
+    // was inflated. Those stay empty until finishInflation opens the result.
+    // A stream that ends (or fails) first makes the read fail and the parsers
+    // throw as usual.
+    ArchiveReader read = [inflater](qint64 pos, qint64 len, char *dst) {
+        const uint64_t end = static_cast<uint64_t>(pos) + static_cast<uint64_t>(len);
+        if (end > kInflateProbeBytes)
+            throw InflateProbeLimit();
+        return inflater->waitFor(end) &&
+               inflater->read(static_cast<uint64_t>(pos), static_cast<size_t>(len), dst);
+    };
+    bool deferred = false;
+    try {
+        openZstdContents(zstInfo, read, std::numeric_limits<qint64>::max(), true);
+    } catch (const InflateProbeLimit &) {
+        deferred = true;
+    }
+
+    cleanup();
+    inflating_ = inflater;
+    if (deferred) {
+        // Nothing reads samples meanwhile, so the half-filled layout fields
+        // are simply overwritten by the full open.
+        sampleCount = 0;
+        annotationList.clear();
+    } else {
+        inflater_ = std::move(inflater);
+    }
+    publish();
+    inflatedCountSeen_ = count();
+    if (!inflatePoll_) {
+        inflatePoll_ = std::make_unique<QTimer>();
+        inflatePoll_->setInterval(500);
+        QObject::connect(inflatePoll_.get(), &QTimer::timeout,
+                         inflatePoll_.get(), [this]() { pollInflater(); });
+    }
+    inflatePoll_->start();
+    invalidate();
+}
+
+void InputSource::pollInflater()
+{
+    auto inflater = inflating_;
+    if (!inflater) {
+        inflatePoll_->stop();
+        return;
+    }
+    if (inflater->failed()) {
+        // Keep serving the prefix we have; the rest isn't coming.
+        qWarning() << "zstd:" << inflater->errorString()
+                   << "- showing the first" << count() << "samples only";
+        inflatePoll_->stop();
+        return;
+    }
+    if (inflater->finished()) {
+        finishInflation();
+        return;
+    }
+    // Let the plots pick up the longer capture (scrollbar range, tiles that
+    // were past the end) only when it actually grew.
+    const size_t n = count();
+    if (n != inflatedCountSeen_) {
+        inflatedCountSeen_ = n;
+        invalidate();
+    }
+}
+
+void InputSource::finishInflation()
+{
+    // The cache file is complete: swap the inflater for a plain mmap of it,
+    // exactly as a later open would reuse it via the .done marker.
+    const QString path = inflating_->outputPath();
+    if (!inflater_) {
+        // The layout wasn't in the probed prefix, so nothing has been
+        // reading samples: open the finished file outright.
+        try {
+            openFileImpl(path.toUtf8().constData());
+        } catch (const std::exception &e) {
+            qWarning() << "zstd: cannot open" << path << ":" << e.what();
+            cleanup();
+        }
+        return;
+    }
+    auto file = std::make_unique<QFile>(path);
+    if (!file->open(QFile::ReadOnly)) {
+        qWarning() << "zstd: cannot reopen" << path << ":" << file->errorString();
+        inflatePoll_->stop();
+        return;
+    }
+    const qint64 size = file->size();
+    uchar *data = size > 0 ? file->map(0, size) : nullptr;
+    if (data == nullptr) {
+        qWarning() << "zstd: cannot mmap" << path;
+        inflatePoll_->stop();
+        return;
+    }
+
+    // The complete file has the same layout as the prefix the adapter and
+    // offset were parsed from, so those stay as they are. Only the count is
+    // tightened to what actually arrived.
+    const size_t have = (static_cast<size_t>(size) > dataOffset)
+                            ? (static_cast<size_t>(size) - dataOffset) / sampleAdapter->sampleSize()
+                            : 0;
+    sampleCount = std::min(sampleCount, have);
+    // A partial open stopped at the data member, so a .sigmf-meta appended
+    // after it (a saved annotation update) wasn't seen yet. Re-read just the
+    // metadata now unless the user has already started editing.
+    if (_isArchive && !_annotationsDirty) {
+        try {
+            reloadArchiveMeta(mmapReader(data), size);
+        } catch (const std::exception &e) {
+            qWarning() << "zstd: re-reading archive metadata failed:" << e.what();
+        }
+    }
+
+    adoptMapping(std::move(file), data);
+    invalidate();
+}
+
+void InputSource::reloadArchiveMeta(const ArchiveReader &read, qint64 size)
+{
+    const TarEntry *metaEntry = nullptr;
+    auto entries = parseTar(read, size);
+    for (const auto &e : entries) {
+        if (e.name.endsWith(".sigmf-meta", Qt::CaseInsensitive))
+            metaEntry = &e;
+    }
+    if (!metaEntry)
+        return;
+
+    QJsonParseError perr;
+    QJsonDocument doc = QJsonDocument::fromJson(readTarEntry(read, *metaEntry), &perr);
+    if (perr.error != QJsonParseError::NoError || !doc.isObject())
+        throw std::runtime_error(("sigmf archive: invalid meta: " + perr.errorString()).toStdString());
+    const QJsonObject root = doc.object();
+    const QJsonObject global = root["global"].toObject();
+
+    annotationList = parseMetaAnnotations(root);
+    _globalDescription = global["core:description"].toString();
+    _globalTitle = global["inspectrum:title"].toString();
+    _originalSigmfRoot = root;
+    _archiveMetaName = metaEntry->name;
+}
+
 void InputSource::openFileImpl(const char *filename)
 {
     QFileInfo fileInfo(filename);
     _filePath = fileInfo.absoluteFilePath();
+    _dataFilePath.clear();
     _wasSigmfInput = false;
     _originalSigmfRoot = QJsonObject();
     _annotationsDirty = false;
@@ -745,20 +1015,49 @@ void InputSource::openFileImpl(const char *filename)
     // Default to no container offset; openIqTar overrides this for archives.
     dataOffset = 0;
 
-    // Transparent zstd input: inflate to a cache file, then re-enter openFile
-    // on the decompressed result so its real suffix (.sigmf, .iq.tar, .cf32, …)
-    // drives the rest of the dispatch. Skipped when an explicit fmt override is
-    // set, since that names the raw layout of `filename` itself.
+    // Transparent zstd input. Skipped when an explicit fmt override is set,
+    // since that names the raw layout of `filename` itself.
     if (_fmt.empty() && fileInfo.suffix().compare("zst", Qt::CaseInsensitive) == 0) {
-        QString decompressed = decompressZstToCache(fileInfo);
         // Remember the ORIGINAL compressed container so a later save appends an
-        // updated meta frame here, not beside the decompression-cache temp that
-        // _filePath is about to point at. Recurse via openFileImpl so this
-        // survives (openFile would reset it).
+        // updated meta frame here, not beside a decompression-cache temp.
         _containerPath = fileInfo.absoluteFilePath();
         _archiveZstd = true;
-        openFileImpl(decompressed.toUtf8().constData());
+
+        // Preferred: index the frames and decode on demand, so opening costs
+        // the same whatever the capture size and needs no scratch disk.
+        // The scanned frame index is cached beside where an inflated copy
+        // would go; if that dir is unwritable we simply rescan next time.
+        QString whyNot, indexPath;
+        try {
+            indexPath = zstCacheDir(fileInfo).filePath(zstInnerName(fileInfo) + ".zidx");
+        } catch (const std::exception &) {
+        }
+        if (auto stream = ZstdSeekable::open(fileInfo.absoluteFilePath(), indexPath, &whyNot)) {
+            openSeekableZstd(fileInfo, std::move(stream));
+            return;
+        }
+        qDebug() << "zstd:" << fileInfo.fileName() << "is not randomly accessible ("
+                 << whyNot << ") - inflating to cache";
+
+#ifndef HAVE_ZSTD
+        throw std::runtime_error(
+            "This build has no zstd support; cannot open .zst input. "
+            "Install libzstd-dev (or libzstd) and rebuild.");
+#else
+        // Fallback: inflate to a cache file. A complete previous inflation
+        // (guarded by its .done marker against a half-written leftover) is
+        // re-entered as a plain file so its real suffix (.sigmf, .iq.tar,
+        // .cf32, …) drives the dispatch; recurse via openFileImpl so the
+        // container tracking above survives (openFile would reset it).
+        // Otherwise inflate in the background and open the growing prefix.
+        const QString outPath = zstCacheDir(fileInfo).filePath(zstInnerName(fileInfo));
+        if (QFileInfo::exists(outPath) && QFileInfo::exists(outPath + ".done")) {
+            openFileImpl(outPath.toUtf8().constData());
+            return;
+        }
+        openInflatingZstd(fileInfo, std::make_shared<ZstdInflater>(fileInfo.absoluteFilePath(), outPath));
         return;
+#endif
     }
 
     // R&S iq.tar container — delegate to openIqTar which discovers format,
@@ -777,72 +1076,18 @@ void InputSource::openFileImpl(const char *filename)
         annotationList.clear();
         dataOffset = 0;
         try {
-            openIqTar(data, size);
+            openIqTar(mmapReader(data), size);
         } catch (...) {
             file->unmap(data);
             throw;
         }
 
-        cleanup();
-        inputFile = file.release();
-        mmapData = data;
+        adoptMapping(std::move(file), data);
         invalidate();
         return;
     }
 
-    if ((suffix == "cfile") || (suffix == "cf32")  || (suffix == "fc32")) {
-        sampleAdapter = std::make_unique<ComplexF32SampleAdapter>();
-        _datatype = "cf32_le";
-    }
-    else if ((suffix == "cf64")  || (suffix == "fc64")) {
-        sampleAdapter = std::make_unique<ComplexF64SampleAdapter>();
-        _datatype = "cf64_le";
-    }
-    else if ((suffix == "cs32") || (suffix == "sc32") || (suffix == "c32")) {
-        sampleAdapter = std::make_unique<ComplexS32SampleAdapter>();
-        _datatype = "ci32_le";
-    }
-    else if ((suffix == "cs16") || (suffix == "sc16") || (suffix == "c16")) {
-        sampleAdapter = std::make_unique<ComplexS16SampleAdapter>();
-        _datatype = "ci16_le";
-    }
-    else if ((suffix == "cs8") || (suffix == "sc8") || (suffix == "c8")) {
-        sampleAdapter = std::make_unique<ComplexS8SampleAdapter>();
-        _datatype = "ci8";
-    }
-    else if ((suffix == "cu8") || (suffix == "uc8")) {
-        sampleAdapter = std::make_unique<ComplexU8SampleAdapter>();
-        _datatype = "cu8";
-    }
-    else if (suffix == "f32") {
-        sampleAdapter = std::make_unique<RealF32SampleAdapter>();
-        _realSignal = true;
-        _datatype = "rf32_le";
-    }
-    else if (suffix == "f64") {
-        sampleAdapter = std::make_unique<RealF64SampleAdapter>();
-        _realSignal = true;
-        _datatype = "rf64_le";
-    }
-    else if (suffix == "s16") {
-        sampleAdapter = std::make_unique<RealS16SampleAdapter>();
-        _realSignal = true;
-        _datatype = "ri16_le";
-    }
-    else if (suffix == "s8") {
-        sampleAdapter = std::make_unique<RealS8SampleAdapter>();
-        _realSignal = true;
-        _datatype = "ri8";
-    }
-    else if (suffix == "u8") {
-        sampleAdapter = std::make_unique<RealU8SampleAdapter>();
-        _realSignal = true;
-        _datatype = "ru8";
-    }
-    else {
-        sampleAdapter = std::make_unique<ComplexF32SampleAdapter>();
-        _datatype = "cf32_le";
-    }
+    selectAdapterForSuffix(suffix);
 
     QString dataFilename;
 
@@ -888,7 +1133,7 @@ void InputSource::openFileImpl(const char *filename)
         dataOffset = 0;
         bool handled = false;
         try {
-            handled = openSigmfArchive(data, archiveSize);
+            handled = openSigmfArchive(mmapReader(data), archiveSize);
         } catch (...) {
             file->unmap(data);
             throw;
@@ -900,9 +1145,7 @@ void InputSource::openFileImpl(const char *filename)
             // already points at the .zst and must be left alone.
             if (_containerPath.isEmpty())
                 _containerPath = fileInfo.absoluteFilePath();
-            cleanup();
-            inputFile = file.release();
-            mmapData = data;
+            adoptMapping(std::move(file), data);
             invalidate();
             return;
         }
@@ -924,6 +1167,7 @@ void InputSource::openFileImpl(const char *filename)
     if (!file->open(QFile::ReadOnly)) {
         throw std::runtime_error(file->errorString().toStdString());
     }
+    _dataFilePath = QFileInfo(dataFilename).absoluteFilePath();
 
     auto size = file->size();
     sampleCount = size / sampleAdapter->sampleSize();
@@ -932,10 +1176,7 @@ void InputSource::openFileImpl(const char *filename)
     if (data == nullptr)
         throw std::runtime_error("Error mmapping file");
 
-    cleanup();
-
-    inputFile = file.release();
-    mmapData = data;
+    adoptMapping(std::move(file), data);
 
     invalidate();
 }
@@ -961,26 +1202,134 @@ double InputSource::rate()
     return sampleRate;
 }
 
+size_t InputSource::available(const Backing &backing)
+{
+    if (!backing.inflater || !backing.adapter)
+        return backing.sampleCount;
+    const uint64_t avail = backing.inflater->available();
+    if (avail <= backing.dataOffset)
+        return 0;
+    return std::min<uint64_t>(backing.sampleCount,
+                              (avail - backing.dataOffset) / backing.adapter->sampleSize());
+}
+
+size_t InputSource::count()
+{
+    auto backing = std::atomic_load(&backing_);
+    return backing ? available(*backing) : 0;
+}
+
 std::unique_ptr<std::complex<float>[]> InputSource::getSamples(size_t start, size_t length)
 {
-    if (inputFile == nullptr)
+    // One snapshot for the whole read; see Backing.
+    auto backing = std::atomic_load(&backing_);
+    if (!backing)
         return nullptr;
+    if (backing->stream)
+        return getSamplesFromStream(*backing, start, length);
+    if (backing->inflater)
+        return getSamplesFromInflater(*backing, start, length);
 
-    if (mmapData == nullptr)
+    if (!backing->mapping || !backing->adapter)
         return nullptr;
 
     if(start < 0 || length < 0)
         return nullptr;
 
-    if (start + length > sampleCount)
+    if (start + length > backing->sampleCount)
+        return nullptr;
+
+    auto dest = std::make_unique<std::complex<float>[]>(length);
+    backing->adapter->copyRange(backing->mapping.get() + backing->dataOffset, start, length, dest.get());
+
+    return dest;
+}
+
+std::unique_ptr<std::complex<float>[]> InputSource::getSamplesFromStream(const Backing &backing,
+                                                                        size_t start, size_t length)
+{
+    SampleAdapter *adapter = backing.adapter.get();
+    if (!adapter || start + length > backing.sampleCount)
         return nullptr;
 
+    const size_t ss = adapter->sampleSize();
+    const uint64_t byteStart = backing.dataOffset + static_cast<uint64_t>(start) * ss;
     auto dest = std::make_unique<std::complex<float>[]>(length);
-    sampleAdapter->copyRange(mmapData + dataOffset, start, length, dest.get());
 
+    // Inside one frame: convert straight out of the cached decoded frame.
+    // Spanning frames: gather the raw bytes first, then convert.
+    std::shared_ptr<const void> token;
+    if (const char *p = backing.stream->borrow(byteStart, length * ss, token)) {
+        adapter->copyRange(p, 0, length, dest.get());
+        return dest;
+    }
+    std::vector<char> raw(length * ss);
+    if (!backing.stream->read(byteStart, raw.size(), raw.data()))
+        return nullptr;
+    adapter->copyRange(raw.data(), 0, length, dest.get());
+    return dest;
+}
+
+std::unique_ptr<std::complex<float>[]> InputSource::getSamplesFromInflater(const Backing &backing,
+                                                                          size_t start, size_t length)
+{
+    // Ranges past what has been inflated so far fail like any out-of-range
+    // request; the plots re-ask once count() grows.
+    SampleAdapter *adapter = backing.adapter.get();
+    if (!adapter || start + length > available(backing))
+        return nullptr;
+
+    const size_t ss = adapter->sampleSize();
+    std::vector<char> raw(length * ss);
+    if (!backing.inflater->read(backing.dataOffset + static_cast<uint64_t>(start) * ss,
+                                raw.size(), raw.data()))
+        return nullptr;
+    auto dest = std::make_unique<std::complex<float>[]>(length);
+    adapter->copyRange(raw.data(), 0, length, dest.get());
     return dest;
 }
 
+SampleView<std::complex<float>> InputSource::viewSamples(size_t start, size_t length)
+{
+    SampleView<std::complex<float>> view;
+    auto backing = std::atomic_load(&backing_);
+    if (!backing || !backing->adapter || start + length > backing->sampleCount)
+        return view;
+    SampleAdapter *adapter = backing->adapter.get();
+
+    if (backing->stream) {
+        // A cf32 range inside a single decoded frame can be lent out directly;
+        // the frame's buffer is the lifetime token.
+        if (length == 0)
+            return view;
+        const size_t ss = adapter->sampleSize();
+        std::shared_ptr<const void> token;
+        const char *p = backing->stream->borrow(backing->dataOffset + static_cast<uint64_t>(start) * ss,
+                                                length * ss, token);
+        const std::complex<float> *direct = p ? adapter->directRange(p, 0) : nullptr;
+        if (direct == nullptr)
+            return view;
+        view.data = direct;
+        view.length = length;
+        view.keepAlive = std::move(token);
+        return view;
+    }
+
+    // The mapping is the token, so the pages we're about to point into stay
+    // mapped for as long as the caller holds the view.
+    if (!backing->mapping)
+        return view;
+
+    const std::complex<float> *p = adapter->directRange(backing->mapping.get() + backing->dataOffset, start);
+    if (p == nullptr)
+        return view;
+
+    view.data = p;
+    view.length = length;
+    view.keepAlive = backing->mapping;
+    return view;
+}
+
 void InputSource::setFormat(std::string fmt){
     _fmt = fmt;
 }
@@ -1157,6 +1506,67 @@ bool InputSource::appendMetaToArchive(const QJsonObject &root, QString *errorOut
     return true;
 }
 
+QString InputSource::sidecarPath(const QString &suffix) const
+{
+    if (_filePath.isEmpty())
+        return QString();
+    if (!_containerPath.isEmpty())
+        return _containerPath + "." + suffix;
+    if (_wasSigmfInput) {
+        QFileInfo fileInfo(_filePath);
+        return fileInfo.path() + "/" + fileInfo.completeBaseName() + "." + suffix;
+    }
+    return _filePath + "." + suffix;
+}
+
+QByteArray InputSource::contentKey() const
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!_containerPath.isEmpty()) {
+        // An archive (or .zst) gets a meta member appended on every
+        // annotation save, so its size and mtime change without the samples
+        // changing. The data member itself is never rewritten: key on its
+        // place and length (below) plus a fingerprint of its two ends.
+        hash.addData(QFileInfo(_containerPath).absoluteFilePath().toUtf8());
+        hashDataEnds(hash);
+    } else {
+        // The file the samples actually come from changes size/mtime
+        // whenever its contents do.
+        QFileInfo source(!_dataFilePath.isEmpty() ? _dataFilePath : _filePath);
+        hash.addData(source.absoluteFilePath().toUtf8());
+        hash.addData(QByteArray::number(source.size()));
+        hash.addData(QByteArray::number(source.lastModified().toMSecsSinceEpoch()));
+    }
+    // Format and layout cover a changed override or meta.
+    hash.addData(_datatype.toUtf8());
+    hash.addData(QByteArray::number(static_cast<qulonglong>(dataOffset)));
+    hash.addData(QByteArray::number(static_cast<qulonglong>(sampleCount)));
+    return hash.result();
+}
+
+void InputSource::hashDataEnds(QCryptographicHash &hash) const
+{
+    // From the published snapshot, whose store and layout always match.
+    auto backing = std::atomic_load(&backing_);
+    if (!backing || !backing->adapter)
+        return;
+    const uint64_t bytes = static_cast<uint64_t>(backing->sampleCount) * backing->adapter->sampleSize();
+    const uint64_t span = std::min<uint64_t>(bytes, 64u << 10);
+    QByteArray buf(static_cast<int>(span), Qt::Uninitialized);
+    for (uint64_t at : {uint64_t(0), bytes - span}) {
+        const uint64_t pos = backing->dataOffset + at;
+        if (backing->mapping) {
+            memcpy(buf.data(), backing->mapping.get() + pos, span);
+        } else if (backing->stream) {
+            if (!backing->stream->read(pos, span, buf.data()))
+                continue;
+        } else {
+            continue;
+        }
+        hash.addData(buf);
+    }
+}
+
 bool InputSource::saveAnnotations(QString *errorOut)
 {
     if (_filePath.isEmpty()) {
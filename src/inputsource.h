@@ -22,32 +22,92 @@
 
 #include <complex>
 #include <functional>
+#include <memory>
 #include <QFile>
 #include <QJsonObject>
 #include "samplesource.h"
 
+class QCryptographicHash;
+class QFileInfo;
+class QTimer;
+class ZstdInflater;
+class ZstdSeekable;
+
 class SampleAdapter {
 public:
     virtual size_t sampleSize() = 0;
     virtual void copyRange(const void* const src, size_t start, size_t length, std::complex<float>* const dest) = 0;
+    // Pointer to sample `start` when the on-disk layout is already
+    // std::complex<float> (cf32_le), so callers can read it in place; nullptr
+    // for every format that needs conversion.
+    virtual const std::complex<float> *directRange(const void* const src, size_t start) { return nullptr; }
     virtual ~SampleAdapter() { };
 };
 
 class InputSource : public SampleSource<std::complex<float>>
 {
+public:
+    // Random-access reader over an archive's bytes: copy [pos, pos+len) into
+    // dst, false on failure. Lets the tar parsers run over either an mmap or
+    // a seekable zstd stream.
+    using ArchiveReader = std::function<bool(qint64 pos, qint64 len, char *dst)>;
+
 private:
-    QFile *inputFile = nullptr;
+    // Everything a sample read needs, as one immutable snapshot. The open
+    // paths fill in the fields below it on the GUI thread and publish()
+    // copies them into a fresh Backing, so tile jobs, the pyramid builder
+    // and the tuner workers, which load the snapshot once per read, never
+    // pair a new mapping with an old offset or adapter. Each reader's
+    // snapshot keeps its store and adapter alive, so a reopen while one is
+    // mid-copy can't free them under it, and zero-copy views handed out by
+    // viewSamples() hold the mapping the same way.
+    struct Backing {
+        std::shared_ptr<uchar> mapping;
+        std::shared_ptr<ZstdSeekable> stream;
+        std::shared_ptr<ZstdInflater> inflater;
+        std::shared_ptr<SampleAdapter> adapter;
+        size_t dataOffset = 0;
+        size_t sampleCount = 0;
+    };
+    // Read and written only through std::atomic_load / std::atomic_store.
+    std::shared_ptr<const Backing> backing_;
+    // Snapshot the fields below into backing_. GUI thread.
+    void publish();
+
+    // The fields below are the GUI thread's working copy of backing_; only
+    // publish() hands them to readers.
     size_t sampleCount = 0;
     double sampleRate = 0.0;
-    uchar *mmapData = nullptr;
+    // The mmap of the input (the deleter unmaps and deletes the QFile).
+    std::shared_ptr<uchar> mapping_;
+    // Set instead of mapping_ for a seekable .zst input: samples are decoded
+    // on demand from the frames covering each request (see ZstdSeekable),
+    // and dataOffset is a byte offset into the decompressed stream.
+    std::shared_ptr<ZstdSeekable> zstdStream_;
+    // Set while a non-seekable .zst is still being inflated to the cache in
+    // the background. Reads go through the inflater and count() only covers
+    // the prefix already written; inflatePoll_ grows it (invalidate()) as
+    // more arrives and swaps in a plain mmap of the result once it's done.
+    std::shared_ptr<ZstdInflater> inflater_;
+    // The background inflate itself, for the poll timer and stillLoading().
+    // The same object as inflater_, except when the layout couldn't be
+    // found in the prefix openInflatingZstd probes: then only this is set,
+    // count() stays 0 and finishInflation does the whole open.
+    std::shared_ptr<ZstdInflater> inflating_;
+    std::unique_ptr<QTimer> inflatePoll_;
+    size_t inflatedCountSeen_ = 0;
     // Byte offset of the first IQ sample within the mmap. Non-zero for
     // container formats like Rohde & Schwarz .iq.tar where the raw data
     // sits after a 512-byte tar header inside the archive.
     size_t dataOffset = 0;
-    std::unique_ptr<SampleAdapter> sampleAdapter;
+    std::shared_ptr<SampleAdapter> sampleAdapter;
     std::string _fmt;
     bool _realSignal = false;
     QString _filePath;
+    // The file the samples are mapped from when that isn't _filePath — the
+    // .sigmf-data of a pair opened via its .sigmf-meta. Unlike the meta it
+    // doesn't change on an annotation save, so contentKey() stamps it.
+    QString _dataFilePath;
     // SigMF datatype string ("cf32_le", "ci16_le", ...) inferred from the
     // sample adapter that openFile picked. Used when synthesising a sidecar
     // .sigmf-meta for a non-SigMF input.
@@ -93,17 +153,52 @@ private:
     // frequency / annotations. Shared by the .sigmf-* pair path and the
     // in-archive path. Throws on invalid/unsupported meta.
     QJsonObject parseMetaDocument(const QByteArray &bytes);
+    // The annotations array of a parsed SigMF meta root.
+    static std::vector<Annotation> parseMetaAnnotations(const QJsonObject &root);
+    // Re-read only the annotations and editable global text from the newest
+    // .sigmf-meta in an archive, leaving the sample layout (adapter, offset,
+    // count) alone so it can run while workers are reading samples.
+    void reloadArchiveMeta(const ArchiveReader &read, qint64 size);
     // Populate sampleAdapter / sampleRate / sampleCount / frequency /
-    // dataOffset from a memory-mapped R&S iq.tar archive. Throws on error.
-    void openIqTar(const uchar *data, qint64 size);
-    // Populate the same fields from a memory-mapped SigMF archive (a ustar
-    // tarball bundling a .sigmf-meta + .sigmf-data, optionally produced by
-    // decompressing a .sigmf.zst). The data is read in place at its byte
-    // offset within the archive, so no separate extraction copy is made.
+    // dataOffset from an R&S iq.tar archive. Throws on error. With `partial`
+    // the tar walk stops at the data member instead of reading past it, for
+    // an archive whose tail is still being inflated.
+    void openIqTar(const ArchiveReader &read, qint64 size, bool partial = false);
+    // Populate the same fields from a SigMF archive (a ustar tarball bundling
+    // a .sigmf-meta + .sigmf-data, possibly inside a .sigmf.zst). The data is
+    // read in place at its byte offset within the archive, so no separate
+    // extraction copy is made.
     // Returns true if it was a SigMF archive and the fields were populated;
     // false if it carried no .sigmf-meta/.sigmf-data (so the caller can fall
-    // back, e.g. open a plain `.tar` as raw IQ).
-    bool openSigmfArchive(const uchar *data, qint64 size);
+    // back, e.g. open a plain `.tar` as raw IQ). `partial` as for openIqTar;
+    // it means a meta appended after the data isn't seen until a re-parse.
+    bool openSigmfArchive(const ArchiveReader &read, qint64 size, bool partial = false);
+    // Pick sampleAdapter / _datatype / _realSignal from a raw-file suffix
+    // (cf32, cs16, u8, …). Unknown suffixes fall back to cf32.
+    void selectAdapterForSuffix(const std::string &suffix);
+    // Populate the format fields for a .zst input read through `read` rather
+    // than an mmap: dispatch on the inner file's suffix (iq.tar / SigMF
+    // archive / raw). `growing` marks a stream still being inflated, whose
+    // final size isn't known yet.
+    void openZstdContents(const QFileInfo &zstInfo, const ArchiveReader &read,
+                          qint64 size, bool growing);
+    // Finish opening a .zst whose frames ZstdSeekable could index.
+    void openSeekableZstd(const QFileInfo &zstInfo, std::shared_ptr<ZstdSeekable> stream);
+    // Finish opening a .zst that's being inflated in the background.
+    void openInflatingZstd(const QFileInfo &zstInfo, std::shared_ptr<ZstdInflater> inflater);
+    void pollInflater();
+    void finishInflation();
+    // Samples available in `backing`: while inflating, only those written.
+    static size_t available(const Backing &backing);
+    static std::unique_ptr<std::complex<float>[]> getSamplesFromStream(const Backing &backing,
+                                                                       size_t start, size_t length);
+    static std::unique_ptr<std::complex<float>[]> getSamplesFromInflater(const Backing &backing,
+                                                                         size_t start, size_t length);
+    // Drop any previous mapping and take ownership of `file` + its `data`
+    // mapping as the current backing store, then publish().
+    void adoptMapping(std::unique_ptr<QFile> file, uchar *data);
+    // Feed the first and last 64 KiB of the sample data to `hash`.
+    void hashDataEnds(QCryptographicHash &hash) const;
 
 public:
     InputSource();
@@ -111,9 +206,11 @@ public:
     void cleanup();
     void openFile(const char *filename);
     std::unique_ptr<std::complex<float>[]> getSamples(size_t start, size_t length);
-    size_t count() {
-        return sampleCount;
-    };
+    // cf32 inputs are served straight from the mmap; other formats return an
+    // empty view and callers fall back to getSamples().
+    SampleView<std::complex<float>> viewSamples(size_t start, size_t length) override;
+    // While a .zst is inflating, only the samples already written.
+    size_t count();
     void setSampleRate(double rate);
     void setCenterFrequency(double freq);
     void setFormat(std::string fmt);
@@ -125,6 +222,18 @@ public:
         return 1;
     }
     QString filePath() const { return _filePath; }
+    // Path for an inspectrum-private sidecar (e.g. the power-pyramid
+    // overview) with the given suffix: beside the .sigmf-meta for a SigMF
+    // pair, beside the container for an archive or .zst, otherwise beside
+    // the data file. Empty when nothing is open.
+    QString sidecarPath(const QString &suffix) const;
+    // Identity of the open capture's contents — file stamp (or, for a
+    // container, a fingerprint of the data member), format and layout — for
+    // keying derived data persisted across sessions. Stable across
+    // annotation saves.
+    QByteArray contentKey() const;
+    // True while a background inflate is still extending count().
+    bool stillLoading() const { return inflating_ != nullptr; }
 
     // Mutate annotations through these so the dirty flag and change callback
     // fire consistently. Direct vector access still works for the read path.
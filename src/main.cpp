@@ -21,6 +21,7 @@
 #include <QCommandLineParser>
 
 #include "mainwindow.h"
+#include "powerpyramid.h"
 
 int main(int argc, char *argv[])
 {
@@ -68,5 +69,8 @@ int main(int argc, char *argv[])
     }
 
     mainWin.show();
-    return a.exec();
+    const int ret = a.exec();
+    // Let overview builders finish saving their progress.
+    PowerPyramid::finishAll();
+    return ret;
 }
@@ -19,11 +19,13 @@
 
 #include <QMessageBox>
 #include <QtWidgets>
-#include <QPixmapCache>
 #include <QRubberBand>
 #include <sstream>
 
 #include "mainwindow.h"
+#include "disktilecache.h"
+#include "fftwisdom.h"
+#include "memorybudget.h"
 #include "util.h"
 
 MainWindow::MainWindow()
@@ -31,8 +33,6 @@ MainWindow::MainWindow()
     baseTitle = tr("inspectrum - jacobagilbert edition");
     setWindowTitle(baseTitle);
 
-    QPixmapCache::setCacheLimit(40960);
-
     dock = new SpectrogramControls(tr("Controls"), this);
     dock->setAllowedAreas(Qt::LeftDockWidgetArea | Qt::RightDockWidgetArea);
     addDockWidget(Qt::LeftDockWidgetArea, dock);
@@ -80,6 +80,7 @@ MainWindow::MainWindow()
     connect(dock, &SpectrogramControls::derivedHeightChanged, plots, &PlotView::setDerivedPlotHeight);
     // fast-path FM demodulation toggle
     connect(dock, &SpectrogramControls::fastDemodChanged, plots, &PlotView::enableFastDemod);
+    connect(dock, &SpectrogramControls::tunerDecimationChanged, plots, &PlotView::setTunerDecimationEnabled);
     // allow user to control number of threads in the Qt thread pool
     connect(dock, &SpectrogramControls::threadsChanged, plots, &PlotView::setMaxThreads);
     // FM post-demod LPF cutoff, method, and block-average decimation
@@ -105,12 +106,43 @@ MainWindow::MainWindow()
     // Auto period-detection on the visible FM trace, fed into the dock label.
     connect(plots, &PlotView::autoPeriodChanged, dock, &SpectrogramControls::applyAutoPeriod);
     connect(dock, &SpectrogramControls::periodAnalysisChanged, plots, &PlotView::setPeriodAnalysisEnabled);
-    // Spectrogram render mode (Standard / Reassigned) and the reassignment
-    // noise-floor threshold. Both end up on SpectrogramPlot via PlotView.
+    // Spectrogram render mode (Standard / Reassigned / Welch / Multitaper),
+    // the averaging count, zoomed-out column decimation and the
+    // reassignment options. All end up on SpectrogramPlot via PlotView.
     connect(dock, &SpectrogramControls::spectrogramModeChanged, plots, &PlotView::setSpectrogramMode);
+    connect(dock, &SpectrogramControls::spectrogramAveragesChanged, plots, &PlotView::setSpectrogramAverages);
+    connect(dock, &SpectrogramControls::columnDecimationChanged, plots, &PlotView::setColumnDecimation);
     connect(dock, &SpectrogramControls::reassignmentFloorChanged, plots, &PlotView::setReassignmentFloor);
     connect(dock, &SpectrogramControls::reassignmentWindowChanged, plots, &PlotView::setReassignmentWindow);
     connect(dock, &SpectrogramControls::reassignmentSplatChanged, plots, &PlotView::setReassignmentSplat);
+    connect(dock, &SpectrogramControls::powerPyramidChanged, plots, &PlotView::setPowerPyramidEnabled);
+    connect(dock, &SpectrogramControls::slidingDftChanged, plots, &PlotView::setSlidingDftEnabled);
+    // Shared cache memory budget, and a once-a-second readout of what each
+    // cache pool currently holds.
+    connect(dock, &SpectrogramControls::memoryBudgetChanged,
+            this, [](int mb) { MemoryBudget::instance().setTotal(static_cast<qint64>(mb) << 20); });
+    connect(dock, &SpectrogramControls::diskTileCacheChanged,
+            this, [](int mb) { DiskTileCache::instance().setBudget(static_cast<qint64>(mb) << 20); });
+    // FFTW planning level. Also brings up the wisdom store and its planner
+    // before the first file opens, so no plan is built without them.
+    connect(dock, &SpectrogramControls::fftPlanningChanged,
+            &FFTWisdom::instance(), [](int level) {
+        FFTWisdom::instance().setLevel(static_cast<FFTPlanLevel>(level));
+    });
+    auto *memoryUsageTimer = new QTimer(this);
+    memoryUsageTimer->setInterval(1000);
+    connect(memoryUsageTimer, &QTimer::timeout, this, [this]() {
+        auto &budget = MemoryBudget::instance();
+        QStringList lines;
+        for (int p = 0; p < MemoryBudget::PoolCount; p++) {
+            auto pool = static_cast<MemoryBudget::Pool>(p);
+            lines << QString("%1: %2 MB").arg(MemoryBudget::poolName(pool))
+                                         .arg(budget.usage(pool) >> 20);
+        }
+        lines << QString("Disk tiles: %1 MB").arg(DiskTileCache::instance().usage() >> 20);
+        dock->applyMemoryUsage(lines.join("\n"));
+    });
+    memoryUsageTimer->start();
     connect(dock->cursorSymbolsSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged), plots, &PlotView::setCursorSegments);
 
     // Connect dock outputs
@@ -0,0 +1,127 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "memorybudget.h"
+
+#include <QMutexLocker>
+#include <QSettings>
+#include <algorithm>
+
+namespace {
+
+const qint64 kDefaultTotalMB = 512;
+
+// Share of the total per pool, in percent. The packed tiles and their
+// images are what a wide view actually pins; the tuner, trace and input
+// caches only need to cover what's on screen plus some pan history. The
+// input cache holds the raw blocks every tuner re-mixes on a drag (so a
+// drag doesn't re-read the file), hence its larger share. A pyramid's size
+// is fixed by the file length when it's created, so that pool gets none.
+const int kPoolPercent[MemoryBudget::PoolCount] = { 30, 30, 10, 10, 20, 0 };
+
+} // namespace
+
+MemoryBudget &MemoryBudget::instance()
+{
+    static MemoryBudget budget;
+    return budget;
+}
+
+MemoryBudget::MemoryBudget()
+{
+    QSettings settings;
+    total_ = settings.value("MemoryBudgetMB", kDefaultTotalMB).toLongLong() << 20;
+}
+
+void MemoryBudget::setTotal(qint64 bytes)
+{
+    {
+        QMutexLocker lock(&mutex_);
+        bytes = std::max<qint64>(0, bytes);
+        if (bytes == total_)
+            return;
+        total_ = bytes;
+    }
+    emit quotasChanged();
+}
+
+qint64 MemoryBudget::total() const
+{
+    QMutexLocker lock(&mutex_);
+    return total_;
+}
+
+qint64 MemoryBudget::quota(Pool pool) const
+{
+    QMutexLocker lock(&mutex_);
+    const qint64 share = total_ / 100 * kPoolPercent[pool];
+    return std::max(kMinQuota, share / std::max(1, consumers_[pool]));
+}
+
+int MemoryBudget::track(Pool pool, std::function<qint64()> usage)
+{
+    int id;
+    {
+        QMutexLocker lock(&mutex_);
+        id = nextId_++;
+        probes_[id] = { pool, std::move(usage) };
+        ++consumers_[pool];
+    }
+    emit quotasChanged();
+    return id;
+}
+
+void MemoryBudget::untrack(int id)
+{
+    {
+        QMutexLocker lock(&mutex_);
+        auto it = probes_.find(id);
+        if (it == probes_.end())
+            return;
+        --consumers_[it->second.pool];
+        probes_.erase(it);
+    }
+    emit quotasChanged();
+}
+
+qint64 MemoryBudget::usage(Pool pool) const
+{
+    // Probes run unlocked: they may take their own cache's lock, and they
+    // only ever run on the GUI thread, which is also the only mutator of
+    // probes_.
+    qint64 bytes = 0;
+    for (const auto &p : probes_) {
+        if (p.second.pool == pool)
+            bytes += p.second.usage();
+    }
+    return bytes;
+}
+
+QString MemoryBudget::poolName(Pool pool)
+{
+    switch (pool) {
+    case SpectrogramTiles:   return tr("Spectrogram tiles");
+    case SpectrogramPixmaps: return tr("Spectrogram pixmaps");
+    case TunerBlocks:        return tr("Tuner blocks");
+    case TracePixmaps:       return tr("Trace pixmaps");
+    case InputBlocks:        return tr("Input blocks");
+    case PowerPyramids:      return tr("Power pyramids");
+    default:                 return QString();
+    }
+}
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <functional>
+#include <map>
+
+// One shared, byte-accounted memory budget for the in-memory render caches.
+//
+// The spectrogram tile/pixmap caches, the TunerTransform block cache and the
+// trace-plot pixmap cache used to be capped by entry counts picked for one
+// particular tile size, so their real footprint moved with the FFT size and
+// nobody could say how much RAM the view was holding. Each cache now sizes
+// itself from a byte quota handed out here: a fixed share of the total per
+// pool, split evenly across the caches registered in that pool (e.g. one
+// per SpectrogramPlot).
+//
+// Caches register a usage probe with track() so the dock can show live
+// counters. quota() is thread-safe (the tuner cache reads it from workers);
+// track()/untrack()/usage() are GUI-thread only, as are the probes.
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Pool {
+        SpectrogramTiles = 0,   // packed FFT tiles (SpectrogramPlot::fftCache)
+        SpectrogramPixmaps,     // palette-indexed tile images (SpectrogramPlot::imageCache)
+        TunerBlocks,            // tuned IQ blocks and their FIR lead-ins (TunerTransform)
+        TracePixmaps,           // trace-plot tiles (TracePlot)
+        InputBlocks,            // converted input IQ shared by the tuners (InputBlockCache)
+        PowerPyramids,          // zoomed-out overviews (PowerPyramid); fixed size, counted only
+        PoolCount
+    };
+
+    // A single consumer never gets less than this, so at least one tile or
+    // block always fits even under a tiny budget.
+    static constexpr qint64 kMinQuota = 8 << 20;
+
+    static MemoryBudget &instance();
+
+    // Total budget across all pools. Defaults to the "MemoryBudgetMB"
+    // setting (512 MB). Emits quotasChanged().
+    void setTotal(qint64 bytes);
+    qint64 total() const;
+    // Byte quota for one consumer registered in `pool`.
+    qint64 quota(Pool pool) const;
+
+    // Register a cache's usage probe (returning bytes held); returns an id
+    // for untrack(). Both change the pool's per-consumer quota.
+    int track(Pool pool, std::function<qint64()> usage);
+    void untrack(int id);
+    // Sum of the probes in `pool`.
+    qint64 usage(Pool pool) const;
+    static QString poolName(Pool pool);
+
+signals:
+    void quotasChanged();
+
+private:
+    struct Probe {
+        Pool pool;
+        std::function<qint64()> usage;
+    };
+
+    MemoryBudget();
+
+    mutable QMutex mutex_;             // guards total_ and consumers_
+    qint64 total_ = 0;
+    int consumers_[PoolCount] = {};
+    int nextId_ = 1;
+    std::map<int, Probe> probes_;
+};
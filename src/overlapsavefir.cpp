@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "overlapsavefir.h"
+#include <algorithm>
+
+int OverlapSaveFir::fftSizeFor(size_t taps)
+{
+    int size = 64;
+    while (static_cast<size_t>(size) < 4 * taps)
+        size *= 2;
+    return size;
+}
+
+OverlapSaveFir::OverlapSaveFir(const std::vector<float> &taps)
+    : overlap(taps.empty() ? 0 : taps.size() - 1),
+      fft(fftSizeFor(taps.size())),
+      tail(overlap)
+{
+    const int size = fft.getSize();
+    step = size - overlap;
+
+    auto *in = reinterpret_cast<std::complex<float>*>(fft.input());
+    for (int i = 0; i < size; i++)
+        in[i] = static_cast<size_t>(i) < taps.size() ? taps[i] : 0.0f;
+    fft.execute();
+    const auto *out = reinterpret_cast<const std::complex<float>*>(fft.output());
+    response.resize(size);
+    const float scale = 1.0f / size;
+    for (int i = 0; i < size; i++)
+        response[i] = out[i] * scale;
+}
+
+void OverlapSaveFir::execute(const std::complex<float> *input, std::complex<float> *output, size_t count)
+{
+    const int size = fft.getSize();
+    auto *in = reinterpret_cast<std::complex<float>*>(fft.input());
+    const auto *out = reinterpret_cast<const std::complex<float>*>(fft.output());
+
+    while (count > 0) {
+        // Frame: the carried tail, then up to `step` new samples. A short
+        // last frame is zero-padded; outputs past the new samples would see
+        // the padding but aren't emitted, and the tail only ever holds real
+        // input, so the next call carries on exactly.
+        const size_t n = std::min(step, count);
+        std::copy(tail.begin(), tail.end(), in);
+        std::copy(input, input + n, in + overlap);
+        std::fill(in + overlap + n, in + size, std::complex<float>());
+        std::copy(in + n, in + n + overlap, tail.begin());
+
+        fft.execute();
+        // Multiply by the tap spectrum and conjugate, so a second forward
+        // transform (conjugated back below) is the inverse. Spelled out
+        // rather than std::complex operator*, which without -ffast-math
+        // goes through the NaN-checking __mulsc3 call per bin.
+        for (int i = 0; i < size; i++) {
+            const float ar = out[i].real(), ai = out[i].imag();
+            const float br = response[i].real(), bi = response[i].imag();
+            in[i] = { ar * br - ai * bi, -(ar * bi + ai * br) };
+        }
+        fft.execute();
+        // The first `overlap` outputs are circular wrap-around; the rest
+        // are the linear convolution for the new samples.
+        for (size_t i = 0; i < n; i++)
+            output[i] = std::conj(out[overlap + i]);
+
+        input += n;
+        output += n;
+        count -= n;
+    }
+}
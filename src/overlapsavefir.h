@@ -0,0 +1,59 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "fft.h"
+#include <complex>
+#include <vector>
+
+// Fast-convolution FIR with real taps (overlap-save), a drop-in for
+// firfilt_crcf push/execute: execute() continues from the samples of the
+// previous call, starting from zero state like a fresh firfilt, and gives
+// the same output to float rounding.
+//
+// Direct form costs a dot product of the full tap count per output; the
+// narrow tuner filters run to thousands of taps. Here each FFT frame of
+// fftSize() samples yields fftSize() - taps + 1 outputs for two transforms
+// and a complex multiply, so the per-output cost grows with log(taps)
+// instead. Short filters are cheaper in direct form; TunerTransform times
+// both to pick the crossover (TunerTransform::fastFirTaps), and
+// tools/tuner_fir_bench prints it per block size.
+//
+// One object is not thread-safe (it owns its FFT buffers); separate objects
+// run concurrently, like FFT.
+class OverlapSaveFir
+{
+public:
+    explicit OverlapSaveFir(const std::vector<float> &taps);
+    void execute(const std::complex<float> *input, std::complex<float> *output, size_t count);
+    int fftSize() { return fft.getSize(); }
+    // Power of two at least 4× the tap count, so most of every frame is
+    // new output rather than overlap.
+    static int fftSizeFor(size_t taps);
+
+private:
+    size_t overlap;    // taps - 1 input samples carried between frames
+    size_t step;       // new outputs per frame
+    FFT fft;           // forward only; the inverse runs it on conjugates
+    // Tap spectrum, pre-scaled by 1/fftSize for the inverse.
+    std::vector<std::complex<float>> response;
+    // The last `overlap` input samples seen.
+    std::vector<std::complex<float>> tail;
+};
@@ -39,6 +39,12 @@ bool Plot::mouseEvent(QEvent::Type type, QMouseEvent event)
     return false;
 }
 
+range_t<size_t> Plot::sourceRange(range_t<size_t> fileRange) const
+{
+    const size_t d = decimation();
+    return {fileRange.minimum / d, fileRange.maximum / d};
+}
+
 std::shared_ptr<AbstractSampleSource> Plot::output()
 {
     return sampleSource;
@@ -42,6 +42,12 @@ public:
     virtual void paintMid(QPainter &painter, QRect &rect, range_t<size_t> sampleRange);
     virtual void paintFront(QPainter &painter, QRect &rect, range_t<size_t> sampleRange);
     int height() const { return _height; };
+    // PlotView's sample ranges count file samples; a plot behind a
+    // decimating tuner indexes its source 1/decimation() as densely. Map a
+    // file-sample range / index onto the source's own indices.
+    size_t decimation() const { return sampleSource->decimation(); }
+    range_t<size_t> sourceRange(range_t<size_t> fileRange) const;
+    size_t sourceSample(size_t fileSample) const { return fileSample / decimation(); }
     /** Public interface to set plot height at runtime */
     void setPlotHeight(int height) { setHeight(height); }
 
@@ -25,7 +25,6 @@
 #include "fskpolarplot.h"
 #include "histogramplot.h"
 #include "util.h"
-#include <QPixmapCache>
 #include <algorithm>
 #include <climits>
 #include <cmath>
@@ -33,6 +32,7 @@
 #include <fstream>
 #include <type_traits>
 #include <QtGlobal>
+#include <QActionGroup>
 #include <QApplication>
 #include <QClipboard>
 #include <QDateTime>
@@ -112,7 +112,7 @@ void PlotView::enableFastDemod(bool enabled)
 {
     fmFastDemod = enabled;
     // clear any cached trace tiles so new demod data is used
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     // walk all derived TracePlot instances and update their demod mode
     for (auto &plt : plots) {
         if (auto tp = dynamic_cast<TracePlot*>(plt.get())) {
@@ -149,7 +149,7 @@ void PlotView::setFmLpfCutoff(double hz)
             }
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
     if (periodTimer) periodTimer->start();
 }
@@ -204,7 +204,7 @@ void PlotView::setFmDecimation(int n)
             }
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
     if (periodTimer) periodTimer->start();
 }
@@ -224,7 +224,7 @@ void PlotView::setFmLpfMethod(int method)
             }
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
     if (periodTimer) periodTimer->start();
 }
@@ -244,7 +244,7 @@ void PlotView::setFmPredemodDecimation(int m)
             }
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
     if (periodTimer) periodTimer->start();
 }
@@ -260,7 +260,7 @@ void PlotView::setFmSquelch(int pct)
                 fd->setAmplitudeSquelch(pct / 100.0);
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
     if (periodTimer) periodTimer->start();
 }
@@ -275,7 +275,7 @@ void PlotView::setAmDbMode(bool on)
                 am->setDbMode(on);
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
 }
 
@@ -289,7 +289,7 @@ void PlotView::setAmReferenceLevel(double dbm)
                 am->setReferenceLevelDbm(dbm);
         }
     }
-    QPixmapCache::clear();
+    TracePlot::clearTileCache();
     viewport()->update();
 }
 
@@ -352,6 +352,20 @@ void PlotView::setSpectrogramMode(int mode)
     }
 }
 
+void PlotView::setSpectrogramAverages(int count)
+{
+    if (spectrogramPlot) {
+        spectrogramPlot->setAverageCount(count);
+    }
+}
+
+void PlotView::setColumnDecimation(int decimation)
+{
+    if (spectrogramPlot) {
+        spectrogramPlot->setColumnDecimation(decimation);
+    }
+}
+
 void PlotView::setReassignmentFloor(int floorDb)
 {
     if (spectrogramPlot) {
@@ -373,6 +387,27 @@ void PlotView::setReassignmentSplat(int sm)
     }
 }
 
+void PlotView::setPowerPyramidEnabled(bool enabled)
+{
+    if (spectrogramPlot) {
+        spectrogramPlot->setPowerPyramidEnabled(enabled);
+    }
+}
+
+void PlotView::setSlidingDftEnabled(bool enabled)
+{
+    if (spectrogramPlot) {
+        spectrogramPlot->setSlidingDftEnabled(enabled);
+    }
+}
+
+void PlotView::setTunerDecimationEnabled(bool enabled)
+{
+    if (spectrogramPlot) {
+        spectrogramPlot->setTunerDecimationEnabled(enabled);
+    }
+}
+
 void PlotView::analyzeVisiblePeriod()
 {
     // Find the first derived float-source plot (FM trace by convention) and
@@ -398,10 +433,13 @@ void PlotView::analyzeVisiblePeriod()
     }
 
     // Limit the analysis size — the FFT-free zero-crossing pass is O(N) and
-    // we just need a reasonable estimate, not microsecond precision.
+    // we just need a reasonable estimate, not microsecond precision. Work in
+    // the trace's own indices (and rate), which a decimating tuner divides.
     constexpr size_t kMaxAnalyseSamples = 200000;
-    size_t n = viewRange.maximum > viewRange.minimum
-             ? (viewRange.maximum - viewRange.minimum) : 0;
+    const range_t<size_t> range = targetPlot->sourceRange(viewRange);
+    const double rate = sampleRate / targetPlot->decimation();
+    size_t n = range.maximum > range.minimum
+             ? (range.maximum - range.minimum) : 0;
     if (n < 256) {
         if (targetPlot) targetPlot->setPeriodMarkers({});
         emit autoPeriodChanged(0.0);
@@ -409,7 +447,7 @@ void PlotView::analyzeVisiblePeriod()
     }
     if (n > kMaxAnalyseSamples) n = kMaxAnalyseSamples;
 
-    auto data = fsrc->getSamples(viewRange.minimum, n);
+    auto data = fsrc->getSamples(range.minimum, n);
     if (!data) {
         if (targetPlot) targetPlot->setPeriodMarkers({});
         emit autoPeriodChanged(0.0);
@@ -453,7 +491,7 @@ void PlotView::analyzeVisiblePeriod()
         const double d = data[i] - mean;
         if (d < -hyst) armedLow = true;
         else if (armedLow && d > hyst) {
-            peaks.push_back(viewRange.minimum + i);
+            peaks.push_back(range.minimum + i);
             armedLow = false;
         }
     }
@@ -466,7 +504,7 @@ void PlotView::analyzeVisiblePeriod()
     // span between detected peaks rather than the visible duration so an
     // off-by-one near the edges doesn't bias the estimate.
     const double dt = static_cast<double>(peaks.back() - peaks.front())
-                    / (peaks.size() - 1) / sampleRate;
+                    / (peaks.size() - 1) / rate;
     if (targetPlot) targetPlot->setPeriodMarkers(std::move(peaks));
     emit autoPeriodChanged(dt);
 }
@@ -679,7 +717,7 @@ void PlotView::mouseMoveEvent(QMouseEvent *event)
         const int plotIdx = 1 + posInDerived / derivedPlotHeight;
         if (plotIdx >= 1 && static_cast<size_t>(plotIdx) < plots.size()) {
             activePlotIdx = plotIdx;
-            valueText = sampleValueText(plots[plotIdx].get(), sampleIdx, &hoverValue);
+            valueText = sampleValueText(plots[plotIdx].get(), plots[plotIdx]->sourceSample(sampleIdx), &hoverValue);
         }
     } else {
         // Cursor is over the spectrogram (scrollable) — compute frequency
@@ -701,7 +739,7 @@ void PlotView::mouseMoveEvent(QMouseEvent *event)
     for (size_t i = 1; i < plots.size(); ++i) {
         if (auto tp = dynamic_cast<TracePlot*>(plots[i].get())) {
             if (static_cast<int>(i) == activePlotIdx) {
-                tp->setHoverCursor(true, sampleIdx, hoverValue, valueText);
+                tp->setHoverCursor(true, tp->sourceSample(sampleIdx), hoverValue, valueText);
             } else {
                 tp->setHoverCursor(false, 0, 0.0, QString());
             }
@@ -860,7 +898,9 @@ void PlotView::contextMenuEvent(QContextMenuEvent * event)
     // Add actions to add derived plots
     // that are compatible with selectedPlot's output
     QMenu *plotsMenu = menu.addMenu("Add derived plot");
-    auto src = selectedPlot->output();
+    // Plots derived from the spectrogram hang off the active tuner, decimated to its
+    // pass band when that's enabled.
+    auto src = (selectedPlot == spectrogramPlot) ? spectrogramPlot->derivedOutput() : selectedPlot->output();
     auto compatiblePlots = as_range(Plots::plots.equal_range(src->sampleType()));
     // Shortcut: add sample/amplitude/frequency as a single stacked set.
     // Only offered when the source is complex<float> (the combo only makes
@@ -894,7 +934,7 @@ void PlotView::contextMenuEvent(QContextMenuEvent * event)
             action, &QAction::triggered,
             this, [=]() {
                 // Tune the spectrogram tuner to the click Y first; the new
-                // plot subscribes to tunerTransform so it picks up the new
+                // plot subscribes to the active tuner so it picks up the new
                 // centre frequency on its first paint.
                 if (tunerCentreY >= 0)
                     spectrogramPlot->setTunerCentreY(tunerCentreY);
@@ -934,6 +974,46 @@ void PlotView::contextMenuEvent(QContextMenuEvent * event)
         }
     }
 
+    // Tuners on the spectrogram. "Add derived plot" above hangs off the
+    // active one; a second tuner gives a second channel with its own caches
+    // and plots, so comparing two signals doesn't mean retuning back and
+    // forth.
+    if (tunerCentreY >= 0) {
+        QMenu *tunersMenu = menu.addMenu("Tuners");
+        auto newTuner = new QAction("New tuner here", tunersMenu);
+        connect(newTuner, &QAction::triggered, this, [=]() {
+            spectrogramPlot->addTuner(tunerCentreY);
+            viewport()->update();
+        });
+        tunersMenu->addAction(newTuner);
+        tunersMenu->addSeparator();
+        auto *activeGroup = new QActionGroup(tunersMenu);
+        for (int i = 0; i < spectrogramPlot->tunerCount(); i++) {
+            QString name = spectrogramPlot->tunerName(i);
+            if (!spectrogramPlot->tunerInUse(i))
+                name += " (no plots)";
+            auto action = new QAction(name, activeGroup);
+            action->setCheckable(true);
+            action->setChecked(i == spectrogramPlot->activeTunerIndex());
+            connect(action, &QAction::triggered, this, [=]() {
+                spectrogramPlot->setActiveTuner(i);
+                viewport()->update();
+            });
+            tunersMenu->addAction(action);
+        }
+        tunersMenu->addSeparator();
+        const int active = spectrogramPlot->activeTunerIndex();
+        auto removeTuner = new QAction(QString("Remove %1").arg(spectrogramPlot->tunerName(active)), tunersMenu);
+        // Only an unused tuner can go; its plots would otherwise be left
+        // with nothing to steer them.
+        removeTuner->setEnabled(spectrogramPlot->tunerCount() > 1 && !spectrogramPlot->tunerInUse(active));
+        connect(removeTuner, &QAction::triggered, this, [=]() {
+            spectrogramPlot->removeTuner(active);
+            viewport()->update();
+        });
+        tunersMenu->addAction(removeTuner);
+    }
+
     // SigMF annotation display options. Only offered while annotations are being
     // shown (the dock's "Display" checkbox); these toggle how each box is drawn.
     if (spectrogramPlot != nullptr && spectrogramPlot->isAnnotationsEnabled()) {
@@ -1986,10 +2066,14 @@ void PlotView::extractSymbols(std::shared_ptr<AbstractSampleSource> src,
     auto floatSrc = std::dynamic_pointer_cast<SampleSource<float>>(src);
     if (!floatSrc)
         return;
-    auto samples = floatSrc->getSamples(selectedSamples.minimum, selectedSamples.length());
-    auto step = (float)selectedSamples.length() / cursors.segments();
+    const size_t d = src->decimation();
+    range_t<size_t> selection{selectedSamples.minimum / d, selectedSamples.maximum / d};
+    auto samples = floatSrc->getSamples(selection.minimum, selection.length());
+    if (!samples)
+        return;
+    auto step = (float)selection.length() / cursors.segments();
     auto symbols = std::vector<float>();
-    for (auto i = step / 2; i < selectedSamples.length(); i += step)
+    for (auto i = step / 2; i < selection.length(); i += step)
     {
         symbols.push_back(samples[i]);
     }
@@ -2146,9 +2230,15 @@ void PlotView::exportSamples(std::shared_ptr<AbstractSampleSource> src)
 
     std::ofstream os(fileNames[0].toStdString(), std::ios::binary);
 
+    // start/end are file samples; a source behind a decimating tuner has one
+    // sample per srcDecim of them.
+    const size_t srcDecim = sampleSrc->decimation();
+    start /= srcDecim;
+    end = (end + srcDecim - 1) / srcDecim;
+
     size_t index;
     // viewRange.length() is used as some less arbitrary step value
-    size_t step = viewRange.length();
+    size_t step = std::max<size_t>(viewRange.length() / srcDecim, 1);
 
     QProgressDialog progress("Exporting samples...", "Cancel", start, end, this);
     progress.setWindowModality(Qt::WindowModal);
@@ -2203,15 +2293,20 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
     // Read in the same chunk size as the raw exporter so progress and memory
     // behaviour match. With decim>1 we still read a full chunk and write
     // every Nth sample — keeps the loop simple and lets the upstream FIR see
-    // contiguous input.
-    const size_t step = std::max<size_t>(viewRange.length(), 65536);
+    // contiguous input. start/end are file samples; a source behind a
+    // decimating tuner is read in its own indices, srcDecim file samples
+    // apart, and that factor folds into the recorded rate and decimation.
+    const size_t srcDecim = src->decimation();
+    const size_t srcStart = start / srcDecim;
+    const size_t srcEnd = (end + srcDecim - 1) / srcDecim;
+    const size_t step = std::max<size_t>(viewRange.length() / srcDecim, 65536);
     QProgressDialog progress("Exporting SigMF samples...", "Cancel",
-                             (int)std::min<size_t>(start, INT_MAX),
-                             (int)std::min<size_t>(end,   INT_MAX), this);
+                             (int)std::min<size_t>(srcStart, INT_MAX),
+                             (int)std::min<size_t>(srcEnd,   INT_MAX), this);
     progress.setWindowModality(Qt::WindowModal);
 
     size_t writtenSamples = 0;
-    for (size_t index = start; index < end; index += step) {
+    for (size_t index = srcStart; index < srcEnd; index += step) {
         if (index <= (size_t)INT_MAX)
             progress.setValue((int)index);
         if (progress.wasCanceled()) {
@@ -2219,13 +2314,13 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
             QFile::remove(dataPath);
             return false;
         }
-        size_t length = std::min(step, end - index);
+        size_t length = std::min(step, srcEnd - index);
         auto samples = src->getSamples(index, length);
         if (!samples) continue;
         // Pick samples whose absolute offset from `start` is a multiple of
         // decim — keeps the every-Nth pattern aligned across chunk boundaries
         // without explicit phase carry.
-        const size_t relStart = index - start;
+        const size_t relStart = index - srcStart;
         const size_t chunkPhase = (decim - (relStart % decim)) % decim;
         for (size_t i = chunkPhase; i < length; i += decim) {
             os.write((const char*)&samples[i], sizeof(std::complex<float>));
@@ -2233,6 +2328,8 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
         }
     }
     os.close();
+    // File samples per exported sample.
+    const size_t totalDecim = srcDecim * static_cast<size_t>(decim);
 
     // Provenance: pull the source filename and capture frequency from the
     // InputSource at the head of the chain. mainSampleSource is always an
@@ -2242,7 +2339,7 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
     const double tunerOffset = spectrogramPlot ? spectrogramPlot->tunerOffsetHz() : 0.0;
     const double tunerBw    = spectrogramPlot ? spectrogramPlot->tunerBandwidthHz() : oldRate;
     const double oldCenter  = inputSrc ? inputSrc->getFrequency() : 0.0;
-    const double newRate    = (decim > 0) ? oldRate / (double)decim : oldRate;
+    const double newRate    = oldRate / (double)totalDecim;
     const double newCenter  = oldCenter + tunerOffset;
 
     const QString nowIso = QDateTime::currentDateTimeUtc()
@@ -2264,7 +2361,7 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
     global.insert("inspectrum:tuner_bandwidth_hz", tunerBw);
     global.insert("inspectrum:export_start_sample", (qint64)start);
     global.insert("inspectrum:export_end_sample", (qint64)end);
-    global.insert("inspectrum:decimation", decim);
+    global.insert("inspectrum:decimation", (qint64)totalDecim);
 
     QJsonObject capture;
     capture.insert("core:sample_start", 0);
@@ -2291,8 +2388,8 @@ bool PlotView::writeSigmf(std::shared_ptr<SampleSource<std::complex<float>>> src
             const size_t clipEnd   = std::min<size_t>(a.sampleRange.maximum, end - 1);
             // ceil for start / floor for end so the new range strictly covers
             // every original sample of the annotation that survived the clip.
-            const size_t newStart = (clipStart - start + (size_t)decim - 1) / (size_t)decim;
-            const size_t newEnd   = (clipEnd   - start) / (size_t)decim;
+            const size_t newStart = (clipStart - srcStart * srcDecim + totalDecim - 1) / totalDecim;
+            const size_t newEnd   = (clipEnd   - srcStart * srcDecim) / totalDecim;
             const size_t newCount = (newEnd >= newStart) ? (newEnd - newStart + 1) : 1;
 
             QJsonObject ann;
@@ -2468,7 +2565,9 @@ void PlotView::paintEvent(QPaintEvent *event)
     // by updateViewRange — so the actual content width is the pixel span of
     // viewRange at the current zoom, not the full viewport. Stretching N
     // samples across the full width here makes the derived plots disagree
-    // with the spectrogram column-for-column.
+    // with the spectrogram column-for-column. Each plot gets viewRange in its
+    // own source's indices (Plot::sourceRange), which differ from file
+    // samples behind a decimating tuner.
     int contentWidth = std::min<int>(width(), sampleToColumn(viewRange.length()));
     if (contentWidth < 1) contentWidth = 1;
     if (derivedHeight > 0) {
@@ -2477,7 +2576,7 @@ void PlotView::paintEvent(QPaintEvent *event)
         for (size_t i = 1; i < plots.size(); ++i) {
             Plot *plot = plots[i].get();
             QRect rect(0, y, contentWidth, plot->height());
-            plot->paintBack(painter, rect, viewRange);
+            plot->paintBack(painter, rect, plot->sourceRange(viewRange));
             y += plot->height();
         }
         // Mid layer
@@ -2485,7 +2584,7 @@ void PlotView::paintEvent(QPaintEvent *event)
         for (size_t i = 1; i < plots.size(); ++i) {
             Plot *plot = plots[i].get();
             QRect rect(0, y, contentWidth, plot->height());
-            plot->paintMid(painter, rect, viewRange);
+            plot->paintMid(painter, rect, plot->sourceRange(viewRange));
             y += plot->height();
         }
         // Front layer
@@ -2493,7 +2592,7 @@ void PlotView::paintEvent(QPaintEvent *event)
         for (size_t i = 1; i < plots.size(); ++i) {
             Plot *plot = plots[i].get();
             QRect rect(0, y, contentWidth, plot->height());
-            plot->paintFront(painter, rect, viewRange);
+            plot->paintFront(painter, rect, plot->sourceRange(viewRange));
             y += plot->height();
         }
 
@@ -2588,6 +2687,9 @@ size_t PlotView::samplesPerColumn()
 void PlotView::scrollContentsBy(int dx, int dy)
 {
     LatencyLog::markf("scrollContentsBy dx=%d dy=%d", dx, dy);
+    // Scrolling right moves the content left (dx < 0) and the view later.
+    if (dx != 0 && spectrogramPlot != nullptr)
+        spectrogramPlot->notePan(-static_cast<double>(dx) * samplesPerColumn());
     updateView();
 }
 
@@ -153,9 +153,14 @@ public slots:
     // floor. The spectrogram plot owns the actual rendering state; these
     // are pure pass-throughs.
     void setSpectrogramMode(int mode);
+    void setSpectrogramAverages(int count);
+    void setColumnDecimation(int decimation);
     void setReassignmentFloor(int floorDb);
     void setReassignmentWindow(int wt);
     void setReassignmentSplat(int sm);
+    void setPowerPyramidEnabled(bool enabled);
+    void setSlidingDftEnabled(bool enabled);
+    void setTunerDecimationEnabled(bool enabled);
 
 protected:
     void mouseMoveEvent(QMouseEvent *event) override;
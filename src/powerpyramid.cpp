@@ -0,0 +1,447 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "powerpyramid.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include "memorybudget.h"
+#include "util.h"
+
+namespace {
+
+const char kPyramidMagic[4] = { 'I', 'P', 'Y', 'R' };
+const uint32_t kPyramidVersion = 1;
+// Persist progress this often while building, so a long build that's
+// interrupted (app closed, file switched) isn't lost.
+const qint64 kSaveIntervalMs = 30000;
+
+// dB values are stored as int16 centi-dB: ±327 dB at 0.01 dB resolution is
+// far finer than the 8-bit colormap they end up in, at half the size of
+// float. -inf (an all-zero bin) gets the one value nothing else can produce.
+const int16_t kNegInfDb = std::numeric_limits<int16_t>::min();
+
+int16_t encodeDb(float db)
+{
+    if (!(db > -327.67f))   // also catches -inf and NaN
+        return kNegInfDb;
+    return static_cast<int16_t>(std::lround(std::min(db, 327.67f) * 100.0f));
+}
+
+float decodeDb(int16_t v)
+{
+    return v == kNegInfDb ? -std::numeric_limits<float>::infinity() : v * 0.01f;
+}
+
+float dbToLinear(int16_t v)
+{
+    return v == kNegInfDb ? 0.0f : std::pow(10.0f, v * 0.001f);
+}
+
+float linearToDb(float p)
+{
+    return 10.0f * std::log10(p);
+}
+
+// Cancel flags of the builders still running, for finishAll(). A builder
+// nulls its entry before it lets go of its pyramid and erases it after.
+std::mutex buildersMutex;
+std::condition_variable buildersDone;
+std::list<std::atomic<bool> *> builders;
+
+} // namespace
+
+std::shared_ptr<PowerPyramid> PowerPyramid::create(std::shared_ptr<SampleSource<std::complex<float>>> src,
+                                                   int fftSize, const QByteArray &key,
+                                                   const QString &path)
+{
+    if (!src || fftSize <= 0)
+        return nullptr;
+    const size_t count = src->count();
+    const size_t frames = count / static_cast<size_t>(fftSize);
+    if (frames < kMinFrames)
+        return nullptr;
+
+    // Coarsest finest-level that fits the budget, but always decimating by at
+    // least 2: level 0 at one column per frame would just duplicate what the
+    // raw path computes at the same stride.
+    int shift = 1;
+    while ((frames >> shift) * static_cast<size_t>(fftSize) > kFinestValues)
+        shift++;
+
+    // Read-only capture directories are common (mounted media, shared
+    // archives), so keep a cache-dir twin to fall back on.
+    QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty())
+        base = QDir::tempPath();
+    const QString digest = QString::fromLatin1(
+        QCryptographicHash::hash(path.toUtf8(), QCryptographicHash::Sha1).toHex().left(16));
+    const QString fallbackPath = base + "/pyramids/" + digest + "-" + QFileInfo(path).fileName();
+    std::shared_ptr<PowerPyramid> pyramid(
+        new PowerPyramid(std::move(src), fftSize, count, shift, key, path, fallbackPath));
+
+    qint64 bytes = 0;
+    for (const Level &l : pyramid->levels_)
+        bytes += static_cast<qint64>((l.maxDb.size() + l.meanDb.size()) * sizeof(int16_t));
+    const int budgetId = MemoryBudget::instance().track(MemoryBudget::PowerPyramids,
+                                                        [bytes]() { return bytes; });
+
+    std::list<std::atomic<bool> *>::iterator entry;
+    {
+        std::lock_guard<std::mutex> lock(buildersMutex);
+        entry = builders.insert(builders.end(), &pyramid->cancel_);
+    }
+    std::thread(&PowerPyramid::run, pyramid, entry).detach();
+
+    // The builder holds its own reference. Releasing the one handed out
+    // (on the GUI thread) just stops it, without waiting.
+    return std::shared_ptr<PowerPyramid>(pyramid.get(), [pyramid, budgetId](PowerPyramid *) {
+        MemoryBudget::instance().untrack(budgetId);
+        pyramid->cancel_.store(true, std::memory_order_release);
+    });
+}
+
+void PowerPyramid::finishAll()
+{
+    std::unique_lock<std::mutex> lock(buildersMutex);
+    for (std::atomic<bool> *cancel : builders) {
+        if (cancel)
+            cancel->store(true, std::memory_order_release);
+    }
+    buildersDone.wait(lock, []() { return builders.empty(); });
+}
+
+PowerPyramid::PowerPyramid(std::shared_ptr<SampleSource<std::complex<float>>> src, int fftSize,
+                           size_t count, int finestShift, const QByteArray &key,
+                           const QString &path, const QString &fallbackPath)
+    : src_(std::move(src)), fftSize_(fftSize), count_(count),
+      frames_(count / static_cast<size_t>(fftSize)), key_(key),
+      path_(path), fallbackPath_(fallbackPath)
+{
+    const size_t N = static_cast<size_t>(fftSize_);
+    for (int shift = finestShift; (frames_ >> shift) > 0; shift++) {
+        Level level;
+        level.shift = shift;
+        level.cols = frames_ >> shift;
+        level.maxDb.assign(level.cols * N, kNegInfDb);
+        level.meanDb.assign(level.cols * N, kNegInfDb);
+        levels_.push_back(std::move(level));
+        if (levels_.back().cols == 1)
+            break;
+    }
+
+    // Same Hann window as the standard spectrogram path, so a pyramid column
+    // reads like a decimated run of ordinary columns.
+    window_.resize(N);
+    for (size_t i = 0; i < N; i++)
+        window_[i] = 0.5f * (1.0f - std::cos(Tau * i / (N - 1)));
+    // Plan here, on the caller's (GUI) thread, with the rest of the FFTW
+    // planning — only execution happens on the builder thread.
+    fft_.reset(new FFT(fftSize_));
+}
+
+void PowerPyramid::discard()
+{
+    discard_.store(true, std::memory_order_release);
+    cancel_.store(true, std::memory_order_release);
+}
+
+void PowerPyramid::run(std::shared_ptr<PowerPyramid> self, std::list<std::atomic<bool> *>::iterator entry)
+{
+    self->build();
+    {
+        std::lock_guard<std::mutex> lock(buildersMutex);
+        *entry = nullptr;
+    }
+    // Frees the pyramid here if its handle is already gone.
+    self.reset();
+    std::lock_guard<std::mutex> lock(buildersMutex);
+    builders.erase(entry);
+    buildersDone.notify_all();
+}
+
+void PowerPyramid::build()
+{
+    if (!load(path_) && !load(fallbackPath_))
+        built_.store(0, std::memory_order_release);
+    const size_t loaded = built_.load(std::memory_order_acquire);
+
+    const size_t N = static_cast<size_t>(fftSize_);
+    std::vector<std::complex<float>> buf(N);
+    std::vector<float> maxLin(N), sumLin(N);
+    QElapsedTimer sinceSave;
+    sinceSave.start();
+    size_t saved = loaded;
+
+    for (size_t col = loaded; col < levels_[0].cols; col++) {
+        if (cancel_.load(std::memory_order_acquire))
+            break;
+        if (!buildFinest(col, buf, maxLin, sumLin))
+            break;
+        // Complete every parent this column finishes, then publish: readers
+        // only look at columns below builtCols(), so they never see a
+        // half-written one.
+        for (size_t level = 1; level < levels_.size(); level++) {
+            const size_t span = size_t(1) << level;
+            if ((col + 1) % span != 0 || (col + 1) / span > levels_[level].cols)
+                break;
+            buildParent(level, (col + 1) / span - 1);
+        }
+        built_.store(col + 1, std::memory_order_release);
+
+        if (sinceSave.elapsed() > kSaveIntervalMs && !discard_.load(std::memory_order_acquire)) {
+            if (save(path_) || save(fallbackPath_))
+                saved = col + 1;
+            sinceSave.restart();
+        }
+    }
+
+    if (!discard_.load(std::memory_order_acquire) && built_.load(std::memory_order_acquire) != saved) {
+        if (!save(path_) && !save(fallbackPath_))
+            qDebug() << "pyramid: could not save" << path_ << "or" << fallbackPath_;
+    }
+}
+
+bool PowerPyramid::buildFinest(size_t col, std::vector<std::complex<float>> &buf,
+                               std::vector<float> &maxLin, std::vector<float> &sumLin)
+{
+    const size_t N = static_cast<size_t>(fftSize_);
+    const Level &finest = levels_[0];
+    const size_t frames = size_t(1) << finest.shift;
+    const float invN = 1.0f / N;
+    std::fill(maxLin.begin(), maxLin.end(), 0.0f);
+    std::fill(sumLin.begin(), sumLin.end(), 0.0f);
+
+    for (size_t f = 0; f < frames; f++) {
+        // A finest column can span thousands of frames, and a replaced
+        // pyramid should stop reading the source promptly.
+        if (cancel_.load(std::memory_order_acquire))
+            return false;
+        auto view = src_->getSampleView(((col << finest.shift) + f) * N, N);
+        if (!view)
+            return false;
+        for (size_t i = 0; i < N; i++)
+            buf[i] = view[i] * window_[i];
+        fft_->process(buf.data(), buf.data());
+        for (size_t i = 0; i < N; i++) {
+            // fftshift, as in the tile path: DC in the centre row
+            auto s = buf[i ^ (N >> 1)] * invN;
+            float power = s.real() * s.real() + s.imag() * s.imag();
+            maxLin[i] = std::max(maxLin[i], power);
+            sumLin[i] += power;
+        }
+    }
+
+    Level &level = levels_[0];
+    int16_t *maxOut = &level.maxDb[col * N];
+    int16_t *meanOut = &level.meanDb[col * N];
+    for (size_t i = 0; i < N; i++) {
+        maxOut[i] = encodeDb(linearToDb(maxLin[i]));
+        meanOut[i] = encodeDb(linearToDb(sumLin[i] / frames));
+    }
+    return true;
+}
+
+void PowerPyramid::buildParent(size_t level, size_t col)
+{
+    const size_t N = static_cast<size_t>(fftSize_);
+    const Level &child = levels_[level - 1];
+    Level &parent = levels_[level];
+    const int16_t *maxA = &child.maxDb[2 * col * N], *maxB = maxA + N;
+    const int16_t *meanA = &child.meanDb[2 * col * N], *meanB = meanA + N;
+    int16_t *maxOut = &parent.maxDb[col * N];
+    int16_t *meanOut = &parent.meanDb[col * N];
+    for (size_t i = 0; i < N; i++) {
+        maxOut[i] = std::max(maxA[i], maxB[i]);
+        meanOut[i] = encodeDb(linearToDb(0.5f * (dbToLinear(meanA[i]) + dbToLinear(meanB[i]))));
+    }
+}
+
+int PowerPyramid::levelFor(size_t stride) const
+{
+    // Coarsest level whose columns are no wider than the spectrogram's, so
+    // each output column combines one or two pyramid columns rather than
+    // skipping any.
+    int best = -1;
+    for (size_t l = 0; l < levels_.size(); l++) {
+        if ((static_cast<size_t>(fftSize_) << levels_[l].shift) > stride)
+            break;
+        best = static_cast<int>(l);
+    }
+    return best;
+}
+
+size_t PowerPyramid::builtCols(size_t level) const
+{
+    return std::min(levels_[level].cols, built_.load(std::memory_order_acquire) >> level);
+}
+
+PowerPyramid::Column PowerPyramid::column(size_t level, size_t s, size_t stride,
+                                          size_t &a, size_t &b) const
+{
+    // Past the end, where the raw path's centred frame can't be read either.
+    const size_t half = static_cast<size_t>(fftSize_) / 2;
+    if (s + half > count_)
+        return Empty;
+    const Level &l = levels_[level];
+    const size_t span = static_cast<size_t>(fftSize_) << l.shift;
+    a = s / span;
+    b = std::max(a + 1, (s + stride) / span);
+    b = std::min(b, l.cols);
+    // The tail beyond the last whole pyramid column, or not built yet.
+    if (a >= l.cols || b > builtCols(level))
+        return Uncovered;
+    return Covered;
+}
+
+bool PowerPyramid::covers(size_t firstSample, size_t stride, int cols) const
+{
+    const int level = levelFor(stride);
+    if (level < 0 || cols <= 0)
+        return false;
+    // Columns only move forward, so if every non-empty one is covered the
+    // last non-empty one is; walk back past any trailing empties.
+    for (int c = cols - 1; c >= 0; c--) {
+        size_t a, b;
+        switch (column(level, firstSample + static_cast<size_t>(c) * stride, stride, a, b)) {
+        case Empty:     continue;
+        case Covered:   return true;
+        case Uncovered: return false;
+        }
+    }
+    return true;
+}
+
+bool PowerPyramid::fill(float *dest, size_t firstSample, size_t stride, int cols, Stat stat) const
+{
+    if (!covers(firstSample, stride, cols))
+        return false;
+    const int level = levelFor(stride);
+    const size_t N = static_cast<size_t>(fftSize_);
+    const Level &l = levels_[level];
+    const std::vector<int16_t> &src = (stat == Max) ? l.maxDb : l.meanDb;
+
+    for (int c = 0; c < cols; c++) {
+        float *out = dest + static_cast<size_t>(c) * N;
+        size_t a = 0, b = 0;
+        if (column(level, firstSample + static_cast<size_t>(c) * stride, stride, a, b) != Covered) {
+            std::fill(out, out + N, -std::numeric_limits<float>::infinity());
+            continue;
+        }
+        if (stat == Max) {
+            for (size_t i = 0; i < N; i++) {
+                int16_t m = src[a * N + i];
+                for (size_t k = a + 1; k < b; k++)
+                    m = std::max(m, src[k * N + i]);
+                out[i] = decodeDb(m);
+            }
+        } else {
+            const float inv = 1.0f / (b - a);
+            for (size_t i = 0; i < N; i++) {
+                float sum = 0.0f;
+                for (size_t k = a; k < b; k++)
+                    sum += dbToLinear(src[k * N + i]);
+                out[i] = linearToDb(sum * inv);
+            }
+        }
+    }
+    return true;
+}
+
+bool PowerPyramid::load(const QString &path)
+{
+    if (path.isEmpty())
+        return false;
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    char magic[4];
+    uint32_t version = 0, fftSize = 0, shift = 0;
+    uint64_t count = 0, built = 0;
+    if (f.read(magic, 4) != 4 || memcmp(magic, kPyramidMagic, 4) != 0)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&version), sizeof(version)) != sizeof(version) ||
+        version != kPyramidVersion)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&fftSize), sizeof(fftSize)) != sizeof(fftSize) ||
+        fftSize != static_cast<uint32_t>(fftSize_))
+        return false;
+    if (f.read(reinterpret_cast<char*>(&shift), sizeof(shift)) != sizeof(shift) ||
+        shift != static_cast<uint32_t>(levels_[0].shift))
+        return false;
+    if (f.read(reinterpret_cast<char*>(&count), sizeof(count)) != sizeof(count) ||
+        count != count_)
+        return false;
+    const QByteArray key = f.read(key_.size());
+    if (key != key_)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&built), sizeof(built)) != sizeof(built) ||
+        built > levels_[0].cols)
+        return false;
+
+    for (Level &l : levels_) {
+        const qint64 bytes = static_cast<qint64>(l.maxDb.size() * sizeof(int16_t));
+        if (f.read(reinterpret_cast<char*>(l.maxDb.data()), bytes) != bytes ||
+            f.read(reinterpret_cast<char*>(l.meanDb.data()), bytes) != bytes)
+            return false;
+    }
+    built_.store(static_cast<size_t>(built), std::memory_order_release);
+    return true;
+}
+
+bool PowerPyramid::save(const QString &path) const
+{
+    if (path.isEmpty())
+        return false;
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    const uint32_t fftSize = static_cast<uint32_t>(fftSize_);
+    const uint32_t shift = static_cast<uint32_t>(levels_[0].shift);
+    const uint64_t count = count_;
+    const uint64_t built = built_.load(std::memory_order_acquire);
+    f.write(kPyramidMagic, 4);
+    f.write(reinterpret_cast<const char*>(&kPyramidVersion), sizeof(kPyramidVersion));
+    f.write(reinterpret_cast<const char*>(&fftSize), sizeof(fftSize));
+    f.write(reinterpret_cast<const char*>(&shift), sizeof(shift));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    f.write(key_);
+    f.write(reinterpret_cast<const char*>(&built), sizeof(built));
+    for (const Level &l : levels_) {
+        const qint64 bytes = static_cast<qint64>(l.maxDb.size() * sizeof(int16_t));
+        f.write(reinterpret_cast<const char*>(l.maxDb.data()), bytes);
+        f.write(reinterpret_cast<const char*>(l.meanDb.data()), bytes);
+    }
+    return f.commit();
+}
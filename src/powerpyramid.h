@@ -0,0 +1,138 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+#include "fft.h"
+#include "samplesource.h"
+
+// Precomputed multi-resolution power overview for one FFT size.
+//
+// Fully zoomed out on a multi-hour capture, every spectrogram column still
+// costs one FFT straight from raw IQ, so the overview is slow and cold every
+// session. The pyramid stores, per level, one column per 2^shift adjacent
+// non-overlapping N-sample frames: both the max (peak-hold, so short bursts
+// survive decimation) and the mean of the per-bin linear power, as dB.
+// Level shifts run from `finestShift` (chosen so the finest level stays
+// within kFinestValues bins) up by one per level, each level derived from
+// the one below.
+//
+// It's built incrementally on its own thread, finest column by finest
+// column, and every completed column is immediately usable — covers() /
+// fill() only answer for ranges that are already built. Progress is saved
+// to a sidecar (with a cache-dir fallback when that isn't writable) keyed
+// on the source's identity, so a later session picks up where this one
+// stopped and whole-file scrolling is free from then on.
+//
+// Releasing the pyramid only tells the builder to stop: it finishes the
+// column (or sidecar load) it's in and the final save on its own thread,
+// and the pyramid is freed when that's done. The GUI thread, which drops
+// the old pyramid at every FFT size change, never waits on the file.
+class PowerPyramid
+{
+public:
+    enum Stat { Max = 0, Mean = 1 };
+
+    // Bins in the finest level (per statistic). 4M × int16 = 8 MB; all the
+    // coarser levels together add as much again.
+    static constexpr size_t kFinestValues = 4u << 20;
+    // Captures shorter than this many frames aren't worth an overview:
+    // computing their zoomed-out tiles from raw IQ is already fast.
+    static constexpr size_t kMinFrames = 1u << 14;
+
+    // `key` identifies the source contents (format, length, file stamp); a
+    // saved pyramid with a different key is ignored and rebuilt. `path` is
+    // the preferred sidecar; a per-path file under the app cache dir is used
+    // when it can't be written. Returns nullptr when the source is too short
+    // to bother.
+    static std::shared_ptr<PowerPyramid> create(std::shared_ptr<SampleSource<std::complex<float>>> src,
+                                                int fftSize, const QByteArray &key,
+                                                const QString &path);
+    // Stops every builder still running and waits for their final saves.
+    // For exit, after the event loop has returned.
+    static void finishAll();
+
+    // The source changed under us: stop building and don't persist, since
+    // the last columns may have been computed from the new contents.
+    void discard();
+
+    int fftSize() const { return fftSize_; }
+    const QByteArray &key() const { return key_; }
+    bool complete() const { return built_.load(std::memory_order_acquire) >= levels_[0].cols; }
+
+    // True if `cols` spectrogram columns, `stride` samples apart starting at
+    // `firstSample`, can be served from already-built levels.
+    bool covers(size_t firstSample, size_t stride, int cols) const;
+    // Fill cols × fftSize dB values (same layout as a spectrogram FFT tile).
+    // Returns false, leaving dest untouched, if !covers().
+    bool fill(float *dest, size_t firstSample, size_t stride, int cols, Stat stat) const;
+
+private:
+    struct Level {
+        int shift;                     // frames per column = 1 << shift
+        size_t cols;
+        std::vector<int16_t> maxDb;    // cols × fftSize, centi-dB
+        std::vector<int16_t> meanDb;
+    };
+
+    PowerPyramid(std::shared_ptr<SampleSource<std::complex<float>>> src, int fftSize,
+                 size_t count, int finestShift, const QByteArray &key,
+                 const QString &path, const QString &fallbackPath);
+    // Builder thread body. `self` keeps the pyramid alive until it ends;
+    // `entry` is its slot in the running-builders list.
+    static void run(std::shared_ptr<PowerPyramid> self, std::list<std::atomic<bool> *>::iterator entry);
+    void build();
+    bool load(const QString &path);
+    bool save(const QString &path) const;
+    // False if the source couldn't supply the column's samples.
+    bool buildFinest(size_t col, std::vector<std::complex<float>> &buf,
+                     std::vector<float> &maxLin, std::vector<float> &sumLin);
+    void buildParent(size_t level, size_t col);
+    // Level to read for a given column stride, or -1 if stride is finer than
+    // the finest level.
+    int levelFor(size_t stride) const;
+    // Columns of `level` complete given the current finest-level progress.
+    size_t builtCols(size_t level) const;
+    // Where the spectrogram column starting at sample `s` comes from.
+    enum Column { Empty, Covered, Uncovered };
+    Column column(size_t level, size_t s, size_t stride, size_t &a, size_t &b) const;
+
+    std::shared_ptr<SampleSource<std::complex<float>>> src_;
+    const int fftSize_;
+    const size_t count_;               // source samples
+    const size_t frames_;              // whole N-sample frames in the source
+    const QByteArray key_;
+    const QString path_;
+    const QString fallbackPath_;
+    std::vector<Level> levels_;
+    std::unique_ptr<FFT> fft_;
+    std::vector<float> window_;
+
+    std::atomic<size_t> built_{0};     // finest-level columns complete
+    std::atomic<bool> cancel_{false};
+    std::atomic<bool> discard_{false};
+};
@@ -53,6 +53,9 @@ public:
     virtual size_t count() {
         return src->count();
     };
+    size_t decimation() override {
+        return src->decimation();
+    }
     double rate() {
         return src->rate();
     };
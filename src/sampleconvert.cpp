@@ -0,0 +1,1068 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "sampleconvert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAMPLECONVERT_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SAMPLECONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace sampleconvert {
+
+namespace {
+
+// ---------------------------------------------------------------------------
+// Scalar reference. Also used for the tails of every SIMD kernel, so the last
+// few samples of a range come out identical whichever path ran the body.
+
+void s16Scalar(const int16_t *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = src[i] * kS16Scale;
+}
+
+void s8Scalar(const int8_t *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = src[i] * kS8Scale;
+}
+
+void u8Scalar(const uint8_t *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = (src[i] - kU8Offset) * kS8Scale;
+}
+
+void s16RealScalar(const int16_t *src, size_t n, std::complex<float> *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = { src[i] * kS16Scale, 0.0f };
+}
+
+void s8RealScalar(const int8_t *src, size_t n, std::complex<float> *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = { src[i] * kS8Scale, 0.0f };
+}
+
+void u8RealScalar(const uint8_t *src, size_t n, std::complex<float> *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = { (src[i] - kU8Offset) * kS8Scale, 0.0f };
+}
+
+void f32RealScalar(const float *src, size_t n, std::complex<float> *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = { src[i], 0.0f };
+}
+
+void windowScalar(const std::complex<float> *src, const float *w, size_t n,
+                  std::complex<float> *dst)
+{
+    const float *in = reinterpret_cast<const float*>(src);
+    float *out = reinterpret_cast<float*>(dst);
+    for (size_t i = 0; i < n; i++) {
+        out[2 * i]     = in[2 * i] * w[i];
+        out[2 * i + 1] = in[2 * i + 1] * w[i];
+    }
+}
+
+void windowRealScalar(const std::complex<float> *src, const float *w, size_t n, float *dst)
+{
+    const float *in = reinterpret_cast<const float*>(src);
+    for (size_t i = 0; i < n; i++)
+        dst[i] = in[2 * i] * w[i];
+}
+
+// max(lo, NaN) is lo, so NaN packs to the bottom of the range. lrintf
+// rounds to nearest even, as cvtps2dq / vcvtnq do.
+inline int16_t encodeDbOne(float v)
+{
+    float x = v * kDbScale;
+    x = std::min(32767.0f, std::max(-32768.0f, x));
+    return static_cast<int16_t>(std::lrintf(x));
+}
+
+void encodeDbScalar(const float *src, size_t n, int16_t *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = encodeDbOne(src[i]);
+}
+
+void decodeDbScalar(const int16_t *src, size_t n, float *dst)
+{
+    for (size_t i = 0; i < n; i++)
+        dst[i] = src[i] * kDbStep;
+}
+
+// Power index for one packed dB value: the expression getPixmapTile always
+// used for its colormap index, applied to the decoded value.
+inline uint8_t powerIndex(int16_t q, float powerMax, float powerScale)
+{
+    float norm = (q * kDbStep - powerMax) * powerScale;
+    norm = std::min(1.0f, std::max(0.0f, norm));
+    return static_cast<uint8_t>(norm * (256 - 1));
+}
+
+void powerIndexRunScalar(const int16_t *src, int n, float powerMax, float powerScale, uint8_t *dst)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = powerIndex(src[i], powerMax, powerScale);
+}
+
+// The tile is column-major and the image row-major, so walking either one
+// in order strides through the other. Work in kIndexBlock-square blocks
+// instead: indices down kIndexBlock columns, then out along kIndexBlock
+// rows, both within a few KiB. `run` is the per-ISA index kernel for one
+// stretch of a column.
+const int kIndexBlock = 32;
+
+template<typename RunFn>
+void powerIndexBlocked(const int16_t *tile, int size, int cols, int rows,
+                       float powerMax, float powerScale,
+                       uint8_t *dst, ptrdiff_t dstStride, RunFn run)
+{
+    uint8_t idx[kIndexBlock][kIndexBlock];   // [column][bin]
+    for (int y0 = size - rows; y0 < size; y0 += kIndexBlock) {
+        const int ny = std::min(kIndexBlock, size - y0);
+        for (int x0 = 0; x0 < cols; x0 += kIndexBlock) {
+            const int nx = std::min(kIndexBlock, cols - x0);
+            for (int i = 0; i < nx; i++)
+                run(tile + static_cast<size_t>(x0 + i) * size + y0, ny, powerMax, powerScale, idx[i]);
+            for (int j = 0; j < ny; j++) {
+                uint8_t *row = dst + (size - 1 - (y0 + j)) * dstStride + x0;
+                for (int i = 0; i < nx; i++)
+                    row[i] = idx[i][j];
+            }
+        }
+    }
+}
+
+void powerIndexScalar(const int16_t *tile, int size, int cols, int rows,
+                      float powerMax, float powerScale, uint8_t *dst, ptrdiff_t dstStride)
+{
+    powerIndexBlocked(tile, size, cols, rows, powerMax, powerScale, dst, dstStride,
+                      powerIndexRunScalar);
+}
+
+void reassignScalar(const std::complex<float> *xh, const std::complex<float> *xth,
+                    const std::complex<float> *xdh, size_t n, float powerScale, float floorPower,
+                    float colScale, float binScale, float *power, float *dCol, float *dBin)
+{
+    for (size_t i = 0; i < n; i++) {
+        const float re = xh[i].real(), im = xh[i].imag();
+        const float mag2 = re * re + im * im;
+        const float p = mag2 * powerScale;
+        // Written so NaN power is kept, as the old per-bin test did.
+        const bool keep = !(p < floorPower) && mag2 != 0.0f;
+        const float inv = 1.0f / mag2;
+        const float t = (xth[i].real() * re + xth[i].imag() * im) * inv;   // Re{X_th / X_h}
+        const float w = (xdh[i].imag() * re - xdh[i].real() * im) * inv;   // Im{X_dh / X_h}
+        power[i] = p;
+        dCol[i] = keep ? t * colScale : 0.0f;
+        dBin[i] = keep ? w * binScale : 0.0f;
+    }
+}
+
+const Kernels scalarKernels = {
+    Isa::Scalar,
+    s16Scalar, s8Scalar, u8Scalar,
+    s16RealScalar, s8RealScalar, u8RealScalar, f32RealScalar,
+    windowScalar, windowRealScalar,
+    encodeDbScalar, decodeDbScalar, powerIndexScalar,
+    reassignScalar,
+};
+
+#ifdef SAMPLECONVERT_X86
+// ---------------------------------------------------------------------------
+// SSE4.1: pmovsx/pmovzx do the widening in one instruction per 4 lanes.
+
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+
+TARGET_SSE41 static inline void storeRealSse(float *dst, __m128 v)
+{
+    const __m128 zero = _mm_setzero_ps();
+    _mm_storeu_ps(dst,     _mm_unpacklo_ps(v, zero));
+    _mm_storeu_ps(dst + 4, _mm_unpackhi_ps(v, zero));
+}
+
+TARGET_SSE41 void s16Sse41(const int16_t *src, size_t n, float *dst)
+{
+    const __m128 k = _mm_set1_ps(kS16Scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_cvtepi16_epi32(v);
+        __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(v, 8));
+        _mm_storeu_ps(dst + i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    s16Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void s8Sse41(const int8_t *src, size_t n, float *dst)
+{
+    const __m128 k = _mm_set1_ps(kS8Scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int q = 0; q < 4; q++) {
+            __m128i w = _mm_cvtepi8_epi32(v);
+            _mm_storeu_ps(dst + i + q * 4, _mm_mul_ps(_mm_cvtepi32_ps(w), k));
+            v = _mm_srli_si128(v, 4);
+        }
+    }
+    s8Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void u8Sse41(const uint8_t *src, size_t n, float *dst)
+{
+    const __m128 k = _mm_set1_ps(kS8Scale);
+    const __m128 off = _mm_set1_ps(kU8Offset);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int q = 0; q < 4; q++) {
+            __m128i w = _mm_cvtepu8_epi32(v);
+            __m128 f = _mm_sub_ps(_mm_cvtepi32_ps(w), off);
+            _mm_storeu_ps(dst + i + q * 4, _mm_mul_ps(f, k));
+            v = _mm_srli_si128(v, 4);
+        }
+    }
+    u8Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void s16RealSse41(const int16_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m128 k = _mm_set1_ps(kS16Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i lo = _mm_cvtepi16_epi32(v);
+        __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(v, 8));
+        storeRealSse(out + 2 * i,     _mm_mul_ps(_mm_cvtepi32_ps(lo), k));
+        storeRealSse(out + 2 * i + 8, _mm_mul_ps(_mm_cvtepi32_ps(hi), k));
+    }
+    s16RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void s8RealSse41(const int8_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m128 k = _mm_set1_ps(kS8Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int q = 0; q < 4; q++) {
+            __m128i w = _mm_cvtepi8_epi32(v);
+            storeRealSse(out + 2 * (i + q * 4), _mm_mul_ps(_mm_cvtepi32_ps(w), k));
+            v = _mm_srli_si128(v, 4);
+        }
+    }
+    s8RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void u8RealSse41(const uint8_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m128 k = _mm_set1_ps(kS8Scale);
+    const __m128 off = _mm_set1_ps(kU8Offset);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        for (int q = 0; q < 4; q++) {
+            __m128i w = _mm_cvtepu8_epi32(v);
+            __m128 f = _mm_sub_ps(_mm_cvtepi32_ps(w), off);
+            storeRealSse(out + 2 * (i + q * 4), _mm_mul_ps(f, k));
+            v = _mm_srli_si128(v, 4);
+        }
+    }
+    u8RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void f32RealSse41(const float *src, size_t n, std::complex<float> *dst)
+{
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        storeRealSse(out + 2 * i, _mm_loadu_ps(src + i));
+    f32RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void windowSse41(const std::complex<float> *src, const float *w, size_t n,
+                              std::complex<float> *dst)
+{
+    // Duplicate each window tap across its I/Q pair: w0 w0 w1 w1 | w2 w2 w3 w3.
+    const float *in = reinterpret_cast<const float*>(src);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 wv = _mm_loadu_ps(w + i);
+        _mm_storeu_ps(out + 2 * i,     _mm_mul_ps(_mm_loadu_ps(in + 2 * i),     _mm_unpacklo_ps(wv, wv)));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_mul_ps(_mm_loadu_ps(in + 2 * i + 4), _mm_unpackhi_ps(wv, wv)));
+    }
+    windowScalar(src + i, w + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void windowRealSse41(const std::complex<float> *src, const float *w, size_t n,
+                                  float *dst)
+{
+    // Pick the even (I) lanes of two loads: r0 r1 r2 r3.
+    const float *in = reinterpret_cast<const float*>(src);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 re = _mm_shuffle_ps(_mm_loadu_ps(in + 2 * i), _mm_loadu_ps(in + 2 * i + 4),
+                                   _MM_SHUFFLE(2, 0, 2, 0));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(re, _mm_loadu_ps(w + i)));
+    }
+    windowRealScalar(src + i, w + i, n - i, dst + i);
+}
+
+// Four packed tile values as dB. A plain function rather than part of the
+// lambda below: lambdas don't inherit the target attribute, and pmovsxwd is
+// SSE4.1.
+TARGET_SSE41 static inline __m128 loadDbSse41(const int16_t *p)
+{
+    __m128i q = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+    return _mm_mul_ps(_mm_cvtepi32_ps(q), _mm_set1_ps(kDbStep));
+}
+
+TARGET_SSE41 void encodeDbSse41(const float *src, size_t n, int16_t *dst)
+{
+    // Same clamp order as the scalar code: maxps returns its second operand
+    // for NaN.
+    const __m128 scale = _mm_set1_ps(kDbScale);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    auto pack = [&](const float *p) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(p), scale);
+        return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(x, lo), hi));
+    };
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(pack(src + i), pack(src + i + 4)));
+    encodeDbScalar(src + i, n - i, dst + i);
+}
+
+TARGET_SSE41 void decodeDbSse41(const int16_t *src, size_t n, float *dst)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(dst + i, loadDbSse41(src + i));
+    decodeDbScalar(src + i, n - i, dst + i);
+}
+
+// Clamp order matters for NaN: maxps returns its second operand when either
+// is NaN, so max(x, 0) maps NaN to 0 like the scalar std::max(0, x).
+TARGET_SSE41 void powerIndexRunSse41(const int16_t *src, int n, float powerMax, float powerScale,
+                                     uint8_t *dst)
+{
+    const __m128 vMax = _mm_set1_ps(powerMax);
+    const __m128 vScale = _mm_set1_ps(powerScale);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 top = _mm_set1_ps(256 - 1);
+    auto index = [&](const int16_t *p) {
+        __m128 norm = _mm_mul_ps(_mm_sub_ps(loadDbSse41(p), vMax), vScale);
+        norm = _mm_min_ps(_mm_max_ps(norm, zero), one);
+        return _mm_cvttps_epi32(_mm_mul_ps(norm, top));
+    };
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i words = _mm_packus_epi32(index(src + i), index(src + i + 4));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+    }
+    powerIndexRunScalar(src + i, n - i, powerMax, powerScale, dst + i);
+}
+
+TARGET_SSE41 void powerIndexSse41(const int16_t *tile, int size, int cols, int rows,
+                                  float powerMax, float powerScale, uint8_t *dst, ptrdiff_t dstStride)
+{
+    powerIndexBlocked(tile, size, cols, rows, powerMax, powerScale, dst, dstStride,
+                      powerIndexRunSse41);
+}
+
+// Real and imaginary parts of four interleaved complex values.
+TARGET_SSE41 static inline void deinterleaveSse(const std::complex<float> *src, __m128 &re, __m128 &im)
+{
+    const float *p = reinterpret_cast<const float*>(src);
+    __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p + 4);
+    re = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    im = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+TARGET_SSE41 void reassignSse41(const std::complex<float> *xh, const std::complex<float> *xth,
+                                const std::complex<float> *xdh, size_t n, float powerScale, float floorPower,
+                                float colScale, float binScale, float *power, float *dCol, float *dBin)
+{
+    // cmpnlt is true for NaN and cmpneq is true against NaN, like the
+    // scalar tests; the and-mask yields +0.0 as the scalar select does.
+    const __m128 vPowerScale = _mm_set1_ps(powerScale);
+    const __m128 vFloor = _mm_set1_ps(floorPower);
+    const __m128 vCol = _mm_set1_ps(colScale);
+    const __m128 vBin = _mm_set1_ps(binScale);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 re, im, thRe, thIm, dhRe, dhIm;
+        deinterleaveSse(xh + i, re, im);
+        deinterleaveSse(xth + i, thRe, thIm);
+        deinterleaveSse(xdh + i, dhRe, dhIm);
+        __m128 mag2 = _mm_add_ps(_mm_mul_ps(re, re), _mm_mul_ps(im, im));
+        __m128 p = _mm_mul_ps(mag2, vPowerScale);
+        __m128 keep = _mm_and_ps(_mm_cmpnlt_ps(p, vFloor), _mm_cmpneq_ps(mag2, zero));
+        __m128 inv = _mm_div_ps(one, mag2);
+        __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(thRe, re), _mm_mul_ps(thIm, im)), inv);
+        __m128 w = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(dhIm, re), _mm_mul_ps(dhRe, im)), inv);
+        _mm_storeu_ps(power + i, p);
+        _mm_storeu_ps(dCol + i, _mm_and_ps(keep, _mm_mul_ps(t, vCol)));
+        _mm_storeu_ps(dBin + i, _mm_and_ps(keep, _mm_mul_ps(w, vBin)));
+    }
+    reassignScalar(xh + i, xth + i, xdh + i, n - i, powerScale, floorPower, colScale, binScale,
+                   power + i, dCol + i, dBin + i);
+}
+
+const Kernels sse41Kernels = {
+    Isa::SSE41,
+    s16Sse41, s8Sse41, u8Sse41,
+    s16RealSse41, s8RealSse41, u8RealSse41, f32RealSse41,
+    windowSse41, windowRealSse41,
+    encodeDbSse41, decodeDbSse41, powerIndexSse41,
+    reassignSse41,
+};
+
+// ---------------------------------------------------------------------------
+// AVX2: 8 lanes per convert. The zero-interleave for the real formats has to
+// undo unpack's per-128-bit-lane behaviour with a cross-lane permute.
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2 static inline void storeRealAvx(float *dst, __m256 v)
+{
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 lo = _mm256_unpacklo_ps(v, zero);   // a0 0 a1 0 | a4 0 a5 0
+    __m256 hi = _mm256_unpackhi_ps(v, zero);   // a2 0 a3 0 | a6 0 a7 0
+    _mm256_storeu_ps(dst,     _mm256_permute2f128_ps(lo, hi, 0x20));
+    _mm256_storeu_ps(dst + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+}
+
+TARGET_AVX2 void s16Avx2(const int16_t *src, size_t n, float *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS16Scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+        _mm256_storeu_ps(dst + i,     _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(a)), k));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(b)), k));
+    }
+    s16Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void s8Avx2(const int8_t *src, size_t n, float *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS8Scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_cvtepi8_epi32(v);
+        __m256i hi = _mm256_cvtepi8_epi32(_mm_srli_si128(v, 8));
+        _mm256_storeu_ps(dst + i,     _mm256_mul_ps(_mm256_cvtepi32_ps(lo), k));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), k));
+    }
+    s8Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void u8Avx2(const uint8_t *src, size_t n, float *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS8Scale);
+    const __m256 off = _mm256_set1_ps(kU8Offset);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+        _mm256_storeu_ps(dst + i,     _mm256_mul_ps(_mm256_sub_ps(lo, off), k));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_sub_ps(hi, off), k));
+    }
+    u8Scalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void s16RealAvx2(const int16_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS16Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        storeRealAvx(out + 2 * i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), k));
+    }
+    s16RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void s8RealAvx2(const int8_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS8Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256i lo = _mm256_cvtepi8_epi32(v);
+        __m256i hi = _mm256_cvtepi8_epi32(_mm_srli_si128(v, 8));
+        storeRealAvx(out + 2 * i,      _mm256_mul_ps(_mm256_cvtepi32_ps(lo), k));
+        storeRealAvx(out + 2 * i + 16, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), k));
+    }
+    s8RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void u8RealAvx2(const uint8_t *src, size_t n, std::complex<float> *dst)
+{
+    const __m256 k = _mm256_set1_ps(kS8Scale);
+    const __m256 off = _mm256_set1_ps(kU8Offset);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m256 lo = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+        __m256 hi = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(v, 8)));
+        storeRealAvx(out + 2 * i,      _mm256_mul_ps(_mm256_sub_ps(lo, off), k));
+        storeRealAvx(out + 2 * i + 16, _mm256_mul_ps(_mm256_sub_ps(hi, off), k));
+    }
+    u8RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void f32RealAvx2(const float *src, size_t n, std::complex<float> *dst)
+{
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        storeRealAvx(out + 2 * i, _mm256_loadu_ps(src + i));
+    f32RealScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void windowAvx2(const std::complex<float> *src, const float *w, size_t n,
+                            std::complex<float> *dst)
+{
+    // Same per-128-bit-lane unpack problem as storeRealAvx, solved the same
+    // way: duplicate within lanes, then stitch the halves back in order.
+    const float *in = reinterpret_cast<const float*>(src);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 wv = _mm256_loadu_ps(w + i);
+        __m256 lo = _mm256_unpacklo_ps(wv, wv);   // w0 w0 w1 w1 | w4 w4 w5 w5
+        __m256 hi = _mm256_unpackhi_ps(wv, wv);   // w2 w2 w3 w3 | w6 w6 w7 w7
+        _mm256_storeu_ps(out + 2 * i,
+                         _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i), _mm256_permute2f128_ps(lo, hi, 0x20)));
+        _mm256_storeu_ps(out + 2 * i + 8,
+                         _mm256_mul_ps(_mm256_loadu_ps(in + 2 * i + 8), _mm256_permute2f128_ps(lo, hi, 0x31)));
+    }
+    windowScalar(src + i, w + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void windowRealAvx2(const std::complex<float> *src, const float *w, size_t n,
+                                float *dst)
+{
+    // shuffle_ps picks the I lanes per 128-bit half (r0 r1 r4 r5 | r2 r3 r6 r7);
+    // a 64-bit lane permute puts them back in order.
+    const float *in = reinterpret_cast<const float*>(src);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 re = _mm256_shuffle_ps(_mm256_loadu_ps(in + 2 * i), _mm256_loadu_ps(in + 2 * i + 8),
+                                      _MM_SHUFFLE(2, 0, 2, 0));
+        re = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(re), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(re, _mm256_loadu_ps(w + i)));
+    }
+    windowRealScalar(src + i, w + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void encodeDbAvx2(const float *src, size_t n, int16_t *dst)
+{
+    const __m256 scale = _mm256_set1_ps(kDbScale);
+    const __m256 lo = _mm256_set1_ps(-32768.0f);
+    const __m256 hi = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256i q = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(x, lo), hi));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                         _mm_packs_epi32(_mm256_castsi256_si128(q), _mm256_extracti128_si256(q, 1)));
+    }
+    _mm256_zeroupper();   // see powerIndexRunAvx2
+    encodeDbScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void decodeDbAvx2(const int16_t *src, size_t n, float *dst)
+{
+    const __m256 step = _mm256_set1_ps(kDbStep);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i q = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(q), step));
+    }
+    _mm256_zeroupper();
+    decodeDbScalar(src + i, n - i, dst + i);
+}
+
+TARGET_AVX2 void powerIndexRunAvx2(const int16_t *src, int n, float powerMax, float powerScale,
+                                   uint8_t *dst)
+{
+    // Same clamp order as powerIndexRunSse41, for the same NaN reason.
+    const __m256 step = _mm256_set1_ps(kDbStep);
+    const __m256 vMax = _mm256_set1_ps(powerMax);
+    const __m256 vScale = _mm256_set1_ps(powerScale);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 top = _mm256_set1_ps(256 - 1);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i q = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(q), step);
+        __m256 norm = _mm256_mul_ps(_mm256_sub_ps(v, vMax), vScale);
+        norm = _mm256_min_ps(_mm256_max_ps(norm, zero), one);
+        __m256i idx = _mm256_cvttps_epi32(_mm256_mul_ps(norm, top));
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(idx), _mm256_extracti128_si256(idx, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+    }
+    // The caller's block loop is plain SSE code; going back to it with the
+    // upper halves dirty costs far more than this whole run (GCC doesn't
+    // insert the vzeroupper before the tail call on its own).
+    _mm256_zeroupper();
+    powerIndexRunScalar(src + i, n - i, powerMax, powerScale, dst + i);
+}
+
+TARGET_AVX2 void powerIndexAvx2(const int16_t *tile, int size, int cols, int rows,
+                                float powerMax, float powerScale, uint8_t *dst, ptrdiff_t dstStride)
+{
+    powerIndexBlocked(tile, size, cols, rows, powerMax, powerScale, dst, dstStride,
+                      powerIndexRunAvx2);
+}
+
+// As deinterleaveSse, for eight values. The shuffle works within 128-bit
+// lanes, so both halves come out in bin order 0 1 4 5 2 3 6 7; every input
+// gets the same order, so only the results need putting back.
+TARGET_AVX2 static inline void deinterleaveAvx(const std::complex<float> *src, __m256 &re, __m256 &im)
+{
+    const float *p = reinterpret_cast<const float*>(src);
+    __m256 a = _mm256_loadu_ps(p), b = _mm256_loadu_ps(p + 8);
+    re = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+    im = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+TARGET_AVX2 static inline void storeBinOrderAvx(float *dst, __m256 v)
+{
+    _mm256_storeu_ps(dst, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(v), 0xd8)));
+}
+
+TARGET_AVX2 void reassignAvx2(const std::complex<float> *xh, const std::complex<float> *xth,
+                              const std::complex<float> *xdh, size_t n, float powerScale, float floorPower,
+                              float colScale, float binScale, float *power, float *dCol, float *dBin)
+{
+    // Same masks as reassignSse41, for the same NaN reasons.
+    const __m256 vPowerScale = _mm256_set1_ps(powerScale);
+    const __m256 vFloor = _mm256_set1_ps(floorPower);
+    const __m256 vCol = _mm256_set1_ps(colScale);
+    const __m256 vBin = _mm256_set1_ps(binScale);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 re, im, thRe, thIm, dhRe, dhIm;
+        deinterleaveAvx(xh + i, re, im);
+        deinterleaveAvx(xth + i, thRe, thIm);
+        deinterleaveAvx(xdh + i, dhRe, dhIm);
+        __m256 mag2 = _mm256_add_ps(_mm256_mul_ps(re, re), _mm256_mul_ps(im, im));
+        __m256 p = _mm256_mul_ps(mag2, vPowerScale);
+        __m256 keep = _mm256_and_ps(_mm256_cmp_ps(p, vFloor, _CMP_NLT_UQ),
+                                    _mm256_cmp_ps(mag2, zero, _CMP_NEQ_UQ));
+        __m256 inv = _mm256_div_ps(one, mag2);
+        __m256 t = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(thRe, re), _mm256_mul_ps(thIm, im)), inv);
+        __m256 w = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(dhIm, re), _mm256_mul_ps(dhRe, im)), inv);
+        storeBinOrderAvx(power + i, p);
+        storeBinOrderAvx(dCol + i, _mm256_and_ps(keep, _mm256_mul_ps(t, vCol)));
+        storeBinOrderAvx(dBin + i, _mm256_and_ps(keep, _mm256_mul_ps(w, vBin)));
+    }
+    _mm256_zeroupper();   // see powerIndexRunAvx2
+    reassignScalar(xh + i, xth + i, xdh + i, n - i, powerScale, floorPower, colScale, binScale,
+                   power + i, dCol + i, dBin + i);
+}
+
+const Kernels avx2Kernels = {
+    Isa::AVX2,
+    s16Avx2, s8Avx2, u8Avx2,
+    s16RealAvx2, s8RealAvx2, u8RealAvx2, f32RealAvx2,
+    windowAvx2, windowRealAvx2,
+    encodeDbAvx2, decodeDbAvx2, powerIndexAvx2,
+    reassignAvx2,
+};
+
+#undef TARGET_SSE41
+#undef TARGET_AVX2
+#endif // SAMPLECONVERT_X86
+
+#ifdef SAMPLECONVERT_NEON
+// ---------------------------------------------------------------------------
+// NEON: widen with vmovl, convert, and let vst2q do the zero-interleave for
+// the real formats. NEON is baseline on aarch64, so no runtime check.
+
+inline void s16x8Neon(int16x8_t v, float32x4_t k, float32x4_t &lo, float32x4_t &hi)
+{
+    lo = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), k);
+    hi = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), k);
+}
+
+inline void u16x8Neon(uint16x8_t v, float32x4_t off, float32x4_t k,
+                      float32x4_t &lo, float32x4_t &hi)
+{
+    lo = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))), off), k);
+    hi = vmulq_f32(vsubq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))), off), k);
+}
+
+void s16Neon(const int16_t *src, size_t n, float *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS16Scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo, hi;
+        s16x8Neon(vld1q_s16(src + i), k, lo, hi);
+        vst1q_f32(dst + i, lo);
+        vst1q_f32(dst + i + 4, hi);
+    }
+    s16Scalar(src + i, n - i, dst + i);
+}
+
+void s8Neon(const int8_t *src, size_t n, float *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS8Scale);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vld1q_s8(src + i);
+        float32x4_t a, b, c, d;
+        s16x8Neon(vmovl_s8(vget_low_s8(v)), k, a, b);
+        s16x8Neon(vmovl_s8(vget_high_s8(v)), k, c, d);
+        vst1q_f32(dst + i, a);
+        vst1q_f32(dst + i + 4, b);
+        vst1q_f32(dst + i + 8, c);
+        vst1q_f32(dst + i + 12, d);
+    }
+    s8Scalar(src + i, n - i, dst + i);
+}
+
+void u8Neon(const uint8_t *src, size_t n, float *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS8Scale);
+    const float32x4_t off = vdupq_n_f32(kU8Offset);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        float32x4_t a, b, c, d;
+        u16x8Neon(vmovl_u8(vget_low_u8(v)), off, k, a, b);
+        u16x8Neon(vmovl_u8(vget_high_u8(v)), off, k, c, d);
+        vst1q_f32(dst + i, a);
+        vst1q_f32(dst + i + 4, b);
+        vst1q_f32(dst + i + 8, c);
+        vst1q_f32(dst + i + 12, d);
+    }
+    u8Scalar(src + i, n - i, dst + i);
+}
+
+inline void storeRealNeon(float *dst, float32x4_t v)
+{
+    float32x4x2_t pair = { { v, vdupq_n_f32(0.0f) } };
+    vst2q_f32(dst, pair);
+}
+
+void s16RealNeon(const int16_t *src, size_t n, std::complex<float> *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS16Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t lo, hi;
+        s16x8Neon(vld1q_s16(src + i), k, lo, hi);
+        storeRealNeon(out + 2 * i, lo);
+        storeRealNeon(out + 2 * i + 8, hi);
+    }
+    s16RealScalar(src + i, n - i, dst + i);
+}
+
+void s8RealNeon(const int8_t *src, size_t n, std::complex<float> *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS8Scale);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t v = vld1q_s8(src + i);
+        float32x4_t a, b, c, d;
+        s16x8Neon(vmovl_s8(vget_low_s8(v)), k, a, b);
+        s16x8Neon(vmovl_s8(vget_high_s8(v)), k, c, d);
+        storeRealNeon(out + 2 * i, a);
+        storeRealNeon(out + 2 * i + 8, b);
+        storeRealNeon(out + 2 * i + 16, c);
+        storeRealNeon(out + 2 * i + 24, d);
+    }
+    s8RealScalar(src + i, n - i, dst + i);
+}
+
+void u8RealNeon(const uint8_t *src, size_t n, std::complex<float> *dst)
+{
+    const float32x4_t k = vdupq_n_f32(kS8Scale);
+    const float32x4_t off = vdupq_n_f32(kU8Offset);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        float32x4_t a, b, c, d;
+        u16x8Neon(vmovl_u8(vget_low_u8(v)), off, k, a, b);
+        u16x8Neon(vmovl_u8(vget_high_u8(v)), off, k, c, d);
+        storeRealNeon(out + 2 * i, a);
+        storeRealNeon(out + 2 * i + 8, b);
+        storeRealNeon(out + 2 * i + 16, c);
+        storeRealNeon(out + 2 * i + 24, d);
+    }
+    u8RealScalar(src + i, n - i, dst + i);
+}
+
+void f32RealNeon(const float *src, size_t n, std::complex<float> *dst)
+{
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        storeRealNeon(out + 2 * i, vld1q_f32(src + i));
+    f32RealScalar(src + i, n - i, dst + i);
+}
+
+void windowNeon(const std::complex<float> *src, const float *w, size_t n,
+                std::complex<float> *dst)
+{
+    // vld2q/vst2q split and rejoin I/Q, so both halves take the window as is.
+    const float *in = reinterpret_cast<const float*>(src);
+    float *out = reinterpret_cast<float*>(dst);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t wv = vld1q_f32(w + i);
+        float32x4x2_t iq = vld2q_f32(in + 2 * i);
+        iq.val[0] = vmulq_f32(iq.val[0], wv);
+        iq.val[1] = vmulq_f32(iq.val[1], wv);
+        vst2q_f32(out + 2 * i, iq);
+    }
+    windowScalar(src + i, w + i, n - i, dst + i);
+}
+
+void windowRealNeon(const std::complex<float> *src, const float *w, size_t n, float *dst)
+{
+    const float *in = reinterpret_cast<const float*>(src);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t iq = vld2q_f32(in + 2 * i);
+        vst1q_f32(dst + i, vmulq_f32(iq.val[0], vld1q_f32(w + i)));
+    }
+    windowRealScalar(src + i, w + i, n - i, dst + i);
+}
+
+void encodeDbNeon(const float *src, size_t n, int16_t *dst)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    // vmaxnmq_f32 returns the number when the other operand is NaN, which is
+    // the scalar clamp's NaN handling; vcvtnq rounds to nearest even. Both
+    // are ARMv8, so 32-bit ARM keeps the scalar loop.
+    const float32x4_t scale = vdupq_n_f32(kDbScale);
+    const float32x4_t lo = vdupq_n_f32(-32768.0f);
+    const float32x4_t hi = vdupq_n_f32(32767.0f);
+    auto pack = [&](const float *p) {
+        float32x4_t x = vmulq_f32(vld1q_f32(p), scale);
+        return vqmovn_s32(vcvtnq_s32_f32(vminq_f32(vmaxnmq_f32(x, lo), hi)));
+    };
+    for (; i + 8 <= n; i += 8)
+        vst1q_s16(dst + i, vcombine_s16(pack(src + i), pack(src + i + 4)));
+#endif
+    encodeDbScalar(src + i, n - i, dst + i);
+}
+
+void decodeDbNeon(const int16_t *src, size_t n, float *dst)
+{
+    const float32x4_t step = vdupq_n_f32(kDbStep);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t q = vld1q_s16(src + i);
+        vst1q_f32(dst + i,     vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(q))), step));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(q))), step));
+    }
+    decodeDbScalar(src + i, n - i, dst + i);
+}
+
+// vmaxq_f32 propagates NaN, but the convert then maps NaN to 0, which is
+// where the scalar clamp puts it too.
+void powerIndexRunNeon(const int16_t *src, int n, float powerMax, float powerScale, uint8_t *dst)
+{
+    const float32x4_t step = vdupq_n_f32(kDbStep);
+    const float32x4_t vMax = vdupq_n_f32(powerMax);
+    const float32x4_t vScale = vdupq_n_f32(powerScale);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t top = vdupq_n_f32(256 - 1);
+    auto index = [&](const int16_t *p) {
+        float32x4_t v = vmulq_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(p))), step);
+        float32x4_t norm = vmulq_f32(vsubq_f32(v, vMax), vScale);
+        norm = vminq_f32(vmaxq_f32(norm, zero), one);
+        return vmovn_u32(vcvtq_u32_f32(vmulq_f32(norm, top)));
+    };
+    int i = 0;
+    for (; i + 8 <= n; i += 8)
+        vst1_u8(dst + i, vmovn_u16(vcombine_u16(index(src + i), index(src + i + 4))));
+    powerIndexRunScalar(src + i, n - i, powerMax, powerScale, dst + i);
+}
+
+void powerIndexNeon(const int16_t *tile, int size, int cols, int rows,
+                    float powerMax, float powerScale, uint8_t *dst, ptrdiff_t dstStride)
+{
+    powerIndexBlocked(tile, size, cols, rows, powerMax, powerScale, dst, dstStride,
+                      powerIndexRunNeon);
+}
+
+void reassignNeon(const std::complex<float> *xh, const std::complex<float> *xth,
+                  const std::complex<float> *xdh, size_t n, float powerScale, float floorPower,
+                  float colScale, float binScale, float *power, float *dCol, float *dBin)
+{
+    size_t i = 0;
+#if defined(__aarch64__)
+    // vdivq_f32 is ARMv8 only; 32-bit ARM keeps the scalar loop. The masks
+    // are the scalar tests negated, so NaN lands the same way.
+    const float32x4_t vPowerScale = vdupq_n_f32(powerScale);
+    const float32x4_t vFloor = vdupq_n_f32(floorPower);
+    const float32x4_t vCol = vdupq_n_f32(colScale);
+    const float32x4_t vBin = vdupq_n_f32(binScale);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    auto masked = [](uint32x4_t keep, float32x4_t v) {
+        return vreinterpretq_f32_u32(vandq_u32(keep, vreinterpretq_u32_f32(v)));
+    };
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t h = vld2q_f32(reinterpret_cast<const float*>(xh + i));
+        float32x4x2_t th = vld2q_f32(reinterpret_cast<const float*>(xth + i));
+        float32x4x2_t dh = vld2q_f32(reinterpret_cast<const float*>(xdh + i));
+        const float32x4_t re = h.val[0], im = h.val[1];
+        float32x4_t mag2 = vaddq_f32(vmulq_f32(re, re), vmulq_f32(im, im));
+        float32x4_t p = vmulq_f32(mag2, vPowerScale);
+        uint32x4_t keep = vandq_u32(vmvnq_u32(vcltq_f32(p, vFloor)), vmvnq_u32(vceqq_f32(mag2, zero)));
+        float32x4_t inv = vdivq_f32(one, mag2);
+        float32x4_t t = vmulq_f32(vaddq_f32(vmulq_f32(th.val[0], re), vmulq_f32(th.val[1], im)), inv);
+        float32x4_t w = vmulq_f32(vsubq_f32(vmulq_f32(dh.val[1], re), vmulq_f32(dh.val[0], im)), inv);
+        vst1q_f32(power + i, p);
+        vst1q_f32(dCol + i, masked(keep, vmulq_f32(t, vCol)));
+        vst1q_f32(dBin + i, masked(keep, vmulq_f32(w, vBin)));
+    }
+#endif
+    reassignScalar(xh + i, xth + i, xdh + i, n - i, powerScale, floorPower, colScale, binScale,
+                   power + i, dCol + i, dBin + i);
+}
+
+const Kernels neonKernels = {
+    Isa::NEON,
+    s16Neon, s8Neon, u8Neon,
+    s16RealNeon, s8RealNeon, u8RealNeon, f32RealNeon,
+    windowNeon, windowRealNeon,
+    encodeDbNeon, decodeDbNeon, powerIndexNeon,
+    reassignNeon,
+};
+#endif // SAMPLECONVERT_NEON
+
+const Kernels *pickKernels()
+{
+    // Walk from the widest variant down, honouring an INSPECTRUM_SIMD cap.
+    Isa cap = Isa::AVX2;
+    bool capNeon = true;
+    if (const char *env = std::getenv("INSPECTRUM_SIMD")) {
+        if (std::strcmp(env, "scalar") == 0) {
+            cap = Isa::Scalar;
+            capNeon = false;
+        } else if (std::strcmp(env, "sse4.1") == 0) {
+            cap = Isa::SSE41;
+        }
+    }
+    (void)cap;
+    (void)capNeon;
+#ifdef SAMPLECONVERT_X86
+    if (cap >= Isa::AVX2 && forIsa(Isa::AVX2))
+        return &avx2Kernels;
+    if (cap >= Isa::SSE41 && forIsa(Isa::SSE41))
+        return &sse41Kernels;
+#endif
+#ifdef SAMPLECONVERT_NEON
+    if (capNeon)
+        return &neonKernels;
+#endif
+    return &scalarKernels;
+}
+
+} // namespace
+
+const Kernels *forIsa(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar:
+        return &scalarKernels;
+#ifdef SAMPLECONVERT_X86
+    case Isa::SSE41:
+        return __builtin_cpu_supports("sse4.1") ? &sse41Kernels : nullptr;
+    case Isa::AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2Kernels : nullptr;
+#endif
+#ifdef SAMPLECONVERT_NEON
+    case Isa::NEON:
+        return &neonKernels;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+const Kernels &active()
+{
+    static const Kernels *k = pickKernels();
+    return *k;
+}
+
+const char *isaName(Isa isa)
+{
+    switch (isa) {
+    case Isa::Scalar: return "scalar";
+    case Isa::SSE41:  return "sse4.1";
+    case Isa::AVX2:   return "avx2";
+    case Isa::NEON:   return "neon";
+    }
+    return "unknown";
+}
+
+} // namespace sampleconvert
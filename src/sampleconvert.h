@@ -0,0 +1,125 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+
+// Integer → float sample conversion kernels used by the InputSource
+// adapters. Every tile the spectrogram draws goes through one of these, so
+// for ci16/ci8/cu8 captures the conversion is a measurable share of the
+// per-tile cost. The kernels come in SSE4.1, AVX2 and NEON flavours plus a
+// scalar fallback; the x86 variants are compiled with per-function target
+// attributes and picked at runtime from CPUID, so a generic distro build
+// still gets the wide path on hardware that has it.
+//
+// All variants produce bit-identical output to the scalar reference: the
+// integer → float widening is exact and the offset/scale arithmetic is the
+// same single sub + mul per lane (no FMA contraction). The window multiply
+// below is one mul per lane too, so it is bit-identical in the same way.
+//
+// The table also carries the spectrogram's analysis-window multiply, the
+// packing of tiles to 16-bit dB, the dB → palette-index stage and the
+// reassignment arithmetic: all run over every bin of every column, so they
+// want the same wide paths. Each is the same per-lane arithmetic as its
+// scalar loop (the pack rounds to nearest even on every path), so they
+// match it exactly too, as long as the compiler doesn't contract the
+// reassignment's sums of products into FMAs differently per path.
+//
+// INSPECTRUM_SIMD=scalar|sse4.1|avx2|neon forces a specific variant (or
+// the best available one below it) — handy when bisecting a conversion
+// regression.
+namespace sampleconvert {
+
+enum class Isa {
+    Scalar = 0,
+    SSE41,
+    AVX2,
+    NEON,
+};
+
+struct Kernels {
+    Isa isa;
+    // Interleaved integer → float, one output float per input scalar. Used
+    // for the complex formats, where the I/Q interleave already matches
+    // std::complex<float>'s layout, so `n` is 2 × the complex sample count.
+    void (*s16)(const int16_t *src, size_t n, float *dst);
+    void (*s8)(const int8_t *src, size_t n, float *dst);
+    void (*u8)(const uint8_t *src, size_t n, float *dst);
+    // Real integer/float → complex with a zero imaginary part.
+    void (*s16Real)(const int16_t *src, size_t n, std::complex<float> *dst);
+    void (*s8Real)(const int8_t *src, size_t n, std::complex<float> *dst);
+    void (*u8Real)(const uint8_t *src, size_t n, std::complex<float> *dst);
+    void (*f32Real)(const float *src, size_t n, std::complex<float> *dst);
+    // dst[i] = src[i] * w[i] for a real window `w`, `n` complex samples.
+    void (*window)(const std::complex<float> *src, const float *w, size_t n,
+                   std::complex<float> *dst);
+    // dst[i] = src[i].real() * w[i]: windowed real frames for the r2c FFT
+    // path, which the Real* adapters have already widened to complex.
+    void (*windowReal)(const std::complex<float> *src, const float *w, size_t n,
+                       float *dst);
+    // Packed spectrogram tiles (see kDbStep): dB → int16 counts, rounded
+    // to nearest even and clamped, NaN to the bottom; and back.
+    void (*encodeDb)(const float *src, size_t n, int16_t *dst);
+    void (*decodeDb)(const int16_t *src, size_t n, float *dst);
+    // Spectrogram display stage: `cols` packed tile columns of `size` values
+    // (column-major, as the tile computes write them) to `rows` rows of
+    // `cols` 8-bit indices, `dstStride` bytes apart. Row r shows bin
+    // size - 1 - r, so rows < size drops the lowest bins. Each index is
+    // uint8_t(clamp((dB - powerMax) * powerScale, 0, 1) * 255) of the
+    // decoded dB.
+    void (*powerIndex)(const int16_t *tile, int size, int cols, int rows,
+                       float powerMax, float powerScale,
+                       uint8_t *dst, ptrdiff_t dstStride);
+    // Reassigned spectrogram, per bin of one frame's X_h, X_th, X_dh
+    // spectra (see SpectrogramPlot::computeReassignedTile): power =
+    // |X_h|² · powerScale, dCol = Re{X_th / X_h} · colScale and
+    // dBin = Im{X_dh / X_h} · binScale. Both offsets are 0 where power is
+    // below floorPower or X_h is 0.
+    void (*reassign)(const std::complex<float> *xh, const std::complex<float> *xth,
+                     const std::complex<float> *xdh, size_t n, float powerScale, float floorPower,
+                     float colScale, float binScale, float *power, float *dCol, float *dBin);
+};
+
+// Kernel table picked once (first call) for the running CPU.
+const Kernels &active();
+
+// Table for a specific ISA, or nullptr if this build/CPU can't run it.
+// Used by the tools/sample_convert_bench harness to compare variants.
+const Kernels *forIsa(Isa isa);
+
+const char *isaName(Isa isa);
+
+// Scale constants shared with the scalar reference. The u8 offset is the
+// historical rtl-sdr bias of 127.4 rather than 127.5 / 128.
+constexpr float kS16Scale = 1.0f / 32768.0f;
+constexpr float kS8Scale  = 1.0f / 128.0f;
+constexpr float kU8Offset = 127.4f;
+
+// Spectrogram tiles at rest (SpectrogramPlot's fftCache, DiskTileCache) are
+// int16 counts of kDbStep dB, the scale PowerPyramid already stores: ±327 dB
+// at 0.01 dB resolution, far finer than the display's 0.6 dB palette steps,
+// at half the size of float. Anything below the range (-inf, NaN) packs to
+// the bottom count.
+constexpr float kDbStep  = 0.01f;
+constexpr float kDbScale = 100.0f;
+
+} // namespace sampleconvert
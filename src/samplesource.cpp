@@ -31,5 +31,24 @@ double SampleSource<T>::getFrequency()
     return frequency;
 }
 
+template<typename T>
+SampleView<T> SampleSource<T>::getSampleView(size_t start, size_t length)
+{
+    SampleView<T> view = viewSamples(start, length);
+    if (view)
+        return view;
+
+    // No borrowed span on offer: wrap a regular copy so callers can treat
+    // both cases identically. The copy's ownership moves into the token.
+    std::shared_ptr<T> copy(getSamples(start, length).release(),
+                            std::default_delete<T[]>());
+    if (!copy)
+        return {};
+    view.data = copy.get();
+    view.length = length;
+    view.keepAlive = std::move(copy);
+    return view;
+}
+
 template class SampleSource<std::complex<float>>;
 template class SampleSource<float>;
@@ -45,6 +45,23 @@ public:
         description(description), comment(comment), boxColor(boxColor) {}
 };
 
+// Read-only window onto a run of samples. `data` may point straight into a
+// source's backing store (e.g. InputSource's mmap for cf32 files) rather than
+// into a fresh copy; `keepAlive` is the lifetime token that keeps that store
+// valid for as long as the view is held, even if the source reopens or
+// unmaps in the meantime. Views are cheap to move and safe to hand across
+// threads; never write through `data`.
+template<typename T>
+struct SampleView
+{
+    const T *data = nullptr;
+    size_t length = 0;
+    std::shared_ptr<const void> keepAlive;
+
+    explicit operator bool() const { return data != nullptr; }
+    const T &operator[](size_t i) const { return data[i]; }
+};
+
 template<typename T>
 class SampleSource : public AbstractSampleSource
 {
@@ -55,6 +72,13 @@ public:
     virtual ~SampleSource() {};
 
     virtual std::unique_ptr<T[]> getSamples(size_t start, size_t length) = 0;
+    // Zero-copy variant of getSamples: returns a view into the source's own
+    // storage when it already holds [start, start+length) in T's layout, or
+    // an empty view when it doesn't (the default). Callers that can use a
+    // borrowed span should go through getSampleView() below, which falls
+    // back to a getSamples() copy when no zero-copy view is available.
+    virtual SampleView<T> viewSamples(size_t start, size_t length) { return {}; }
+    SampleView<T> getSampleView(size_t start, size_t length);
     virtual void invalidateEvent() { };
     virtual size_t count() = 0;
     virtual double rate() = 0;
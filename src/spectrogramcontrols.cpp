@@ -89,23 +89,60 @@ SpectrogramControls::SpectrogramControls(const QString & title, QWidget * parent
     scalesCheckBox->setCheckState(Qt::Checked);
     layout->addRow(new QLabel(tr("Scales:")), scalesCheckBox);
 
-    // Spectrogram render mode: Standard (the existing |STFT|² path) or
-    // Reassigned (Fulop-Fitz time-frequency reassignment). Default is
-    // Standard so behaviour is unchanged for users who don't touch it.
+    // Spectrogram render mode: Standard (the existing |STFT|² path),
+    // Reassigned (Fulop-Fitz time-frequency reassignment), or the Welch /
+    // multitaper averaged estimates. Order matches SpectrogramMode. Default
+    // is Standard so behaviour is unchanged for users who don't touch it.
     spectrogramModeCombo = new QComboBox(widget);
     spectrogramModeCombo->addItem(tr("Standard"));
     spectrogramModeCombo->addItem(tr("Reassigned"));
+    spectrogramModeCombo->addItem(tr("Welch"));
+    spectrogramModeCombo->addItem(tr("Multitaper"));
     spectrogramModeCombo->setCurrentIndex(0);
     spectrogramModeCombo->setToolTip(tr(
         "Render mode for the top spectrogram. Reassigned uses Fulop-Fitz "
         "time-frequency reassignment (3× FFT cost) to sharpen tonal and "
         "chirp ridges. Below the noise floor threshold, bins are left at "
-        "their original location."));
+        "their original location. Welch and Multitaper average several "
+        "spectra per column (K× FFT cost) for a smoother noise floor that "
+        "shows weak bursts: Welch over overlapping frames around the "
+        "column, Multitaper over DPSS tapers of the column's own frame."));
     layout->addRow(new QLabel(tr("Render mode:")), spectrogramModeCombo);
     connect(spectrogramModeCombo,
             static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
             this, &SpectrogramControls::spectrogramModeChanged);
 
+    // Spectra averaged per column in the Welch / Multitaper modes.
+    spectrogramAveragesSpinBox = new QSpinBox(widget);
+    spectrogramAveragesSpinBox->setRange(2, 8);
+    spectrogramAveragesSpinBox->setValue(4);
+    spectrogramAveragesSpinBox->setToolTip(tr(
+        "Welch segments or multitaper tapers averaged per column. More "
+        "averages give a smoother noise floor at proportionally more FFT "
+        "work; multitaper also widens each bin to about (K + 1)/N."));
+    layout->addRow(new QLabel(tr("Averages (K):")), spectrogramAveragesSpinBox);
+    connect(spectrogramAveragesSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, &SpectrogramControls::spectrogramAveragesChanged);
+
+    // Zoomed out, a Standard column stands for many frames' worth of
+    // samples. Order matches ColumnDecimation; Skip by default, as the
+    // other two multiply a cold tile's FFT count by the stride.
+    columnDecimationCombo = new QComboBox(widget);
+    columnDecimationCombo->addItem(tr("Skip"));
+    columnDecimationCombo->addItem(tr("Max hold"));
+    columnDecimationCombo->addItem(tr("Mean"));
+    columnDecimationCombo->setCurrentIndex(0);
+    columnDecimationCombo->setToolTip(tr(
+        "How each column is computed when zoomed out past one FFT per "
+        "column. Skip transforms one frame and skips the samples up to the "
+        "next column; Max hold transforms every frame and keeps the peak "
+        "power in each bin, so short bursts stay visible; Mean keeps the "
+        "average power. Max hold and Mean cost one FFT per frame."));
+    layout->addRow(new QLabel(tr("Zoomed-out columns:")), columnDecimationCombo);
+    connect(columnDecimationCombo,
+            static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &SpectrogramControls::columnDecimationChanged);
+
     // Reassignment noise floor (dB). Default -80 follows the Auger-Flandrin
     // recommendation; below this threshold the bin is rendered at its
     // original (t,ω) instead of being reassigned, which would otherwise
@@ -161,6 +198,90 @@ SpectrogramControls::SpectrogramControls(const QString & title, QWidget * parent
             static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
             this, &SpectrogramControls::reassignmentSplatChanged);
 
+    // Precomputed power overview for whole-file zoom levels.
+    powerPyramidCheckBox = new QCheckBox(widget);
+    powerPyramidCheckBox->setChecked(true);
+    powerPyramidCheckBox->setToolTip(tr(
+        "Build a max-hold power overview of the capture in the background "
+        "and draw zoomed-out spectrograms from it instead of FFTing raw IQ "
+        "per column. Saved beside the file (or in the cache dir) so the next "
+        "session starts warm."));
+    layout->addRow(new QLabel(tr("Overview pyramid:")), powerPyramidCheckBox);
+    connect(powerPyramidCheckBox, &QCheckBox::toggled,
+            this, &SpectrogramControls::powerPyramidChanged);
+
+    slidingDftCheckBox = new QCheckBox(widget);
+    slidingDftCheckBox->setToolTip(tr(
+        "When zoomed in far enough that adjacent columns are only a few "
+        "samples apart, update each column from the previous one instead of "
+        "running a fresh FFT. Uses a periodic Hann window, so levels can "
+        "differ very slightly from the default path."));
+    layout->addRow(new QLabel(tr("Sliding DFT:")), slidingDftCheckBox);
+    connect(slidingDftCheckBox, &QCheckBox::toggled,
+            this, &SpectrogramControls::slidingDftChanged);
+
+    // How hard FFTW looks for fast plans. Only ever done in the background,
+    // and remembered across sessions, so the cost is paid once per size.
+    fftPlanningCombo = new QComboBox(widget);
+    fftPlanningCombo->addItem(tr("Estimate"));
+    fftPlanningCombo->addItem(tr("Measure"));
+    fftPlanningCombo->addItem(tr("Patient"));
+    fftPlanningCombo->setCurrentIndex(1);
+    fftPlanningCombo->setToolTip(tr(
+        "FFTW planning effort. Measure and Patient time candidate FFT "
+        "algorithms in the background for each FFT size you use and save the "
+        "result (wisdom) to the config directory; until then, and with "
+        "Estimate, plans are picked heuristically."));
+    layout->addRow(new QLabel(tr("FFT planning:")), fftPlanningCombo);
+    connect(fftPlanningCombo,
+            static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, [this](int level) {
+        QSettings settings;
+        settings.setValue("FFTPlanningLevel", level);
+        emit fftPlanningChanged(level);
+    });
+
+    // One memory budget for the spectrogram tile/pixmap caches, the tuner
+    // block cache and the trace tiles, each getting a fixed share of it.
+    memoryBudgetSpinBox = new QSpinBox(widget);
+    memoryBudgetSpinBox->setRange(64, 65536);
+    memoryBudgetSpinBox->setSingleStep(64);
+    memoryBudgetSpinBox->setSuffix(tr(" MB"));
+    memoryBudgetSpinBox->setValue(512);
+    memoryBudgetSpinBox->setToolTip(tr(
+        "Total RAM the render caches may hold: spectrogram tiles and "
+        "pixmaps, tuned IQ blocks and trace tiles. Raise it to keep more "
+        "pan history warm, lower it on memory-constrained machines."));
+    layout->addRow(new QLabel(tr("Cache memory:")), memoryBudgetSpinBox);
+    connect(memoryBudgetSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, [this](int mb) {
+        QSettings settings;
+        settings.setValue("MemoryBudgetMB", mb);
+        emit memoryBudgetChanged(mb);
+    });
+    // Byte cap for the on-disk tile cache (see DiskTileCache); 0 turns it off.
+    diskTileCacheSpinBox = new QSpinBox(widget);
+    diskTileCacheSpinBox->setRange(0, 1 << 20);
+    diskTileCacheSpinBox->setSingleStep(256);
+    diskTileCacheSpinBox->setSuffix(tr(" MB"));
+    diskTileCacheSpinBox->setSpecialValueText(tr("Off"));
+    diskTileCacheSpinBox->setValue(2048);
+    diskTileCacheSpinBox->setToolTip(tr(
+        "Disk space for computed spectrogram tiles, kept across sessions so "
+        "reopening a capture doesn't recompute them. Least recently used "
+        "tiles are deleted past this size; Off stops caching to disk."));
+    layout->addRow(new QLabel(tr("Tile disk cache:")), diskTileCacheSpinBox);
+    connect(diskTileCacheSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
+            this, [this](int mb) {
+        QSettings settings;
+        settings.setValue("DiskTileCacheMB", mb);
+        emit diskTileCacheChanged(mb);
+    });
+    memoryUsageLabel = new QLabel(widget);
+    memoryUsageLabel->setWordWrap(true);
+    makeWidthStable(memoryUsageLabel);
+    layout->addRow(new QLabel(tr("Cache usage:")), memoryUsageLabel);
+
     // Time selection settings
     layout->addRow(new QLabel()); // TODO: find a better way to add an empty row?
     layout->addRow(new QLabel(tr("<b>Time selection</b>")));
@@ -265,6 +386,16 @@ SpectrogramControls::SpectrogramControls(const QString & title, QWidget * parent
     layout->addRow(new QLabel(tr("Plot height:")), derivedPlotHeightSpinBox);
     connect(derivedPlotHeightSpinBox, static_cast<void (QSpinBox::*)(int)>(&QSpinBox::valueChanged),
             this, &SpectrogramControls::derivedHeightChanged);
+    // Feed derived plots added from here on through the decimating tuner.
+    tunerDecimationCheckBox = new QCheckBox(widget);
+    tunerDecimationCheckBox->setToolTip(tr(
+        "Run newly added derived plots off a decimated copy of the tuner "
+        "output (rate follows the tuner bandwidth) instead of the full-rate "
+        "stream. Much cheaper on narrow tuners over wide captures. Existing "
+        "plots are not affected; export always uses the full-rate tuner."));
+    layout->addRow(new QLabel(tr("Decimate derived plots:")), tunerDecimationCheckBox);
+    connect(tunerDecimationCheckBox, &QCheckBox::toggled,
+            this, &SpectrogramControls::tunerDecimationChanged);
     // Fast-path instantaneous-frequency FM demodulation
     fastDemodCheckBox = new QCheckBox(widget);
     fastDemodCheckBox->setCheckState(Qt::Unchecked);
@@ -491,6 +622,9 @@ void SpectrogramControls::setDefaults()
     powerMaxSlider->setValue(settings.value("PowerMax", 0).toInt());
     powerMinSlider->setValue(settings.value("PowerMin", -100).toInt());
     zoomLevelSlider->setValue(settings.value("ZoomLevel", 0).toInt());
+    memoryBudgetSpinBox->setValue(settings.value("MemoryBudgetMB", 512).toInt());
+    diskTileCacheSpinBox->setValue(settings.value("DiskTileCacheMB", 2048).toInt());
+    fftPlanningCombo->setCurrentIndex(settings.value("FFTPlanningLevel", 1).toInt());
 }
 
 void SpectrogramControls::fftOrZoomChanged(void)
@@ -637,3 +771,8 @@ void SpectrogramControls::applyCursorValue(QString text)
 {
     cursorValueLabel->setText(text.isEmpty() ? QStringLiteral("—") : text);
 }
+
+void SpectrogramControls::applyMemoryUsage(QString text)
+{
+    memoryUsageLabel->setText(text);
+}
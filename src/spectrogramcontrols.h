@@ -42,6 +42,8 @@ signals:
     void fftOrZoomChanged(int fftSize, int zoomLevel);
     void openFile(QString fileName);
     void derivedHeightChanged(int height);
+    // Feed newly added derived plots from the decimating tuner output.
+    void tunerDecimationChanged(bool enabled);
     // toggle fast-path (instantaneous) frequency demod in derived trace plot
     void fastDemodChanged(bool enabled);
     /**
@@ -78,9 +80,14 @@ signals:
     // filter change, label updates, and triangle/line overlay drawn on
     // the FM trace.
     void periodAnalysisChanged(bool enabled);
-    // Spectrogram render mode (Standard | Reassigned). Index matches
-    // SpectrogramMode enum.
+    // Spectrogram render mode (Standard | Reassigned | Welch |
+    // Multitaper). Index matches SpectrogramMode enum.
     void spectrogramModeChanged(int mode);
+    // Spectra averaged per column in Welch / Multitaper mode.
+    void spectrogramAveragesChanged(int count);
+    // How zoomed-out Standard columns reduce the frames in their stride
+    // (Skip | Max | Mean). Index matches ColumnDecimation enum.
+    void columnDecimationChanged(int decimation);
     // Per-bin power floor (dB) below which reassignment is skipped.
     void reassignmentFloorChanged(int floorDb);
     // Reassignment analysis window (Hann | Gaussian). Index matches
@@ -89,6 +96,16 @@ signals:
     // Reassignment splat method (Bilinear | Nearest). Index matches
     // SplatMethod enum.
     void reassignmentSplatChanged(int sm);
+    // Toggle serving zoomed-out spectrogram tiles from the power pyramid.
+    void powerPyramidChanged(bool enabled);
+    // Toggle the sliding-DFT column update for high-zoom standard tiles.
+    void slidingDftChanged(bool enabled);
+    // Shared in-memory cache budget (MB), see MemoryBudget.
+    void memoryBudgetChanged(int megabytes);
+    // On-disk tile cache cap (MB, 0 = off), see DiskTileCache.
+    void diskTileCacheChanged(int megabytes);
+    // FFTW planning level (index matches FFTPlanLevel), see FFTWisdom.
+    void fftPlanningChanged(int level);
     // User clicked "Save annotations". MainWindow handles the actual write.
     void saveAnnotationsRequested();
     // Edited the global file title / description. MainWindow forwards to the
@@ -114,6 +131,8 @@ public slots:
     // Show the sample value under the cursor when hovering over a derived
     // plot. Empty string clears the label.
     void applyCursorValue(QString text);
+    // Live per-cache memory usage, refreshed periodically by MainWindow.
+    void applyMemoryUsage(QString text);
 
 private slots:
     void fftSizeChanged(int value);
@@ -140,9 +159,15 @@ public:
     QSlider *zoomLevelSlider;
     QSlider *powerMaxSlider;
     QSlider *powerMinSlider;
-    // Top spectrogram render mode: Standard |STFT|² (index 0) or
-    // Fulop-Fitz reassigned spectrogram (index 1). Default = Standard.
+    // Top spectrogram render mode: Standard |STFT|² (index 0), Fulop-Fitz
+    // reassigned spectrogram (index 1), Welch (2) or Multitaper (3).
+    // Default = Standard.
     QComboBox *spectrogramModeCombo;
+    // K for the Welch / Multitaper modes (default 4).
+    QSpinBox *spectrogramAveragesSpinBox;
+    // Zoomed-out Standard columns: Skip (0), Max hold (1, default) or
+    // Mean (2) over the frames in the stride.
+    QComboBox *columnDecimationCombo;
     // Per-bin power floor (dB) for reassignment. Bins below this threshold
     // are not reassigned — they're rendered at their original (t, ω) so
     // noise context stays visible without speckle.
@@ -154,6 +179,17 @@ public:
     // Reassignment splat method (default Bilinear; Nearest is ~4× faster
     // on the inner loop with mild aliasing).
     QComboBox *reassignmentSplatCombo;
+    // Power-pyramid overview for zoomed-out views (default on).
+    QCheckBox *powerPyramidCheckBox;
+    // Sliding-DFT column update at high zoom (default off).
+    QCheckBox *slidingDftCheckBox;
+    // Shared byte budget for the in-memory render caches, and what each of
+    // them currently holds.
+    QSpinBox *memoryBudgetSpinBox;
+    QSpinBox *diskTileCacheSpinBox;
+    QLabel *memoryUsageLabel;
+    // FFTW planning level: Estimate / Measure (default) / Patient.
+    QComboBox *fftPlanningCombo;
     QCheckBox *cursorsCheckBox;
     QSpinBox *cursorSymbolsSpinBox;
     QLabel *rateLabel;
@@ -171,6 +207,8 @@ public:
     QCheckBox *scalesCheckBox;
     QCheckBox *annosCheckBox;
     QSpinBox *derivedPlotHeightSpinBox;
+    // Decimating tuner for newly added derived plots (default off).
+    QCheckBox *tunerDecimationCheckBox;
     // fast (cheap) demodulation mode for FM traces
     QCheckBox *fastDemodCheckBox;
     /**
@@ -21,24 +21,64 @@
 
 #include <QDebug>
 #include <QElapsedTimer>
-#include <QFutureSynchronizer>
-#include <QMutexLocker>
+#include <QFutureInterface>
 #include <QPainter>
 #include <QPaintEvent>
 #include <QPixmapCache>
 #include <QRect>
+#include <QRunnable>
 #include <QThreadPool>
 #include <QtConcurrent>
 #include <liquid/liquid.h>
 #include <algorithm>
+#include <cmath>
 #include <functional>
 #include <cstdlib>
 #include <limits>
+#include "disktilecache.h"
+#include "dpss.h"
+#include "fftwisdom.h"
+#include "memorybudget.h"
+#include "sampleconvert.h"
 #include "util.h"
 #include "latencylog.h"
 
+namespace {
+// QCache costs are ints, so the tile caches count KiB rather than bytes.
+int costKiB(size_t bytes)
+{
+    return static_cast<int>((bytes + 1023) >> 10);
+}
 
-SpectrogramPlot::SpectrogramPlot(std::shared_ptr<SampleSource<std::complex<float>>> src) : Plot(src), inputSource(src), fftSize(512), tuner(fftSize, this)
+class TileRunnable : public QRunnable
+{
+public:
+    explicit TileRunnable(std::function<void()> fn) : fn_(std::move(fn)) {}
+    void run() override { fn_(); }
+
+private:
+    std::function<void()> fn_;
+};
+
+// QThreadPool priority for prefetch jobs: below the default 0 that
+// visible tiles, trace tiles and QtConcurrent work all use.
+const int kPrefetchPriority = -1;
+
+// Tile images store power as 8-bit indices over the power sliders' whole
+// range (see SpectrogramControls), index 0 at the top, so moving a slider
+// only rebuilds the 256-entry palette rather than touching every pixel.
+// One index step is 150/255 ≈ 0.6 dB.
+const float kIndexTopDb = 10.0f;
+const float kIndexBottomDb = -140.0f;
+
+// Bins per block of columns in the tile computes that take several frames
+// per column (reassigned, Welch, multitaper). For reassignment the block's
+// three frames in and out of the FFT plus its splat inputs come to
+// ~250 KiB, which stays in L2 through the splat.
+const int kFrameBlockBins = 4096;
+} // namespace
+
+SpectrogramPlot::SpectrogramPlot(std::shared_ptr<SampleSource<std::complex<float>>> src) : Plot(src), inputSource(src), fftSize(512)
 {
     setFFTSize(fftSize);
     zoomLevel = 1;
@@ -51,40 +91,88 @@ SpectrogramPlot::SpectrogramPlot(std::shared_ptr<SampleSource<std::complex<float
     sigmfAnnotationLabels = true;
     sigmfAnnotationColors = true;
 
-    // Default QCache cost limit is 100. A single wide-zoom view of a long
-    // capture can need 200+ tiles, which means every paint evicts tiles it
-    // just rendered → synchronous FFT recompute on the GUI thread → 200 ms
-    // paints. Each tile pixmap and fft entry is 256 kB (tileSize × 4 B), so
-    // 512 entries gives a ~256 MB combined budget that covers very wide
-    // views with comfortable headroom for pan history.
-    pixmapCache.setMaxCost(512);
-    fftCache.setMaxCost(512);
+    // A single wide-zoom view of a long capture can need 200+ tiles; if the
+    // caches can't hold them every paint evicts tiles it just rendered →
+    // synchronous FFT recompute on the GUI thread → 200 ms paints. So both
+    // caches are costed in bytes (KiB) and sized from the shared
+    // MemoryBudget rather than an entry count, which keeps the footprint
+    // predictable whatever the tile geometry.
+    auto &budget = MemoryBudget::instance();
+    tileBudgetId_ = budget.track(MemoryBudget::SpectrogramTiles,
+                                 [this]() { return static_cast<qint64>(fftCache.totalCost()) << 10; });
+    imageBudgetId_ = budget.track(MemoryBudget::SpectrogramPixmaps,
+                                  [this]() { return static_cast<qint64>(imageCache.totalCost()) << 10; });
+    connect(&budget, &MemoryBudget::quotasChanged, this, &SpectrogramPlot::applyMemoryQuotas);
+    applyMemoryQuotas();
+
+    // Plans built so far may be FFTW_ESTIMATE stand-ins; once the background
+    // planner has wisdom for them, rebuilding the pool picks it up. Cached
+    // tiles stay valid — only their speed changes.
+    connect(&FFTWisdom::instance(), &FFTWisdom::wisdomUpdated, this, [this]() {
+        invalidateWorkSetPool();
+        fft.reset(new FFT(fftSize));
+    });
+
+    // One more paint once a pan settles, so the prefetcher switches from
+    // read-ahead to the neighbouring zoom levels even if nothing else moves.
+    panIdleTimer_.setSingleShot(true);
+    panIdleTimer_.setInterval(kPanIdleMs + 1);
+    connect(&panIdleTimer_, &QTimer::timeout, this, [this]() { emit repaint(); });
 
     for (int i = 0; i < 256; i++) {
         float p = (float)i / 256;
         colormap[i] = QColor::fromHsvF(p * 0.83f, 1.0, 1.0 - p).rgba();
     }
+    rebuildPalette();
+
+    inputBlocks = std::make_shared<InputBlockCache>(src);
+    createTuner();
+}
+
+SpectrogramPlot::~SpectrogramPlot()
+{
+    // Jobs read inputSource and the work-set pool through `this`. Cancelled
+    // ones bail out at their next column, so this wait is short.
+    cancelTileJobs();
+    for (auto *watcher : tileWatchers_) {
+        watcher->waitForFinished();
+        delete watcher->result();
+    }
+    MemoryBudget::instance().untrack(tileBudgetId_);
+    MemoryBudget::instance().untrack(imageBudgetId_);
+}
 
-    tunerTransform = std::make_shared<TunerTransform>(src);
-    connect(&tuner, &Tuner::tunerMoved, this, &SpectrogramPlot::tunerMoved);
+void SpectrogramPlot::applyMemoryQuotas()
+{
+    auto &budget = MemoryBudget::instance();
+    imageCache.setMaxCost(static_cast<int>(budget.quota(MemoryBudget::SpectrogramPixmaps) >> 10));
+    fftCache.setMaxCost(static_cast<int>(budget.quota(MemoryBudget::SpectrogramTiles) >> 10));
 }
 
 void SpectrogramPlot::invalidateEvent()
 {
+    refreshContentKey();
     // HACK: this makes sure we update the height for real signals (as InputSource is passed here before the file is opened)
     setFFTSize(fftSize);
 
-    pixmapCache.clear();
-    fftCache.clear();
+    clearTileCaches();
     emit repaint();
 }
 
 void SpectrogramPlot::paintFront(QPainter &painter, QRect &rect, range_t<size_t> sampleRange)
 {
-    if (tunerEnabled()) {
-        tuner.paintFront(painter, rect, sampleRange);
-        paintTunerReadout(painter, rect);
+    // Tuners with derived plots, the active one last so it's on top.
+    auto paintTuner = [&](TunerChannel &channel) {
+        if (!channelInUse(channel))
+            return;
+        channel.tuner->paintFront(painter, rect, sampleRange);
+        paintTunerReadout(painter, rect, channel);
+    };
+    for (size_t i = 0; i < tuners_.size(); i++) {
+        if (i != activeTuner_)
+            paintTuner(*tuners_[i]);
     }
+    paintTuner(activeTuner());
 
     if (frequencyScaleEnabled)
         paintFrequencyScale(painter, rect);
@@ -170,15 +258,15 @@ void SpectrogramPlot::paintFrequencyScale(QPainter &painter, QRect &rect)
     painter.restore();
 }
 
-void SpectrogramPlot::paintTunerReadout(QPainter &painter, QRect &rect)
+void SpectrogramPlot::paintTunerReadout(QPainter &painter, QRect &rect, TunerChannel &channel)
 {
     // Without a sample rate the pixel→Hz mapping is meaningless, so just leave
     // the band un-annotated (the highlight itself still shows the width).
     if (sampleRate <= 0.0)
         return;
 
-    const double bw = tunerBandwidthHz();
-    const double offset = tunerOffsetHz();
+    const double bw = tunerBandwidthHz(*channel.tuner);
+    const double offset = tunerOffsetHz(*channel.tuner);
     const double centreFrequency = inputSource->getFrequency();
     const bool haveAbsolute = centreFrequency != 0.0;
 
@@ -190,6 +278,8 @@ void SpectrogramPlot::paintTunerReadout(QPainter &painter, QRect &rect)
     };
 
     std::vector<QString> lines;
+    if (tuners_.size() > 1)
+        lines.push_back(channel.name);
     lines.push_back(QStringLiteral("BW ") + formatFrequencyLabel(bw, false));
     if (haveAbsolute) {
         // Absolute centre, with the tuning offset from capture DC in parens.
@@ -222,7 +312,7 @@ void SpectrogramPlot::paintTunerReadout(QPainter &painter, QRect &rect)
     int boxX = rect.right() - margin - boxW;
     if (boxX < rect.left() + margin)
         boxX = rect.left() + margin;
-    const int centreY = rect.top() + tuner.centre();
+    const int centreY = rect.top() + channel.tuner->centre();
     int boxY = centreY - boxH / 2;
     if (boxY < rect.top() + 2)
         boxY = rect.top() + 2;
@@ -394,11 +484,11 @@ void SpectrogramPlot::paintMid(QPainter &painter, QRect &rect, range_t<size_t> s
     size_t tileID = sampleRange.minimum - sampleOffset;
     int xoffset = sampleOffset / getStride();
 
-    // Both modes: collect visible tile IDs, find cache misses, and compute
-    // them in parallel before the main paint loop. The loop below is
-    // unchanged — getPixmapTile() will hit the cache for everything we
-    // pre-warmed. Reassigned mode benefits more (3× FFT cost), but the
-    // standard path is also dominated by FFT compute on cold-cache scrolls.
+    // Collect the visible tile IDs and queue async jobs for the ones that
+    // aren't cached; jobs for tiles that have scrolled away are cancelled.
+    // Nothing here waits on a compute: missing tiles are painted as a
+    // placeholder and each job triggers a repaint as it lands, so dragging
+    // through an uncached region stays at frame rate.
     {
         std::vector<size_t> visible;
         size_t walk = tileID;
@@ -408,84 +498,488 @@ void SpectrogramPlot::paintMid(QPainter &painter, QRect &rect, range_t<size_t> s
             visible.push_back(walk);
             walk += getStride() * linesPerTile();
         }
-        std::vector<size_t> missing;
-        for (size_t t : visible) {
-            TileCacheKey key(fftSize, zoomLevel, nfftSkip, t, mode,
-                             reassignmentFloorDb, windowType, splatMethod);
-            // Skip tiles whose pixmap is already cached — they don't need a
-            // float-tile recompute either. fftCache misses still trigger
-            // pre-warm so the pixmap step is just colormap conversion.
-            if (pixmapCache.contains(key)) continue;
-            if (fftCache.contains(key)) continue;
-            missing.push_back(t);
-        }
-        prewarmTiles(missing);
+        requestTiles(visible);
     }
+    // Lowest-power colour, so pending tiles read as "no signal yet" rather
+    // than flashing.
+    const QColor placeholder = QColor::fromRgb(colormap[255]);
 
     // Paint first (possibly partial) tile
-    painter.drawPixmap(QRect(rect.left(), rect.y(), linesPerTile() - xoffset, height()), *getPixmapTile(tileID), QRect(xoffset, 0, linesPerTile() - xoffset, height()));
+    QRect firstRect(rect.left(), rect.y(), linesPerTile() - xoffset, height());
+    if (QImage *image = getTileImage(tileID))
+        painter.drawImage(firstRect, *image, QRect(xoffset, 0, linesPerTile() - xoffset, height()));
+    else
+        painter.fillRect(firstRect, placeholder);
     tileID += getStride() * linesPerTile();
 
     // Paint remaining tiles
     for (int x = linesPerTile() - xoffset; x < rect.right(); x += linesPerTile()) {
         // TODO: don't draw past rect.right()
         // TODO: handle partial final tile
-        painter.drawPixmap(QRect(x, rect.y(), linesPerTile(), height()), *getPixmapTile(tileID), QRect(0, 0, linesPerTile(), height()));
+        QRect tileRect(x, rect.y(), linesPerTile(), height());
+        if (QImage *image = getTileImage(tileID))
+            painter.drawImage(tileRect, *image, QRect(0, 0, linesPerTile(), height()));
+        else
+            painter.fillRect(tileRect, placeholder);
         tileID += getStride() * linesPerTile();
     }
 }
 
-QPixmap* SpectrogramPlot::getPixmapTile(size_t tile)
+QImage* SpectrogramPlot::getTileImage(size_t tile)
 {
     TileCacheKey key(fftSize, zoomLevel, nfftSkip, tile, mode,
-                     reassignmentFloorDb, windowType, splatMethod);
-    QPixmap *obj = pixmapCache.object(key);
-    if (obj != 0)
-        return obj;
-
-    LatencyLog::markf("specgm getPixmapTile MISS tile=%zu (FFT compute+colormap)", tile);
-    float *fftTile = getFFTTile(tile);
-    obj = new QPixmap(linesPerTile(), fftSize);
-    QImage image(linesPerTile(), fftSize, QImage::Format_RGB32);
-    float powerRange = -1.0f / std::abs(int(powerMin - powerMax));
-    for (int y = 0; y < fftSize; y++) {
-        auto scanLine = (QRgb*)image.scanLine(fftSize - y - 1);
-        for (int x = 0; x < linesPerTile(); x++) {
-            float *fftLine = &fftTile[x * fftSize];
-            float normPower = (fftLine[y] - powerMax) * powerRange;
-            normPower = clamp(normPower, 0.0f, 1.0f);
-
-            scanLine[x] = colormap[(uint8_t)(normPower * (256 - 1))];
-        }
+                     reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+    TileImage *obj = imageCache.object(key);
+    if (obj == nullptr) {
+        const int16_t *fftTile = peekFFTTile(tile);
+        if (fftTile == nullptr)
+            return nullptr;   // still being computed
+        // Jobs deliver their image with the packed tile; this is for tiles
+        // served from the pyramid, or whose image was evicted.
+        LatencyLog::markf("specgm getTileImage MISS tile=%zu (quantise)", tile);
+        obj = insertTileImage(key, quantizeTile(fftTile, fftSize, tileRows()));
+        LatencyLog::markf("specgm getTileImage DONE tile=%zu", tile);
+        if (obj == nullptr)
+            return nullptr;
     }
-    obj->convertFromImage(image);
-    pixmapCache.insert(key, obj);
-    LatencyLog::markf("specgm getPixmapTile DONE tile=%zu", tile);
+    if (obj->paletteEpoch != paletteEpoch_) {
+        obj->image.setColorTable(palette_);
+        obj->paletteEpoch = paletteEpoch_;
+    }
+    return &obj->image;
+}
+
+int SpectrogramPlot::tileRows() const
+{
+    // Real-valued inputs only ever show the top (positive-frequency) half,
+    // so don't spend image memory on the mirror image.
+    return inputSource->realSignal() ? fftSize / 2 : fftSize;
+}
+
+QImage SpectrogramPlot::quantizeTile(const int16_t *tile, int size, int rows)
+{
+    const int cols = tileSize / size;
+    QImage image(cols, rows, QImage::Format_Indexed8);
+    sampleconvert::active().powerIndex(tile, size, cols, rows,
+                                       kIndexTopDb, -1.0f / (kIndexTopDb - kIndexBottomDb),
+                                       image.bits(), image.bytesPerLine());
+    return image;
+}
+
+SpectrogramPlot::TileImage* SpectrogramPlot::insertTileImage(const TileCacheKey &key, const QImage &image)
+{
+    // Epoch 0 is never current, so the first draw sets the colour table.
+    auto *obj = new TileImage{ image, 0 };
+    const int cost = costKiB(static_cast<size_t>(image.bytesPerLine()) * image.height());
+    if (!imageCache.insert(key, obj, cost))
+        return nullptr;
     return obj;
 }
 
-float* SpectrogramPlot::getFFTTile(size_t tile)
+void SpectrogramPlot::rebuildPalette()
+{
+    // Index i covers (kIndexTopDb - (i + 1)·step, kIndexTopDb - i·step];
+    // colour it as the old per-pixel mapping would have coloured the
+    // middle of that step.
+    const float step = (kIndexTopDb - kIndexBottomDb) / (256 - 1);
+    const float powerRange = -1.0f / std::abs(int(powerMin - powerMax));
+    palette_.resize(256);
+    for (int i = 0; i < 256; i++) {
+        const float power = kIndexTopDb - (i + 0.5f) * step;
+        float normPower = (power - powerMax) * powerRange;
+        normPower = clamp(normPower, 0.0f, 1.0f);
+        palette_[i] = colormap[(uint8_t)(normPower * (256 - 1))];
+    }
+    ++paletteEpoch_;
+}
+
+const int16_t* SpectrogramPlot::peekFFTTile(size_t tile)
 {
     TileCacheKey key(fftSize, zoomLevel, nfftSkip, tile, mode,
-                     reassignmentFloorDb, windowType, splatMethod);
-    std::array<float, tileSize>* obj = fftCache.object(key);
+                     reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+    PackedTile *obj = fftCache.object(key);
     if (obj != nullptr)
         return obj->data();
+    // Overview tiles are a cheap copy out of the pyramid; no job needed.
+    if (!pyramidCovers(tile))
+        return nullptr;
+    TileData &scratch = scratchTile();
+    const auto stat = (columnDecimation == ColumnDecimation::Mean) ? PowerPyramid::Mean : PowerPyramid::Max;
+    pyramid_->fill(scratch.data(), tile, getStride(), linesPerTile(), stat);
+    obj = new PackedTile;
+    sampleconvert::active().encodeDb(scratch.data(), tileSize, obj->data());
+    if (!fftCache.insert(key, obj, costKiB(sizeof(*obj))))
+        return nullptr;
+    return obj->data();
+}
 
-    std::array<float, tileSize>* destStorage = new std::array<float, tileSize>;
-    // Both modes go through the work-set pool so the synchronous path
-    // shares plan + buffer reuse with the parallel pre-warm path in
-    // paintMid. Single-tile cache misses just acquire the same set every
-    // call — pool stays at size 1, no contention.
-    auto set = acquireWorkSet();
-    if (mode == SpectrogramMode::Reassigned) {
-        computeReassignedTile(destStorage->data(), tile, *set);
-    } else {
-        computeStandardTile(destStorage->data(), tile, *set);
+const int16_t* SpectrogramPlot::getFFTTile(size_t tile)
+{
+    if (const int16_t *cached = peekFFTTile(tile))
+        return cached;
+
+    TileCacheKey key(fftSize, zoomLevel, nfftSkip, tile, mode,
+                     reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+    std::unique_ptr<PackedTile> destStorage(new PackedTile);
+    const QString diskName = diskTileName(key);
+    if (diskName.isEmpty() || !DiskTileCache::instance().get(diskName, destStorage->data(), tileSize)) {
+        computePackedTile(destStorage->data(), tile, tileParams());
+        storeTileOnDisk(diskName, destStorage->data());
     }
-    releaseWorkSet(std::move(set));
-    fftCache.insert(key, destStorage);
-    return destStorage->data();
+    // QCache deletes a tile it refuses (quota smaller than one tile).
+    const int16_t *data = destStorage->data();
+    if (!fftCache.insert(key, destStorage.release(), costKiB(sizeof(PackedTile))))
+        return nullptr;
+    return data;
+}
+
+SpectrogramPlot::TileData& SpectrogramPlot::scratchTile()
+{
+    thread_local std::unique_ptr<TileData> scratch(new TileData);
+    return *scratch;
+}
+
+bool SpectrogramPlot::computePackedTile(int16_t *dest, size_t tile, const TileParams &p)
+{
+    // Workers and the GUI thread each keep their own work set and scratch.
+    FftWorkSet &set = fftworkset::local(p.workSet);
+    TileData &scratch = scratchTile();
+    bool done;
+    switch (p.mode) {
+    case SpectrogramMode::Reassigned:
+        done = computeReassignedTile(scratch.data(), tile, p, set);
+        break;
+    case SpectrogramMode::Welch:
+    case SpectrogramMode::Multitaper:
+        done = computeAveragedTile(scratch.data(), tile, p, set);
+        break;
+    default:
+        if (p.decimation != ColumnDecimation::Skip && p.stride >= 2 * p.fftSize)
+            done = computeDecimatedTile(scratch.data(), tile, p, set);
+        else
+            done = computeStandardTile(scratch.data(), tile, p, set);
+        break;
+    }
+    if (done)
+        sampleconvert::active().encodeDb(scratch.data(), tileSize, dest);
+    return done;
+}
+
+TileParams SpectrogramPlot::tileParams() const
+{
+    return tileParams(zoomLevel, nfftSkip);
+}
+
+TileParams SpectrogramPlot::tileParams(int zoom, int skip) const
+{
+    TileParams p;
+    p.fftSize = fftSize;
+    p.cols = tileSize / fftSize;
+    p.stride = fftSize * skip / zoom;
+    p.mode = mode;
+    p.reassignmentFloorDb = reassignmentFloorDb;
+    p.splatMethod = splatMethod;
+    p.averageCount = averageCount;
+    p.decimation = columnDecimation;
+    p.workSet = workSetKey();
+    p.windows = windows_;
+    // A sliding update costs ~N·stride MACs against ~N·log2(N) for the FFT,
+    // and the MACs are heavier (double precision, so a tile's worth of
+    // updates doesn't drift); it only wins for hops well under log2(N).
+    p.slidingDft = slidingDftEnabled_ && mode == SpectrogramMode::Standard &&
+                   windowType == WindowType::Hann &&
+                   p.stride > 0 && p.stride * 2 <= static_cast<int>(log2(fftSize));
+    return p;
+}
+
+void SpectrogramPlot::notePan(double samples)
+{
+    // Samples per second, smoothed over the last few scroll events. A pan
+    // after a pause starts over, assuming one display frame since the last
+    // event, so the first step of a drag already points the prefetcher.
+    const bool fresh = !panClock_.isValid() || panClock_.elapsed() > kPanIdleMs;
+    const qint64 ms = fresh ? 16 : std::max<qint64>(1, panClock_.elapsed());
+    panClock_.start();
+    panIdleTimer_.start();
+    const double v = samples * 1000.0 / ms;
+    if (fresh || (v > 0) != (panVelocity_ > 0))
+        panVelocity_ = v;   // new pan or direction change: don't blend
+    else
+        panVelocity_ = 0.5 * panVelocity_ + 0.5 * v;
+}
+
+std::vector<TileCacheKey> SpectrogramPlot::prefetchKeys(const std::vector<size_t> &visible)
+{
+    std::vector<TileCacheKey> keys;
+    if (visible.empty())
+        return keys;
+    const size_t span = static_cast<size_t>(getStride()) * linesPerTile();
+    const size_t count = inputSource->count();
+
+    if (panClock_.isValid() && panClock_.elapsed() <= kPanIdleMs && panVelocity_ != 0.0) {
+        // Panning: the next few tiles along the direction of travel, enough
+        // to cover kPrefetchSeconds at the current speed.
+        const double reach = std::abs(panVelocity_) * kPrefetchSeconds / span;
+        int ahead = 1 + static_cast<int>(std::ceil(reach));
+        if (ahead > kMaxPrefetchTiles)
+            ahead = kMaxPrefetchTiles;
+        for (int i = 1; i <= ahead; i++) {
+            size_t t;
+            if (panVelocity_ > 0) {
+                t = visible.back() + i * span;
+                if (t >= count)
+                    break;
+            } else {
+                if (visible.front() < i * span)
+                    break;
+                t = visible.front() - i * span;
+            }
+            keys.emplace_back(fftSize, zoomLevel, nfftSkip, t, mode,
+                              reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+        }
+        return keys;
+    }
+
+    // Idle: the same stretch one zoom step out and one step in (the steps
+    // the zoom slider takes), so the next zoom lands on warm tiles.
+    const size_t first = visible.front();
+    const size_t last = std::min(visible.back() + span, count);
+    auto addLevel = [&](int zoom, int skip) {
+        const int stride = fftSize * skip / zoom;
+        if (stride <= 0)
+            return;
+        const size_t levelSpan = static_cast<size_t>(stride) * linesPerTile();
+        for (size_t t = first - first % levelSpan; t < last; t += levelSpan) {
+            if (pyramidCovers(t, stride))
+                continue;
+            keys.emplace_back(fftSize, zoom, skip, t, mode,
+                              reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+        }
+    };
+    if (zoomLevel > 1)
+        addLevel(zoomLevel / 2, 1);
+    else if (nfftSkip < fftSize)
+        addLevel(1, nfftSkip * 2);
+    if (nfftSkip > 1)
+        addLevel(1, nfftSkip / 2);
+    else if (zoomLevel < fftSize)
+        addLevel(zoomLevel * 2, 1);
+    return keys;
+}
+
+void SpectrogramPlot::requestTiles(const std::vector<size_t> &visible)
+{
+    std::vector<TileCacheKey> keys;
+    keys.reserve(visible.size());
+    QSet<TileCacheKey> wanted;
+    for (size_t t : visible) {
+        keys.emplace_back(fftSize, zoomLevel, nfftSkip, t, mode,
+                          reassignmentFloorDb, windowType, splatMethod, averageCount, columnDecimation);
+        wanted.insert(keys.back());
+    }
+    const std::vector<TileCacheKey> ahead = prefetchKeys(visible);
+    for (const auto &key : ahead)
+        wanted.insert(key);
+
+    // The view moved on, the pan changed direction, or a setting changed
+    // the keys: stop computing tiles nobody will draw.
+    for (auto it = tileJobs_.begin(); it != tileJobs_.end();) {
+        if (wanted.contains(it.key())) {
+            ++it;
+            continue;
+        }
+        it->cancelled->store(true, std::memory_order_relaxed);
+        it = tileJobs_.erase(it);
+    }
+
+    // A prefetch that's now on screen but hasn't started yet would sit
+    // behind every other visible job; requeue it at normal priority.
+    for (const auto &key : keys) {
+        auto it = tileJobs_.find(key);
+        if (it != tileJobs_.end() && it->prefetch &&
+            !it->started->load(std::memory_order_relaxed)) {
+            it->cancelled->store(true, std::memory_order_relaxed);
+            tileJobs_.erase(it);
+        }
+    }
+
+    auto needed = [&](const TileCacheKey &key) {
+        return !imageCache.contains(key) && !fftCache.contains(key) && !tileJobs_.contains(key) &&
+               !pyramidCovers(key.sample, fftSize * key.nfftSkip / key.zoomLevel);
+    };
+    std::vector<TileCacheKey> missing, prefetch;
+    for (const auto &key : keys) {
+        if (needed(key))
+            missing.push_back(key);
+    }
+    for (const auto &key : ahead) {
+        if (needed(key))
+            prefetch.push_back(key);
+    }
+    if (missing.empty() && prefetch.empty())
+        return;
+
+    for (const auto &key : missing)
+        startTileJob(key, false);
+    for (const auto &key : prefetch)
+        startTileJob(key, true);
+}
+
+void SpectrogramPlot::startTileJob(const TileCacheKey &key, bool prefetch)
+{
+    const size_t tileID = key.sample;
+    TileParams params = tileParams(key.zoomLevel, key.nfftSkip);
+    params.cancelled = std::make_shared<std::atomic<bool>>(false);
+    auto started = std::make_shared<std::atomic<bool>>(false);
+    // Name the disk entry and size the image here: both read plot state
+    // that workers mustn't touch.
+    const QString diskName = diskTileName(key);
+    const int rows = tileRows();
+
+    auto *watcher = new TileWatcher(this);
+    connect(watcher, &QFutureWatcherBase::finished, this,
+            [this, key, watcher]() { tileJobFinished(key, watcher); });
+    tileJobs_.insert(key, { params.cancelled, started, watcher, prefetch });
+    tileWatchers_.insert(watcher);
+
+    auto job = [this, tileID, params, started, diskName, rows]() -> TileResult* {
+        started->store(true, std::memory_order_relaxed);
+        if (params.cancelled->load(std::memory_order_relaxed))
+            return nullptr;
+        std::unique_ptr<TileResult> result(new TileResult);
+        result->data.reset(new PackedTile);
+        int16_t *data = result->data->data();
+        if (diskName.isEmpty() || !DiskTileCache::instance().get(diskName, data, tileSize)) {
+            if (!computePackedTile(data, tileID, params))
+                return nullptr;
+            if (!diskName.isEmpty())
+                DiskTileCache::instance().put(diskName, data, tileSize);
+        }
+        result->image = quantizeTile(data, params.fftSize, rows);
+        return result.release();
+    };
+
+    // Through the pool directly rather than QtConcurrent::run so prefetches
+    // can queue behind everything else.
+    QFutureInterface<TileResult*> promise;
+    promise.reportStarted();
+    watcher->setFuture(promise.future());
+    QThreadPool::globalInstance()->start(new TileRunnable([promise, job]() mutable {
+        promise.reportResult(job());
+        promise.reportFinished();
+    }), prefetch ? kPrefetchPriority : 0);
+}
+
+void SpectrogramPlot::tileJobFinished(const TileCacheKey &key, TileWatcher *watcher)
+{
+    std::unique_ptr<TileResult> result(watcher->result());
+    tileWatchers_.remove(watcher);
+    watcher->deleteLater();
+
+    // Only the job currently registered for this key may deliver; anything
+    // else was cancelled (and possibly superseded by a newer job).
+    auto it = tileJobs_.find(key);
+    if (it == tileJobs_.end() || it->watcher != watcher)
+        return;
+    tileJobs_.erase(it);
+    if (result) {
+        fftCache.insert(key, result->data.release(), costKiB(sizeof(PackedTile)));
+        insertTileImage(key, result->image);
+    }
+    // Also on a null result (the job was cancelled as it ran), so the next
+    // paint queues the tile again if it's still wanted.
+    emit repaint();
+}
+
+void SpectrogramPlot::cancelTileJobs()
+{
+    for (auto &job : tileJobs_)
+        job.cancelled->store(true, std::memory_order_relaxed);
+    tileJobs_.clear();
+}
+
+void SpectrogramPlot::clearTileCaches()
+{
+    imageCache.clear();
+    fftCache.clear();
+    cancelTileJobs();
+}
+
+void SpectrogramPlot::refreshContentKey()
+{
+    // Only file-backed sources have a stable identity to key persisted data
+    // on, and a capture that's still inflating has no final length yet.
+    auto input = dynamic_cast<InputSource*>(inputSource.get());
+    if (input == nullptr || input->stillLoading() || input->filePath().isEmpty())
+        contentKey_.clear();
+    else
+        contentKey_ = input->contentKey();
+}
+
+void SpectrogramPlot::updatePyramid()
+{
+    auto input = dynamic_cast<InputSource*>(inputSource.get());
+    if (!pyramidEnabled_ || input == nullptr || contentKey_.isEmpty()) {
+        if (pyramid_)
+            pyramid_->discard();
+        pyramid_.reset();
+        return;
+    }
+
+    const QByteArray &key = contentKey_;
+    if (pyramid_ && pyramid_->fftSize() == fftSize && pyramid_->key() == key)
+        return;
+    // A different FFT size keeps the old pyramid's progress (its builder
+    // saves it in the background once released); different contents mean
+    // the builder may have read some of the new file, so that one is thrown
+    // away.
+    if (pyramid_ && pyramid_->key() != key)
+        pyramid_->discard();
+    pyramid_.reset();
+    pyramid_ = PowerPyramid::create(inputSource, fftSize, key,
+        input->sidecarPath(QString("fft%1.inspectrum-pyramid").arg(fftSize)));
+}
+
+bool SpectrogramPlot::pyramidCovers(size_t tile)
+{
+    return pyramidCovers(tile, getStride());
+}
+
+bool SpectrogramPlot::pyramidCovers(size_t tile, int stride)
+{
+    // The pyramid holds the max and mean over every frame, so it can't
+    // stand in for Skip columns that span several frames.
+    const bool skipping = (columnDecimation == ColumnDecimation::Skip && stride >= 2 * fftSize);
+    return pyramid_ && mode == SpectrogramMode::Standard && !skipping &&
+           pyramid_->covers(tile, stride, linesPerTile());
+}
+
+QString SpectrogramPlot::diskTileName(const TileCacheKey &key) const
+{
+    if (contentKey_.isEmpty())
+        return QString();
+    // One directory per capture, one file per full TileCacheKey.
+    // Sliding-DFT tiles use a slightly different window, so keep them apart.
+    const bool sliding = tileParams(key.zoomLevel, key.nfftSkip).slidingDft;
+    return QString::fromLatin1(contentKey_.toHex()) + "/" +
+           QString("%1-%2-%3-%4-%5-%6-%7-%8-%9-%10%11.tile")
+               .arg(key.fftSize).arg(key.zoomLevel).arg(key.nfftSkip)
+               .arg(static_cast<qulonglong>(key.sample))
+               .arg(static_cast<int>(key.mode)).arg(key.reassignmentFloorDb)
+               .arg(static_cast<int>(key.windowType)).arg(static_cast<int>(key.splatMethod))
+               .arg(key.averageCount).arg(static_cast<int>(key.decimation))
+               .arg(sliding ? "-sdft" : "");
+}
+
+void SpectrogramPlot::storeTileOnDisk(const QString &name, const int16_t *data)
+{
+    if (name.isEmpty())
+        return;
+    auto copy = std::make_shared<PackedTile>();
+    std::copy(data, data + tileSize, copy->begin());
+    QtConcurrent::run([name, copy]() {
+        DiskTileCache::instance().put(name, copy->data(), tileSize);
+    });
 }
 
 void SpectrogramPlot::rebuildWindows()
@@ -495,9 +989,19 @@ void SpectrogramPlot::rebuildWindows()
     //   windowTimeWeighted[]  t·h(n)  with centred t = n - (N-1)/2 so the
     //                         formula gives a sample offset from frame centre
     //   windowDerivative[]    h'(n) (closed form per window family)
-    // Standard mode only reads window[]; the other two are kept allocated so
-    // mode toggles don't have to (re)allocate.
+    // Standard mode only reads window[]; the other two are always built so
+    // mode toggles don't have to rebuild. The DPSS tapers are the exception:
+    // they cost tens of ms at large N, so they're only built in Multitaper
+    // mode. A fresh set each time: tile jobs in flight keep reading the one
+    // they were queued with.
     const int N = fftSize;
+    auto windows = std::make_shared<SpectrogramWindows>();
+    auto &window = windows->window;
+    auto &windowTimeWeighted = windows->windowTimeWeighted;
+    auto &windowDerivative = windows->windowDerivative;
+    window.resize(N);
+    windowTimeWeighted.resize(N);
+    windowDerivative.resize(N);
     const float tCentre = (N - 1) * 0.5f;
     if (windowType == WindowType::Gaussian) {
         // σ = 0.15·N gives a window that decays to ≈e^-22 at the endpoints
@@ -527,162 +1031,232 @@ void SpectrogramPlot::rebuildWindows()
             windowDerivative[i] = hannDerivCoeff * sin(phase);
         }
     }
+    if (mode == SpectrogramMode::Multitaper) {
+        // K = 2·NW - 1 tapers is the usual choice: all of them are well
+        // concentrated in the ±NW/N band. Scaled from unit energy to the
+        // window's.
+        float energy = 0.0f;
+        for (float h : window)
+            energy += h * h;
+        const float scale = std::sqrt(energy);
+        windows->tapers = dpssTapers(N, averageCount, 0.5 * (averageCount + 1));
+        for (float &v : windows->tapers)
+            v *= scale;
+    }
+    windows_ = std::move(windows);
 }
 
-std::unique_ptr<FftWorkSet> SpectrogramPlot::acquireWorkSet()
+fftworkset::Key SpectrogramPlot::workSetKey() const
 {
-    QMutexLocker lock(&contextPoolMutex_);
-    if (!contextPool_.empty()) {
-        auto set = std::move(contextPool_.back());
-        contextPool_.pop_back();
-        return set;
-    }
-    // Pool empty: build one under the same lock so concurrent acquireWorkSet
-    // calls (across worker threads) don't race FFTW planning. FFTW's wisdom
-    // cache makes second-and-onward MEASURE plans for the same size fast.
-    auto set = std::make_unique<FftWorkSet>();
-    set->fftH.reset(new FFT(fftSize));
-    set->fftTH.reset(new FFT(fftSize));
-    set->fftDH.reset(new FFT(fftSize));
-    set->bufH.resize(fftSize);
-    set->bufTH.resize(fftSize);
-    set->bufDH.resize(fftSize);
-    set->outH.resize(fftSize);
-    set->outTH.resize(fftSize);
-    set->outDH.resize(fftSize);
-    set->size = fftSize;
-    return set;
-}
-
-void SpectrogramPlot::releaseWorkSet(std::unique_ptr<FftWorkSet> set)
-{
-    if (!set) return;
-    QMutexLocker lock(&contextPoolMutex_);
-    if (set->size != fftSize) {
-        // Stale (FFT size changed while this set was checked out) — drop it.
-        return;
-    }
-    contextPool_.push_back(std::move(set));
-}
-
-void SpectrogramPlot::ensureWorkSetPool(int target)
-{
-    QMutexLocker lock(&contextPoolMutex_);
-    while (static_cast<int>(contextPool_.size()) < target) {
-        auto set = std::make_unique<FftWorkSet>();
-        set->fftH.reset(new FFT(fftSize));
-        set->fftTH.reset(new FFT(fftSize));
-        set->fftDH.reset(new FFT(fftSize));
-        set->bufH.resize(fftSize);
-        set->bufTH.resize(fftSize);
-        set->bufDH.resize(fftSize);
-        set->outH.resize(fftSize);
-        set->outTH.resize(fftSize);
-        set->outDH.resize(fftSize);
-        set->size = fftSize;
-        contextPool_.push_back(std::move(set));
-    }
+    return { workSetGeneration_, fftSize, tileSize / fftSize, workSetRealInput_ };
 }
 
 void SpectrogramPlot::invalidateWorkSetPool()
 {
-    QMutexLocker lock(&contextPoolMutex_);
-    contextPool_.clear();
+    workSetGeneration_ = fftworkset::newGeneration();
+    // Called from invalidateEvent (via setFFTSize) too, so a reopened source
+    // that changed between real and complex gets the right plans.
+    workSetRealInput_ = inputSource->realSignal();
 }
 
-void SpectrogramPlot::prewarmTiles(const std::vector<size_t> &tiles)
+namespace {
+// Log-power of `count` bins of an unnormalised N-point spectrum, in order.
+template<typename Bin>
+void powerLineDb(const Bin *spectrum, int count, float *out, int N)
 {
-    if (tiles.empty()) return;
-
-    int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
-    if (maxThreads < 1) maxThreads = 1;
-    int parallelism = std::min(static_cast<int>(tiles.size()), maxThreads);
-    if (parallelism <= 1) {
-        // No win from dispatch — fall through to the synchronous path that
-        // getPixmapTile already takes.
-        return;
+    const float invFFTSize = 1.0f / N;
+    const float logMultiplier = 10.0f / log2f(10.0f);
+    for (int k = 0; k < count; k++) {
+        const float re = spectrum[k].real() * invFFTSize;
+        const float im = spectrum[k].imag() * invFFTSize;
+        float power = re * re + im * im;
+        out[k] = log2f(power) * logMultiplier;
     }
+}
 
-    // Pre-build the pool on the GUI thread so workers never need to plan.
-    ensureWorkSetPool(parallelism);
+// Same, for a whole N-bin spectrum with the fftshift that puts DC in the
+// centre row.
+template<typename Bin>
+void powerLineDb(const Bin *spectrum, int N, float *lineDest)
+{
+    const float invFFTSize = 1.0f / N;
+    const float logMultiplier = 10.0f / log2f(10.0f);
+    for (int i = 0; i < N; i++) {
+        int k = i ^ (N >> 1);
+        const float re = spectrum[k].real() * invFFTSize;
+        const float im = spectrum[k].imag() * invFFTSize;
+        float power = re * re + im * im;
+        lineDest[i] = log2f(power) * logMultiplier;
+    }
+}
 
-    struct TileResult {
-        size_t tile = 0;
-        std::array<float, tileSize>* data = nullptr;
-    };
+// Standard tile by sliding DFT. `span` holds every column's frame;
+// `offsets` are the columns' first samples within it (non-decreasing).
+// Column 0 is a rectangular FFT; each later column advances the previous
+// one sample at a time,
+//   X_k(n+1) = (X_k(n) - x[n] + x[n+N]) · e^{+j2πk/N},
+// and the periodic Hann is applied as its 3-tap kernel in frequency,
+//   Y_k = 0.5·X_k - 0.25·(X_{k-1} + X_{k+1}).
+// State is kept in double and reseeded every tile, so the recursion's
+// rounding stays far below display precision.
+bool slidingDftTile(float *dest, const TileParams &p, FftWorkSet &set,
+                    const std::complex<float> *span, const std::vector<size_t> &offsets)
+{
+    const int N = p.fftSize;
+    const int mask = N - 1;
+    std::copy(span + offsets[0], span + offsets[0] + N, set.bufH.begin());
+    set.fftH->process(set.outH.data(), set.bufH.data());
+
+    // Split re/im (and spelled-out multiplies) so the update vectorises;
+    // std::complex<double> multiplication goes through __muldc3.
+    std::vector<double> xr(N), xi(N), tr(N), ti(N);
+    for (int k = 0; k < N; k++) {
+        xr[k] = set.outH[k].real();
+        xi[k] = set.outH[k].imag();
+        tr[k] = std::cos(Tau * k / N);
+        ti[k] = std::sin(Tau * k / N);
+    }
 
-    // Snapshot the mode so a mid-flight mode toggle can't make some workers
-    // compute Standard and others Reassigned for the same paint.
-    SpectrogramMode capturedMode = mode;
-
-    QFutureSynchronizer<TileResult> sync;
-    for (size_t tileID : tiles) {
-        sync.addFuture(QtConcurrent::run([this, tileID, capturedMode]() -> TileResult {
-            TileResult r;
-            r.tile = tileID;
-            auto storage = std::unique_ptr<std::array<float, tileSize>>(
-                new std::array<float, tileSize>);
-            auto set = acquireWorkSet();
-            if (capturedMode == SpectrogramMode::Reassigned) {
-                computeReassignedTile(storage->data(), tileID, *set);
-            } else {
-                computeStandardTile(storage->data(), tileID, *set);
+    std::vector<std::complex<double>> windowed(N);
+    for (int c = 0; c < p.cols; c++) {
+        if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+            return false;
+        if (c > 0) {
+            for (size_t n = offsets[c - 1]; n < offsets[c]; n++) {
+                const double dr = static_cast<double>(span[n + N].real()) - span[n].real();
+                const double di = static_cast<double>(span[n + N].imag()) - span[n].imag();
+                for (int k = 0; k < N; k++) {
+                    const double re = xr[k] + dr;
+                    const double im = xi[k] + di;
+                    xr[k] = re * tr[k] - im * ti[k];
+                    xi[k] = re * ti[k] + im * tr[k];
+                }
             }
-            releaseWorkSet(std::move(set));
-            r.data = storage.release();
-            return r;
-        }));
-    }
-    sync.waitForFinished();
-
-    // Insert all results into fftCache on the GUI thread (QCache isn't
-    // thread-safe). The cache takes ownership of the raw pointer.
-    for (const auto &fut : sync.futures()) {
-        auto r = fut.result();
-        if (!r.data) continue;
-        TileCacheKey key(fftSize, zoomLevel, nfftSkip, r.tile, capturedMode,
-                         reassignmentFloorDb, windowType, splatMethod);
-        fftCache.insert(key, r.data);
+        }
+        for (int k = 0; k < N; k++) {
+            const int lo = (k - 1) & mask;
+            const int hi = (k + 1) & mask;
+            windowed[k] = { 0.5 * xr[k] - 0.25 * (xr[lo] + xr[hi]),
+                            0.5 * xi[k] - 0.25 * (xi[lo] + xi[hi]) };
+        }
+        powerLineDb(windowed.data(), N, dest + static_cast<size_t>(c) * N);
     }
+    return true;
 }
+} // namespace
 
-void SpectrogramPlot::computeStandardTile(float *dest, size_t tile, FftWorkSet &set)
+bool SpectrogramPlot::computeStandardTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set)
 {
     // Per-frame |STFT|² in dB. Same maths as the original getLine() loop —
     // window, FFT, fftshift to put DC in the centre row, log-power — but
     // reads/writes go through `set` so the function is reentrant and can
     // run on a worker thread alongside other tile computes.
-    const int N = fftSize;
-    const int cols = linesPerTile();
-    const int stride = getStride();
-    const float invFFTSize = 1.0f / N;
-    const float logMultiplier = 10.0f / log2f(10.0f);
+    //
+    // All the tile's columns are windowed into one buffer and transformed by
+    // a single batched plan rather than one execute and one sample fetch per
+    // column. Real-valued inputs take the r2c
+    // plan instead: half the transform, and the negative-frequency half of
+    // each column is the mirror of the positive one.
+    const int N = p.fftSize;
+    const int cols = p.cols;
+    const int stride = p.stride;
+    const float *window = p.windows->window.data();
     const float negInf = -std::numeric_limits<float>::infinity();
+    const auto &kernels = sampleconvert::active();
+
+    auto firstSample = [&](int c) {
+        const size_t sample = tile + static_cast<size_t>(c) * stride;
+        return static_cast<size_t>(std::max(static_cast<ssize_t>(sample) - N / 2,
+                                            static_cast<ssize_t>(0)));
+    };
+
+    // Overlapping or abutting columns share one fetch of the tile's whole
+    // span. Borrowed view: for cf32 inputs this reads the mmap in place.
+    // With skipped FFTs (stride > N) most of that span would go unused, and
+    // a span running off the end of the input comes back empty; both fall
+    // back to a fetch per column.
+    SampleView<std::complex<float>> span;
+    const size_t spanStart = firstSample(0);
+    if (stride <= N)
+        span = inputSource->getSampleView(spanStart, static_cast<size_t>(cols - 1) * stride + N);
+
+    if (p.slidingDft && span) {
+        std::vector<size_t> offsets(cols);
+        for (int c = 0; c < cols; c++)
+            offsets[c] = firstSample(c) - spanStart;
+        return slidingDftTile(dest, p, set, span.data, offsets);
+    }
 
+    FFT &fft = *set.fftTile;
+    RealFFT *realFft = set.fftTileReal.get();
+    auto *frames = reinterpret_cast<std::complex<float>*>(fft.input());
+    std::vector<bool> missing(cols, false);
     for (int c = 0; c < cols; c++) {
-        size_t sample = tile + static_cast<size_t>(c) * stride;
-        const auto first_sample = std::max(static_cast<ssize_t>(sample) - N / 2,
-                                           static_cast<ssize_t>(0));
-        auto buffer = inputSource->getSamples(first_sample, N);
-        float *lineDest = dest + static_cast<size_t>(c) * N;
-        if (buffer == nullptr) {
-            for (int i = 0; i < N; i++) lineDest[i] = negInf;
-            continue;
+        if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+            return false;
+        const size_t first = firstSample(c);
+        SampleView<std::complex<float>> column;
+        const std::complex<float> *in = nullptr;
+        if (span) {
+            in = span.data + (first - spanStart);
+        } else {
+            column = inputSource->getSampleView(first, N);
+            in = column.data;
         }
-        for (int i = 0; i < N; i++) {
-            set.bufH[i] = buffer[i] * window[i];
+        if (realFft) {
+            float *frame = realFft->input() + static_cast<size_t>(c) * N;
+            if (in)
+                kernels.windowReal(in, window, N, frame);
+            else
+                std::fill(frame, frame + N, 0.0f);
+        } else {
+            std::complex<float> *frame = frames + static_cast<size_t>(c) * N;
+            if (in)
+                kernels.window(in, window, N, frame);
+            else
+                std::fill(frame, frame + N, std::complex<float>(0.0f, 0.0f));
         }
-        set.fftH->process(set.outH.data(), set.bufH.data());
-        for (int i = 0; i < N; i++) {
-            int k = i ^ (N >> 1);
-            auto s = set.outH[k] * invFFTSize;
-            float power = s.real() * s.real() + s.imag() * s.imag();
-            lineDest[i] = log2f(power) * logMultiplier;
+        missing[c] = (in == nullptr);
+    }
+    if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+        return false;
+
+    if (realFft) {
+        realFft->execute();
+        const int bins = realFft->getBins();
+        const auto *spectra = reinterpret_cast<const std::complex<float>*>(realFft->output());
+        std::vector<float> half(bins);
+        for (int c = 0; c < cols; c++) {
+            float *lineDest = dest + static_cast<size_t>(c) * N;
+            if (missing[c]) {
+                std::fill(lineDest, lineDest + N, negInf);
+                continue;
+            }
+            // Bins 0..N/2 land at rows N/2..N (DC in the centre row, as for
+            // complex input); |X(N-k)| = |X(k)| fills rows N/2..0.
+            powerLineDb(spectra + static_cast<size_t>(c) * bins, bins, half.data(), N);
+            for (int k = 0; k < N / 2; k++)
+                lineDest[N / 2 + k] = half[k];
+            for (int k = 1; k <= N / 2; k++)
+                lineDest[N / 2 - k] = half[k];
         }
+        return true;
     }
+
+    fft.execute();
+    const auto *spectra = reinterpret_cast<const std::complex<float>*>(fft.output());
+    for (int c = 0; c < cols; c++) {
+        float *lineDest = dest + static_cast<size_t>(c) * N;
+        if (missing[c]) {
+            std::fill(lineDest, lineDest + N, negInf);
+            continue;
+        }
+        powerLineDb(spectra + static_cast<size_t>(c) * N, N, lineDest);
+    }
+    return true;
 }
 
-void SpectrogramPlot::computeReassignedTile(float *dest, size_t tile, FftWorkSet &set)
+bool SpectrogramPlot::computeReassignedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set)
 {
     // Fulop-Fitz reassignment, JASA 2006:
     //   X_h  : STFT with analysis window h(n)
@@ -694,104 +1268,139 @@ void SpectrogramPlot::computeReassignedTile(float *dest, size_t tile, FftWorkSet
     // the noise floor get rendered at their original location so the noise
     // background stays contextual but isn't smeared into speckle.
     //
-    // FFT plans + scratch buffers come from `set` so multiple tiles can be
-    // computed in parallel (FFTW execute is thread-safe; planning isn't,
-    // and is done up front by ensureWorkSetPool).
-    const int N = fftSize;
-    const int cols = linesPerTile();
-    const int stride = getStride();
+    // Columns are done a block at a time, about kFrameBlockBins bins per
+    // block: all three windowed frames of every column in the block go
+    // through one batched plan, the sampleconvert reassign kernel turns the
+    // spectra into per-bin power and offsets, and those are splatted while
+    // the block is still in cache. Splats move by about a window length at
+    // most, so each block only writes the accumulator around its own
+    // columns rather than all over the tile.
+    //
+    // FFT plans + scratch buffers come from `set`, the calling thread's
+    // own, so multiple tiles can be computed in parallel.
+    const int N = p.fftSize;
+    const int cols = p.cols;
+    const int stride = p.stride;
+    const float *window = p.windows->window.data();
+    const float *windowTimeWeighted = p.windows->windowTimeWeighted.data();
+    const float *windowDerivative = p.windows->windowDerivative.data();
     const float invN = 1.0f / N;
-    const float floorPower = std::pow(10.0f, reassignmentFloorDb / 10.0f);
+    const float floorPower = std::pow(10.0f, p.reassignmentFloorDb / 10.0f);
     const float halfShift = static_cast<float>(N >> 1);
+    const auto &kernels = sampleconvert::active();
+
+    const int blockCols = std::max(1, std::min(cols, kFrameBlockBins / N));
+    const size_t blockBins = static_cast<size_t>(blockCols) * N;
+    if (!set.fftReassign || set.fftReassign->getBatch() != 3 * blockCols) {
+        set.fftReassign.reset(new FFT(N, 3 * blockCols));
+        set.splatPower.resize(blockBins);
+        set.splatCol.resize(blockBins);
+        set.splatBin.resize(blockBins);
+    }
+    // Frames of a block: h for each column, then t·h for each, then h'.
+    auto *frames = reinterpret_cast<std::complex<float>*>(set.fftReassign->input());
+    const auto *spectra = reinterpret_cast<const std::complex<float>*>(set.fftReassign->output());
 
     // accum is indexed as accum[col * N + bin] to match the tile layout
-    // that getPixmapTile() reads. assign() resizes + zero-inits in one step.
+    // that getTileImage() reads. assign() resizes + zero-inits in one step.
     set.accum.assign(static_cast<size_t>(cols) * N, 0.0f);
-    auto &bufH  = set.bufH;
-    auto &bufTH = set.bufTH;
-    auto &bufDH = set.bufDH;
-    auto &outH  = set.outH;
-    auto &outTH = set.outTH;
-    auto &outDH = set.outDH;
-    auto &accum = set.accum;
-
+    float *accum = set.accum.data();
+
+    // Frequency bins wrap around (periodic) so bin offsets that fall off
+    // either end land on the opposite side; FFT sizes are powers of two,
+    // so that's a mask. Time bins don't wrap — energy that lands outside
+    // the tile is dropped (acceptable edge artefact, bounded by ~window/2
+    // samples).
+    const int binMask = N - 1;
     auto splat = [&](int col, int bin, float power) {
         if (col < 0 || col >= cols) return;
-        // Frequency bins wrap around (periodic) so bin offsets that fall
-        // off either end land on the opposite side. Time bins don't wrap
-        // — energy that lands outside the tile is dropped (acceptable
-        // edge artefact, bounded by ~window/2 samples).
-        bin = ((bin % N) + N) % N;
-        accum[static_cast<size_t>(col) * N + bin] += power;
+        accum[static_cast<size_t>(col) * N + (bin & binMask)] += power;
     };
 
-    for (int c = 0; c < cols; c++) {
-        size_t sample = tile + static_cast<size_t>(c) * stride;
-        const auto first_sample = std::max(static_cast<ssize_t>(sample) - N / 2,
-                                           static_cast<ssize_t>(0));
-        auto buffer = inputSource->getSamples(first_sample, N);
-        if (buffer == nullptr) continue;
-
-        for (int i = 0; i < N; i++) {
-            auto s = buffer[i];
-            bufH[i]  = s * window[i];
-            bufTH[i] = s * windowTimeWeighted[i];
-            bufDH[i] = s * windowDerivative[i];
+    std::vector<bool> missing(blockCols);
+    for (int c0 = 0; c0 < cols; c0 += blockCols) {
+        if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+            return false;
+        const int n = std::min(blockCols, cols - c0);
+        for (int j = 0; j < blockCols; j++) {
+            std::complex<float> *h = frames + static_cast<size_t>(j) * N;
+            std::complex<float> *th = h + blockBins;
+            std::complex<float> *dh = th + blockBins;
+            SampleView<std::complex<float>> column;
+            if (j < n) {
+                size_t sample = tile + static_cast<size_t>(c0 + j) * stride;
+                const auto first_sample = std::max(static_cast<ssize_t>(sample) - N / 2,
+                                                   static_cast<ssize_t>(0));
+                column = inputSource->getSampleView(first_sample, N);
+            }
+            missing[j] = !column;
+            if (column) {
+                kernels.window(column.data, window, N, h);
+                kernels.window(column.data, windowTimeWeighted, N, th);
+                kernels.window(column.data, windowDerivative, N, dh);
+            } else {
+                std::fill(h, h + N, std::complex<float>(0.0f, 0.0f));
+                std::fill(th, th + N, std::complex<float>(0.0f, 0.0f));
+                std::fill(dh, dh + N, std::complex<float>(0.0f, 0.0f));
+            }
         }
+        set.fftReassign->execute();
 
-        set.fftH->process(outH.data(), bufH.data());
-        set.fftTH->process(outTH.data(), bufTH.data());
-        set.fftDH->process(outDH.data(), bufDH.data());
+        // Offsets come back in (column, bin) units: stride samples per
+        // column and 2π/N radians per bin.
+        kernels.reassign(spectra, spectra + blockBins, spectra + 2 * blockBins, blockBins,
+                         invN * invN, floorPower, -1.0f / stride, N / static_cast<float>(Tau),
+                         set.splatPower.data(), set.splatCol.data(), set.splatBin.data());
 
-        for (int k = 0; k < N; k++) {
-            auto Xh = outH[k];
-            float magH2 = Xh.real() * Xh.real() + Xh.imag() * Xh.imag();
-            float power = magH2 * invN * invN;
-            // Match the Standard-mode FFT shift: bin k in FFTW order maps
-            // to display bin k XOR (N/2) so DC sits at the centre row.
-            int displayBin = k ^ (N >> 1);
-
-            if (power < floorPower || magH2 == 0.0f) {
-                // Below noise floor — keep at original (t, ω). Zero magH2
-                // is the degenerate divide-by-zero guard.
-                splat(c, displayBin, power);
+        for (int j = 0; j < n; j++) {
+            if (missing[j])
                 continue;
-            }
-
-            // Reciprocal of X_h: ratio_t = X_th / X_h, ratio_d = X_dh / X_h.
-            float invMag2 = 1.0f / magH2;
-            std::complex<float> conjXh(Xh.real(), -Xh.imag());
-            std::complex<float> ratioT = outTH[k] * conjXh * invMag2;
-            std::complex<float> ratioD = outDH[k] * conjXh * invMag2;
-            float tOffsetSamples = -ratioT.real();
-            float wOffsetRad = ratioD.imag();
-
-            // Convert to (column, bin) offsets. stride samples per column
-            // and 2π/N radians per bin.
-            float dCol = tOffsetSamples / static_cast<float>(stride);
-            float dBin = wOffsetRad * N / static_cast<float>(Tau);
-
-            // FFT-shift offset is added in continuous form so fractional
-            // splats wrap correctly across the centre.
-            float colHat = static_cast<float>(c) + dCol;
-            float binHat = static_cast<float>(k) + dBin + halfShift;
-
-            if (splatMethod == SplatMethod::Nearest) {
-                // ~4× cheaper than bilinear; visually fine for tonal/chirp
-                // signals, slightly more aliased on weak ridges.
-                int colN = static_cast<int>(std::lround(colHat));
-                int binN = static_cast<int>(std::lround(binHat));
-                splat(colN, binN, power);
-            } else {
-                // Bilinear splat across the 4 nearest pixels.
-                int c0 = static_cast<int>(std::floor(colHat));
-                float fc = colHat - c0;
-                int b0 = static_cast<int>(std::floor(binHat));
-                float fb = binHat - b0;
-                splat(c0,     b0,     power * (1.0f - fc) * (1.0f - fb));
-                splat(c0 + 1, b0,     power *         fc  * (1.0f - fb));
-                splat(c0,     b0 + 1, power * (1.0f - fc) *         fb );
-                splat(c0 + 1, b0 + 1, power *         fc  *         fb );
+            const int c = c0 + j;
+            const float *power = set.splatPower.data() + static_cast<size_t>(j) * N;
+            const float *dCol = set.splatCol.data() + static_cast<size_t>(j) * N;
+            const float *dBin = set.splatBin.data() + static_cast<size_t>(j) * N;
+            float *line = accum + static_cast<size_t>(c) * N;
+            for (int k = 0; k < N; k++) {
+                if (dCol[k] == 0.0f && dBin[k] == 0.0f) {
+                    // Below the noise floor (or not moved) — keep at the
+                    // original (t, ω). Bin k in FFTW order is display bin
+                    // k XOR (N/2), as in Standard mode, so DC sits at the
+                    // centre row.
+                    line[k ^ (N >> 1)] += power[k];
+                    continue;
+                }
+                // FFT-shift offset is added in continuous form so
+                // fractional splats wrap correctly across the centre.
+                // Offsets from a near-zero X_h can be huge or NaN; the
+                // range checks keep the int conversions below defined.
+                const float colHat = static_cast<float>(c) + dCol[k];
+                if (!(colHat > -1.0f && colHat < static_cast<float>(cols)))
+                    continue;
+                float db = dBin[k];
+                if (!(std::abs(db) < static_cast<float>(N))) {
+                    if (!std::isfinite(db))
+                        continue;
+                    db = std::fmod(db, static_cast<float>(N));
+                }
+                const float binHat = static_cast<float>(k) + db + halfShift;
+
+                if (p.splatMethod == SplatMethod::Nearest) {
+                    // ~4× cheaper than bilinear; visually fine for tonal/chirp
+                    // signals, slightly more aliased on weak ridges.
+                    int colN = static_cast<int>(std::lround(colHat));
+                    int binN = static_cast<int>(std::lround(binHat));
+                    splat(colN, binN, power[k]);
+                } else {
+                    // Bilinear splat across the 4 nearest pixels.
+                    int cl = static_cast<int>(std::floor(colHat));
+                    float fc = colHat - cl;
+                    int b0 = static_cast<int>(std::floor(binHat));
+                    float fb = binHat - b0;
+                    splat(cl,     b0,     power[k] * (1.0f - fc) * (1.0f - fb));
+                    splat(cl + 1, b0,     power[k] *         fc  * (1.0f - fb));
+                    splat(cl,     b0 + 1, power[k] * (1.0f - fc) *         fb );
+                    splat(cl + 1, b0 + 1, power[k] *         fc  *         fb );
+                }
             }
         }
     }
@@ -801,9 +1410,204 @@ void SpectrogramPlot::computeReassignedTile(float *dest, size_t tile, FftWorkSet
     const float logMultiplier = 10.0f / log2f(10.0f);
     const float negInf = -std::numeric_limits<float>::infinity();
     for (size_t i = 0; i < static_cast<size_t>(cols) * N; i++) {
-        float p = accum[i];
-        dest[i] = (p > 0.0f) ? log2f(p) * logMultiplier : negInf;
+        float acc = accum[i];
+        dest[i] = (acc > 0.0f) ? log2f(acc) * logMultiplier : negInf;
+    }
+    return true;
+}
+
+bool SpectrogramPlot::computeAveragedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set)
+{
+    // Both estimators average K periodograms per column; they differ in
+    // which K frames go in:
+    //   Welch      : the Hann window over K frames at half-frame hops,
+    //                centred on the column (covers (K + 1)·N/2 samples)
+    //   Multitaper : the column's own frame under each of K DPSS tapers
+    //                (Thomson 1982, equal weights)
+    // Either way the variance of the noise floor drops by up to K× while
+    // the bin width stays N's (Welch) or grows to ~(K + 1)/N (Multitaper).
+    //
+    // Like the reassigned path, columns go a block at a time so a block's
+    // K frames each run as one batched plan.
+    const int N = p.fftSize;
+    const int K = p.averageCount;
+    const int cols = p.cols;
+    const int stride = p.stride;
+    const bool multitaper = (p.mode == SpectrogramMode::Multitaper);
+    // Can't happen (tileParams snapshots both together, and every change to
+    // either rebuilds the windows first), but never read past the tapers.
+    if (multitaper && p.windows->tapers.size() != static_cast<size_t>(K) * N)
+        return false;
+    const auto &kernels = sampleconvert::active();
+    const float negInf = -std::numeric_limits<float>::infinity();
+    const float logMultiplier = 10.0f / log2f(10.0f);
+
+    const int blockCols = std::max(1, std::min(cols, kFrameBlockBins / N));
+    if (!set.fftAverage || set.fftAverage->getBatch() != K * blockCols)
+        set.fftAverage.reset(new FFT(N, K * blockCols));
+    // Frames of a block: column j's K frames at j·K .. j·K + K - 1.
+    auto *frames = reinterpret_cast<std::complex<float>*>(set.fftAverage->input());
+    const auto *spectra = reinterpret_cast<const std::complex<float>*>(set.fftAverage->output());
+    set.accum.resize(N);
+    float *sum = set.accum.data();
+    std::vector<int> frameCount(blockCols);
+
+    for (int c0 = 0; c0 < cols; c0 += blockCols) {
+        if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+            return false;
+        const int n = std::min(blockCols, cols - c0);
+        for (int j = 0; j < blockCols; j++) {
+            frameCount[j] = 0;
+            const ssize_t centre = static_cast<ssize_t>(tile + static_cast<size_t>(c0 + j) * stride);
+            SampleView<std::complex<float>> own;
+            if (j < n && multitaper)
+                own = inputSource->getSampleView(std::max(centre - N / 2, static_cast<ssize_t>(0)), N);
+            for (int k = 0; k < K; k++) {
+                std::complex<float> *frame = frames + static_cast<size_t>(j * K + k) * N;
+                SampleView<std::complex<float>> view;
+                const float *window = p.windows->window.data();
+                if (j >= n) {
+                    // Past the last column: nothing to read.
+                } else if (multitaper) {
+                    view = own;
+                    window = p.windows->tapers.data() + static_cast<size_t>(k) * N;
+                } else {
+                    const ssize_t offset = static_cast<ssize_t>(2 * k - (K - 1)) * N / 4;
+                    view = inputSource->getSampleView(std::max(centre - N / 2 + offset, static_cast<ssize_t>(0)), N);
+                }
+                if (view) {
+                    kernels.window(view.data, window, N, frame);
+                    frameCount[j]++;
+                } else {
+                    std::fill(frame, frame + N, std::complex<float>(0.0f, 0.0f));
+                }
+            }
+        }
+        set.fftAverage->execute();
+
+        for (int j = 0; j < n; j++) {
+            float *lineDest = dest + static_cast<size_t>(c0 + j) * N;
+            if (frameCount[j] == 0) {
+                std::fill(lineDest, lineDest + N, negInf);
+                continue;
+            }
+            // Missing frames were zeroed, so they add nothing to the sum;
+            // divide by the frames actually read.
+            std::fill(sum, sum + N, 0.0f);
+            for (int k = 0; k < K; k++) {
+                const std::complex<float> *X = spectra + static_cast<size_t>(j * K + k) * N;
+                for (int b = 0; b < N; b++)
+                    sum[b] += X[b].real() * X[b].real() + X[b].imag() * X[b].imag();
+            }
+            // Same |X/N|² scaling and fftshift as powerLineDb.
+            const float scale = 1.0f / (static_cast<float>(N) * N * frameCount[j]);
+            for (int i = 0; i < N; i++)
+                lineDest[i] = log2f(sum[i ^ (N >> 1)] * scale) * logMultiplier;
+        }
+    }
+    return true;
+}
+
+bool SpectrogramPlot::computeDecimatedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set)
+{
+    // Zoomed out past one frame per column, the plain Standard path
+    // transforms the frame at each column's start and skips the rest of
+    // the stride, so a burst shorter than the gap between frames never
+    // shows. Here every one of the column's F = stride / N back-to-back
+    // frames (s, s + N, ..., the same frames the power pyramid reduces)
+    // is transformed, and the column keeps the per-bin max or mean of
+    // their |X|².
+    //
+    // Frames of consecutive columns run back to back through the tile's
+    // own batched plan, cols frames per execute, so a column costs F times
+    // a Standard one and tiles still spread over the job pool's threads.
+    const int N = p.fftSize;
+    const int cols = p.cols;
+    const int stride = p.stride;
+    const size_t F = static_cast<size_t>(stride / N);
+    const size_t total = F * cols;
+    const bool peak = (p.decimation == ColumnDecimation::Max);
+    const float *window = p.windows->window.data();
+    const auto &kernels = sampleconvert::active();
+    const float negInf = -std::numeric_limits<float>::infinity();
+    const float logMultiplier = 10.0f / log2f(10.0f);
+
+    FFT &fft = *set.fftTile;
+    const int batch = fft.getBatch();
+    auto *frames = reinterpret_cast<std::complex<float>*>(fft.input());
+    const auto *spectra = reinterpret_cast<const std::complex<float>*>(fft.output());
+    // Per-column linear power, in FFT bin order until the final pass.
+    set.accum.assign(static_cast<size_t>(cols) * N, 0.0f);
+    std::vector<int> frameCount(cols, 0);
+    std::vector<int> frameColumn(batch);
+
+    auto frameSample = [&](size_t g) {
+        return tile + (g / F) * stride + (g % F) * N;
+    };
+
+    for (size_t g0 = 0; g0 < total; g0 += batch) {
+        if (p.cancelled && p.cancelled->load(std::memory_order_relaxed))
+            return false;
+        const int n = static_cast<int>(std::min<size_t>(batch, total - g0));
+        // When the stride is a whole number of frames the batch is one
+        // contiguous run of samples; fetch it in one go, and frame by frame
+        // only where it runs off the end of the input.
+        SampleView<std::complex<float>> span;
+        if (static_cast<size_t>(stride) == F * N)
+            span = inputSource->getSampleView(frameSample(g0), static_cast<size_t>(n) * N);
+        for (int i = 0; i < batch; i++) {
+            std::complex<float> *frame = frames + static_cast<size_t>(i) * N;
+            SampleView<std::complex<float>> view;
+            const std::complex<float> *in = nullptr;
+            if (i < n) {
+                if (span) {
+                    in = span.data + static_cast<size_t>(i) * N;
+                } else {
+                    view = inputSource->getSampleView(frameSample(g0 + i), N);
+                    in = view.data;
+                }
+            }
+            if (in) {
+                kernels.window(in, window, N, frame);
+                frameColumn[i] = static_cast<int>((g0 + i) / F);
+            } else {
+                std::fill(frame, frame + N, std::complex<float>(0.0f, 0.0f));
+                frameColumn[i] = -1;
+            }
+        }
+        fft.execute();
+
+        for (int i = 0; i < n; i++) {
+            const int c = frameColumn[i];
+            if (c < 0)
+                continue;
+            const std::complex<float> *X = spectra + static_cast<size_t>(i) * N;
+            float *acc = set.accum.data() + static_cast<size_t>(c) * N;
+            if (peak) {
+                for (int b = 0; b < N; b++)
+                    acc[b] = std::max(acc[b], X[b].real() * X[b].real() + X[b].imag() * X[b].imag());
+            } else {
+                for (int b = 0; b < N; b++)
+                    acc[b] += X[b].real() * X[b].real() + X[b].imag() * X[b].imag();
+            }
+            frameCount[c]++;
+        }
+    }
+
+    for (int c = 0; c < cols; c++) {
+        float *lineDest = dest + static_cast<size_t>(c) * N;
+        if (frameCount[c] == 0) {
+            std::fill(lineDest, lineDest + N, negInf);
+            continue;
+        }
+        // Same |X/N|² scaling and fftshift as powerLineDb; the mean is over
+        // the frames actually read.
+        const float *acc = set.accum.data() + static_cast<size_t>(c) * N;
+        const float scale = 1.0f / (static_cast<float>(N) * N * (peak ? 1 : frameCount[c]));
+        for (int i = 0; i < N; i++)
+            lineDest[i] = log2f(acc[i ^ (N >> 1)] * scale) * logMultiplier;
     }
+    return true;
 }
 
 void SpectrogramPlot::getLine(float *dest, size_t sample)
@@ -823,6 +1627,7 @@ void SpectrogramPlot::getLine(float *dest, size_t sample)
             return;
         }
 
+        const float *window = windows_->window.data();
         for (int i = 0; i < fftSize; i++) {
             buffer[i] *= window[i];
         }
@@ -860,9 +1665,12 @@ std::vector<float> SpectrogramPlot::getSpectrumLine(size_t sample)
     }
     const size_t tile = (sample / tileStride) * tileStride;
     const size_t column = (sample - tile) / stride;   // < linesPerTile() by construction
-    const float *fftTile = getFFTTile(tile);
-    const float *col = &fftTile[column * (size_t)fftSize];
-    std::copy(col, col + fftSize, line.begin());
+    const int16_t *fftTile = getFFTTile(tile);
+    if (fftTile == nullptr) {
+        std::fill(line.begin(), line.end(), -std::numeric_limits<float>::infinity());
+        return line;
+    }
+    sampleconvert::active().decodeDb(&fftTile[column * (size_t)fftSize], fftSize, line.data());
     return line;
 }
 
@@ -871,13 +1679,13 @@ int SpectrogramPlot::getStride()
     return fftSize * nfftSkip / zoomLevel;
 }
 
-float SpectrogramPlot::getTunerPhaseInc()
+float SpectrogramPlot::getTunerPhaseInc(Tuner &tuner)
 {
     auto freq = 0.5f - tuner.centre() / (float)fftSize;
     return freq * Tau;
 }
 
-std::vector<float> SpectrogramPlot::getTunerTaps()
+std::vector<float> SpectrogramPlot::getTunerTaps(Tuner &tuner)
 {
     float cutoff = tuner.deviation() / (float)fftSize;
     float gain = pow(10.0f, powerMax / -10.0f);
@@ -897,15 +1705,34 @@ int SpectrogramPlot::linesPerTile()
 
 bool SpectrogramPlot::mouseEvent(QEvent::Type type, QMouseEvent event)
 {
-    if (tunerEnabled())
-        return tuner.mouseEvent(type, event);
+    // The active tuner gets first refusal, so where two overlap the drag
+    // moves the one being worked on. Grabbing another's cursor makes that
+    // tuner the active one.
+    if (channelInUse(activeTuner()) && activeTuner().tuner->mouseEvent(type, event))
+        return true;
+    for (size_t i = 0; i < tuners_.size(); i++) {
+        if (i == activeTuner_ || !channelInUse(*tuners_[i]))
+            continue;
+        if (tuners_[i]->tuner->mouseEvent(type, event)) {
+            activeTuner_ = i;
+            emit repaint();
+            return true;
+        }
+    }
 
     return false;
 }
 
 std::shared_ptr<AbstractSampleSource> SpectrogramPlot::output()
 {
-    return tunerTransform;
+    return activeTuner().transform;
+}
+
+std::shared_ptr<AbstractSampleSource> SpectrogramPlot::derivedOutput()
+{
+    if (tunerDecimationEnabled_)
+        return activeTuner().decimator;
+    return activeTuner().transform;
 }
 
 void SpectrogramPlot::setFFTSize(int size)
@@ -913,13 +1740,9 @@ void SpectrogramPlot::setFFTSize(int size)
     float sizeScale = float(size) / float(fftSize);
     fftSize = size;
     fft.reset(new FFT(fftSize));
-    // FFTW plans in the worker pool are size-specific — drop them so they
-    // get rebuilt at the new size on the next reassigned paint.
+    // FFTW plans in the work sets are size-specific — retire them so each
+    // thread builds sets at the new size on its next tile.
     invalidateWorkSetPool();
-
-    window.reset(new float[fftSize]);
-    windowTimeWeighted.reset(new float[fftSize]);
-    windowDerivative.reset(new float[fftSize]);
     rebuildWindows();
 
     if (inputSource->realSignal()) {
@@ -927,24 +1750,30 @@ void SpectrogramPlot::setFFTSize(int size)
     } else {
         setHeight(fftSize);
     }
-    auto dev = tuner.deviation();
-    auto centre = tuner.centre();
-    tuner.setHeight(height());
-    tuner.setDeviation( dev * sizeScale );
-    tuner.setCentre( centre * sizeScale );
+    for (auto &channel : tuners_) {
+        Tuner &tuner = *channel->tuner;
+        auto dev = tuner.deviation();
+        auto centre = tuner.centre();
+        tuner.setHeight(height());
+        tuner.setDeviation( dev * sizeScale );
+        tuner.setCentre( centre * sizeScale );
+    }
+
+    updatePyramid();
 }
 
 void SpectrogramPlot::setPowerMax(int power)
 {
     powerMax = power;
-    pixmapCache.clear();
+    // Only the palette changes; tile images keep their indices.
+    rebuildPalette();
     tunerMoved();
 }
 
 void SpectrogramPlot::setPowerMin(int power)
 {
     powerMin = power;
-    pixmapCache.clear();
+    rebuildPalette();
 }
 
 void SpectrogramPlot::setZoomLevel(int zoom)
@@ -964,16 +1793,47 @@ void SpectrogramPlot::setSampleRate(double rate)
 
 void SpectrogramPlot::setSpectrogramMode(int newMode)
 {
-    SpectrogramMode m = (newMode == static_cast<int>(SpectrogramMode::Reassigned))
-                            ? SpectrogramMode::Reassigned
-                            : SpectrogramMode::Standard;
+    SpectrogramMode m = SpectrogramMode::Standard;
+    if (newMode >= static_cast<int>(SpectrogramMode::Standard) &&
+        newMode <= static_cast<int>(SpectrogramMode::Multitaper))
+        m = static_cast<SpectrogramMode>(newMode);
     if (m == mode) return;
+    const bool tapersChanged = (m == SpectrogramMode::Multitaper || mode == SpectrogramMode::Multitaper);
     mode = m;
+    if (tapersChanged)
+        rebuildWindows();
     ++renderEpoch_;
     // Cache keys include the mode, so old tiles will sit unused; clear
     // them to free the budget for the new render path.
-    pixmapCache.clear();
-    fftCache.clear();
+    clearTileCaches();
+    emit repaint();
+}
+
+void SpectrogramPlot::setAverageCount(int count)
+{
+    count = clamp(count, 2, 8);
+    if (count == averageCount) return;
+    averageCount = count;
+    if (mode == SpectrogramMode::Multitaper)
+        rebuildWindows();
+    if (mode != SpectrogramMode::Welch && mode != SpectrogramMode::Multitaper) return;
+    ++renderEpoch_;
+    clearTileCaches();
+    emit repaint();
+}
+
+void SpectrogramPlot::setColumnDecimation(int decimation)
+{
+    ColumnDecimation d = ColumnDecimation::Max;
+    if (decimation == static_cast<int>(ColumnDecimation::Skip))
+        d = ColumnDecimation::Skip;
+    else if (decimation == static_cast<int>(ColumnDecimation::Mean))
+        d = ColumnDecimation::Mean;
+    if (d == columnDecimation) return;
+    columnDecimation = d;
+    if (mode != SpectrogramMode::Standard) return;
+    ++renderEpoch_;
+    clearTileCaches();
     emit repaint();
 }
 
@@ -983,8 +1843,7 @@ void SpectrogramPlot::setReassignmentFloor(int floorDb)
     reassignmentFloorDb = floorDb;
     if (mode != SpectrogramMode::Reassigned) return;
     ++renderEpoch_;
-    pixmapCache.clear();
-    fftCache.clear();
+    clearTileCaches();
     emit repaint();
 }
 
@@ -998,8 +1857,7 @@ void SpectrogramPlot::setWindowType(int wt)
     rebuildWindows();
     if (mode != SpectrogramMode::Reassigned) return;
     ++renderEpoch_;
-    pixmapCache.clear();
-    fftCache.clear();
+    clearTileCaches();
     emit repaint();
 }
 
@@ -1012,8 +1870,30 @@ void SpectrogramPlot::setSplatMethod(int sm)
     splatMethod = s;
     if (mode != SpectrogramMode::Reassigned) return;
     ++renderEpoch_;
-    pixmapCache.clear();
-    fftCache.clear();
+    clearTileCaches();
+    emit repaint();
+}
+
+void SpectrogramPlot::setPowerPyramidEnabled(bool enabled)
+{
+    if (pyramidEnabled_ == enabled)
+        return;
+    pyramidEnabled_ = enabled;
+    updatePyramid();
+    // Tiles already served from (or computed instead of) the pyramid differ
+    // slightly from the other path, so start over rather than mix them.
+    ++renderEpoch_;
+    clearTileCaches();
+    emit repaint();
+}
+
+void SpectrogramPlot::setSlidingDftEnabled(bool enabled)
+{
+    if (slidingDftEnabled_ == enabled)
+        return;
+    slidingDftEnabled_ = enabled;
+    ++renderEpoch_;
+    clearTileCaches();
     emit repaint();
 }
 
@@ -1042,31 +1922,98 @@ void SpectrogramPlot::enableAnnoColors(bool enabled)
     sigmfAnnotationColors = enabled;
 }
 
+SpectrogramPlot::TunerChannel &SpectrogramPlot::createTuner()
+{
+    auto channel = std::make_unique<TunerChannel>();
+    channel->name = tr("Tuner %1").arg(nextTunerNumber_++);
+    channel->tuner.reset(new Tuner(height(), nullptr));
+    channel->transform = std::make_shared<TunerTransform>(inputBlocks);
+    channel->decimator = std::make_shared<TunerDecimator>(inputBlocks, channel->transform);
+    TunerChannel *ch = channel.get();
+    connect(ch->tuner.get(), &Tuner::tunerMoved, this, [this, ch]() { retune(*ch); });
+    tuners_.push_back(std::move(channel));
+    retune(*ch);
+    return *ch;
+}
+
+bool SpectrogramPlot::channelInUse(TunerChannel &channel)
+{
+    return (channel.transform->subscriberCount() > 0 || channel.decimator->subscriberCount() > 0);
+}
+
+bool SpectrogramPlot::tunerInUse(int index)
+{
+    return channelInUse(*tuners_[index]);
+}
+
+void SpectrogramPlot::setActiveTuner(int index)
+{
+    if (index < 0 || index >= tunerCount() || static_cast<size_t>(index) == activeTuner_)
+        return;
+    activeTuner_ = index;
+    emit repaint();
+}
+
+int SpectrogramPlot::addTuner(int centreY)
+{
+    const int dev = activeTuner().tuner->deviation();
+    TunerChannel &channel = createTuner();
+    if (centreY < 0) centreY = 0;
+    if (centreY > height()) centreY = height();
+    channel.tuner->setDeviation(dev);
+    channel.tuner->setCentre(centreY);
+    activeTuner_ = tuners_.size() - 1;
+    emit repaint();
+    return static_cast<int>(activeTuner_);
+}
+
+bool SpectrogramPlot::removeTuner(int index)
+{
+    if (tuners_.size() <= 1 || index < 0 || index >= tunerCount() || tunerInUse(index))
+        return false;
+    // Nothing reads from it, so its caches go with it. The Tuner's
+    // destruction drops the retune connection.
+    tuners_.erase(tuners_.begin() + index);
+    if (activeTuner_ > static_cast<size_t>(index) || activeTuner_ >= tuners_.size())
+        activeTuner_--;
+    emit repaint();
+    return true;
+}
+
 bool SpectrogramPlot::tunerEnabled()
 {
-    return (tunerTransform->subscriberCount() > 0);
+    return channelInUse(activeTuner());
 }
 
-double SpectrogramPlot::tunerOffsetHz()
+double SpectrogramPlot::tunerOffsetHz(Tuner &tuner)
 {
     if (height() <= 0) return 0.0;
     return (0.5 - tuner.centre() / (double)height()) * sampleRate;
 }
 
-double SpectrogramPlot::tunerBandwidthHz()
+double SpectrogramPlot::tunerBandwidthHz(Tuner &tuner)
 {
     if (height() <= 0) return 0.0;
     return tuner.deviation() * 2.0 / (double)height() * sampleRate;
 }
 
+double SpectrogramPlot::tunerOffsetHz()
+{
+    return tunerOffsetHz(*activeTuner().tuner);
+}
+
+double SpectrogramPlot::tunerBandwidthHz()
+{
+    return tunerBandwidthHz(*activeTuner().tuner);
+}
+
 void SpectrogramPlot::setTunerCentreY(int y)
 {
     // Clamp into the plot so the cursors stay visible. The tuner uses
     // [0..height()] in plot pixels; freq mapping is in getTunerPhaseInc().
     if (y < 0) y = 0;
     if (y > height()) y = height();
-    tuner.setCentre(y);
-    tunerMoved();
+    activeTuner().tuner->setCentre(y);
 }
 
 void SpectrogramPlot::setTunerBandHz(double offsetHz, double bwHz)
@@ -1088,16 +2035,23 @@ void SpectrogramPlot::setTunerBandHz(double offsetHz, double bwHz)
     int dev = (int)std::lround(bwHz * h / (2.0 * sampleRate));
     if (dev < 1) dev = 1;
     if (dev > h / 2) dev = h / 2;
+    Tuner &tuner = *activeTuner().tuner;
     tuner.setCentre(centre);
     tuner.setDeviation(dev);
-    tunerMoved();
 }
 
 void SpectrogramPlot::tunerMoved()
+{
+    for (auto &channel : tuners_)
+        retune(*channel);
+}
+
+void SpectrogramPlot::retune(TunerChannel &channel)
 {
     LatencyLog::mark("tunerMoved start");
-    const float newFreq = getTunerPhaseInc();
-    tunerTransform->setFrequency(newFreq);
+    Tuner &tuner = *channel.tuner;
+    const float newFreq = getTunerPhaseInc(tuner);
+    channel.transform->setFrequency(newFreq);
 
     // Tap design is the dominant per-event cost during a tuner drag
     // (liquid_firdes_kaiser scales with filter length, which gets large at
@@ -1108,16 +2062,20 @@ void SpectrogramPlot::tunerMoved()
     const int   fft_  = fftSize;
     const float pmax_ = powerMax;
     bool tapsRebuilt = false;
-    if (dev != lastTapsDeviation_ || fft_ != lastTapsFftSize_ ||
-        pmax_ != lastTapsPowerMax_) {
-        tunerTransform->setTaps(getTunerTaps());
-        lastTapsDeviation_ = dev;
-        lastTapsFftSize_   = fft_;
-        lastTapsPowerMax_  = pmax_;
+    if (dev != channel.lastTapsDeviation || fft_ != channel.lastTapsFftSize ||
+        pmax_ != channel.lastTapsPowerMax) {
+        channel.transform->setTaps(getTunerTaps(tuner));
+        channel.lastTapsDeviation = dev;
+        channel.lastTapsFftSize   = fft_;
+        channel.lastTapsPowerMax  = pmax_;
         tapsRebuilt = true;
     }
 
-    tunerTransform->setRelativeBandwith(tuner.deviation() * 2.0 / height());
+    const float relBw = tuner.deviation() * 2.0 / height();
+    channel.transform->setRelativeBandwith(relBw);
+    const int decimation = TunerDecimator::factorFor(relBw);
+    const bool decimationChanged = (decimation != static_cast<int>(channel.decimator->decimation()));
+    channel.decimator->setDecimation(decimation);
 
     // Skip the invalidate fan-out when nothing the downstream chain cares
     // about actually moved. The Tuner emits `tunerMoved` on every mouse
@@ -1126,13 +2084,14 @@ void SpectrogramPlot::tunerMoved()
     // duplicate moves while still being processed). Without this guard
     // every spurious emit triggers a full demod re-render and burns a
     // worker cycle.
-    const bool notifyNeeded = tapsRebuilt ||
-                              newFreq != lastNotifiedFrequency_ ||
-                              dev     != lastNotifiedDeviation_;
+    const bool notifyNeeded = tapsRebuilt || decimationChanged ||
+                              newFreq != channel.lastNotifiedFrequency ||
+                              dev     != channel.lastNotifiedDeviation;
     if (notifyNeeded) {
-        lastNotifiedFrequency_ = newFreq;
-        lastNotifiedDeviation_ = dev;
-        tunerTransform->notifyChanged();
+        channel.lastNotifiedFrequency = newFreq;
+        channel.lastNotifiedDeviation = dev;
+        channel.transform->notifyChanged();
+        channel.decimator->notifyChanged();
     }
 
     LatencyLog::markf("tunerMoved end (taps_rebuilt=%d notify=%d)",
@@ -1146,5 +2105,7 @@ uint qHash(const TileCacheKey &key, uint seed)
            ^ (static_cast<uint>(key.mode) << 24)
            ^ (static_cast<uint>(key.windowType) << 25)
            ^ (static_cast<uint>(key.splatMethod) << 26)
-           ^ static_cast<uint>(key.reassignmentFloorDb);
+           ^ static_cast<uint>(key.reassignmentFloorDb)
+           ^ (static_cast<uint>(key.averageCount) << 27)
+           ^ (static_cast<uint>(key.decimation) << 30);
 }
@@ -20,17 +20,28 @@
 #pragma once
 
 #include <QCache>
-#include <QMutex>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QSet>
 #include <QString>
+#include <QTimer>
+#include <QVector>
 #include <QWidget>
 #include "fft.h"
+#include "fftworkset.h"
+#include "inputblockcache.h"
 #include "inputsource.h"
 #include "plot.h"
+#include "powerpyramid.h"
 #include "tuner.h"
+#include "tunerdecimator.h"
 #include "tunertransform.h"
 
 #include <memory>
 #include <array>
+#include <atomic>
 #include <complex>
 #include <limits>
 #include <math.h>
@@ -43,10 +54,16 @@ class AnnotationLocation;
 // per-frame FFT path. Reassigned = Fulop-Fitz reassignment: three FFTs per
 // frame (analysis window h, time-weighted t·h, and derivative h') used to
 // move each bin's energy to its local centre of mass (t̂, ω̂). See
-// SpectrogramPlot::computeReassignedTile() for the maths.
+// SpectrogramPlot::computeReassignedTile() for the maths. Welch and
+// Multitaper average K power spectra per column (K = averageCount) for a
+// lower-variance estimate of weak signals: Welch over K half-overlapping
+// Hann frames around the column, Multitaper over K DPSS tapers of the
+// column's own frame. See SpectrogramPlot::computeAveragedTile().
 enum class SpectrogramMode {
     Standard = 0,
     Reassigned = 1,
+    Welch = 2,
+    Multitaper = 3,
 };
 
 // Analysis window. Hann is the spectrogram default; Gaussian is the
@@ -66,16 +83,54 @@ enum class SplatMethod {
     Nearest = 1,
 };
 
-// Per-worker FFT plans + scratch buffers used by computeReassignedTile().
-// FFTW plans are not thread-safe (creation must be serialised, and each
-// plan owns its in/out buffers), so parallel tile pre-warm needs one of
-// these per worker. Pool lives on SpectrogramPlot.
-struct FftWorkSet {
-    std::unique_ptr<FFT> fftH, fftTH, fftDH;
-    std::vector<std::complex<float>> bufH, bufTH, bufDH;
-    std::vector<std::complex<float>> outH, outTH, outDH;
-    std::vector<float> accum;   // cols * fftSize linear-power accumulator
-    int size = 0;               // FFT size this set was built for
+// How a Standard column that spans several FFT frames (nfftSkip above the
+// zoom level, so stride >= 2·fftSize) is reduced to one spectrum. Skip
+// transforms only the frame at the column's start, so anything between
+// frames is lost; Max transforms every frame in the stride and keeps the
+// per-bin peak power (short bursts stay visible at any zoom), Mean keeps
+// the average. See SpectrogramPlot::computeDecimatedTile().
+enum class ColumnDecimation {
+    Skip = 0,
+    Max = 1,
+    Mean = 2,
+};
+
+// Analysis window h(n) plus the time-weighted t·h(n) (centred
+// t = n - (N-1)/2) and derivative h'(n) companions used by the reassignment
+// path. Immutable once built: setters swap in a new set, and in-flight tile
+// jobs keep the one they started with.
+struct SpectrogramWindows {
+    std::vector<float> window;
+    std::vector<float> windowTimeWeighted;
+    std::vector<float> windowDerivative;
+    // Multitaper mode only: averageCount DPSS tapers back to back, each
+    // with window's energy so the noise floor reads as in Standard mode.
+    std::vector<float> tapers;
+};
+
+// Everything a tile compute reads from the plot, snapshotted on the GUI
+// thread when the job is created, so an async worker never sees a
+// half-applied setter.
+struct TileParams {
+    int fftSize;
+    int cols;                  // linesPerTile()
+    int stride;                // getStride()
+    SpectrogramMode mode;
+    int reassignmentFloorDb;
+    SplatMethod splatMethod;
+    int averageCount;          // Welch / Multitaper spectra per column
+    ColumnDecimation decimation;
+    // Standard tiles: update each column from the last with a sliding DFT
+    // instead of transforming it from scratch. Only set where it's cheaper
+    // (see SpectrogramPlot::setSlidingDftEnabled).
+    bool slidingDft = false;
+    // Which thread-local work set to compute with; a job queued before a
+    // size change keeps using sets of its own size.
+    fftworkset::Key workSet;
+    std::shared_ptr<const SpectrogramWindows> windows;
+    // Polled once per column; set when the tile is no longer wanted. Null
+    // for synchronous computes.
+    std::shared_ptr<std::atomic<bool>> cancelled;
 };
 
 class SpectrogramPlot : public Plot
@@ -84,8 +139,16 @@ class SpectrogramPlot : public Plot
 
 public:
     SpectrogramPlot(std::shared_ptr<SampleSource<std::complex<float>>> src);
+    ~SpectrogramPlot();
     void invalidateEvent() override;
+    // The active tuner's full-rate output (export, plugins).
     std::shared_ptr<AbstractSampleSource> output() override;
+    // Source for new plots derived from the active tuner: the decimating
+    // channeliser when enabled, otherwise output().
+    std::shared_ptr<AbstractSampleSource> derivedOutput();
+    // Give newly derived plots the decimated tuner output. Plots already
+    // added keep the source they were built on.
+    void setTunerDecimationEnabled(bool enabled) { tunerDecimationEnabled_ = enabled; }
     void paintFront(QPainter &painter, QRect &rect, range_t<size_t> sampleRange) override;
     void paintMid(QPainter &painter, QRect &rect, range_t<size_t> sampleRange) override;
     bool mouseEvent(QEvent::Type type, QMouseEvent event) override;
@@ -107,6 +170,24 @@ public:
     // spectrogram.
     unsigned renderEpoch() const { return renderEpoch_; }
     void setSampleRate(double sampleRate);
+    // Tuners. A spectrogram has one or more, each an independent channel
+    // with its own cursors, tuned-IQ block cache and derived plots, all
+    // reading the capture through one shared InputBlockCache. One of them
+    // is active: it is what the single-tuner calls below, output() and
+    // derivedOutput() refer to. Dragging another's cursors activates it.
+    int tunerCount() const { return static_cast<int>(tuners_.size()); }
+    int activeTunerIndex() const { return static_cast<int>(activeTuner_); }
+    QString tunerName(int index) const { return tuners_[index]->name; }
+    // Whether any plot is derived from tuner `index`.
+    bool tunerInUse(int index);
+    void setActiveTuner(int index);
+    // New tuner centred on plot-pixel y with the active tuner's width;
+    // becomes the active one. Returns its index.
+    int addTuner(int centreY);
+    // Drops tuner `index` and its caches. Refused (false) for the last
+    // tuner and for one that still has derived plots.
+    bool removeTuner(int index);
+    // Whether the active tuner has derived plots (and is drawn).
     bool tunerEnabled();
     // Tuner offset (Hz) from the file's centre frequency: positive = shifted
     // up, negative = down. Matches the convention in getTunerPhaseInc().
@@ -146,6 +227,9 @@ public:
     // Index of the annotation to draw resize handles on (it's being hovered or
     // edited in PlotView), or -1 for none. Purely a paint hint.
     void setActiveAnnotation(int index) { activeAnnotation_ = index; }
+    // The view just scrolled by `samples` (negative = towards the start).
+    // Feeds the pan velocity the tile prefetcher reads ahead along.
+    void notePan(double samples);
 
 public slots:
     void setFFTSize(int size);
@@ -153,11 +237,19 @@ public slots:
     void setPowerMin(int power);
     void setZoomLevel(int zoom);
     void setSkip(int skip);
+    // Reconfigure every tuner (e.g. after a gain change); each tuner's own
+    // cursor moves only reconfigure that one.
     void tunerMoved();
-    // Switch between the standard |STFT|² spectrogram and the Fulop-Fitz
-    // reassigned spectrogram. Only the rendering path changes; FFT size,
-    // zoom, and tuner state are preserved.
+    // Switch between the standard |STFT|² spectrogram, the Fulop-Fitz
+    // reassigned spectrogram and the Welch / multitaper averaged ones
+    // (index matches SpectrogramMode). Only the rendering path changes;
+    // FFT size, zoom, and tuner state are preserved.
     void setSpectrogramMode(int mode);
+    // Spectra averaged per column in Welch / Multitaper mode (2..8).
+    void setAverageCount(int count);
+    // How zoomed-out Standard columns combine the FFT frames in their
+    // stride (index matches ColumnDecimation).
+    void setColumnDecimation(int decimation);
     // Per-bin power floor (dB) below which reassignment is skipped — those
     // bins are rendered at their original (t,ω) so the noise floor still
     // shows up but isn't smeared by meaningless reassignment vectors.
@@ -168,6 +260,16 @@ public slots:
     // Choose Bilinear (default, smoother) vs Nearest (~4× cheaper inner
     // loop) when accumulating |X_h|² onto the reassigned grid.
     void setSplatMethod(int sm);
+    // Serve coarse zoom levels from the precomputed power pyramid (built in
+    // the background and kept in a sidecar). On by default.
+    void setPowerPyramidEnabled(bool enabled);
+    // At high zoom the hop between columns is a few samples. Standard Hann
+    // tiles then update each column from the previous one with a sliding
+    // DFT (N complex MACs per hop sample) rather than a fresh FFT, with the
+    // window applied in the frequency domain. This uses the periodic rather
+    // than the symmetric Hann, so output differs in the last digits. Off by
+    // default.
+    void setSlidingDftEnabled(bool enabled);
 
 private:
     const int linesPerGraduation = 50;
@@ -176,14 +278,65 @@ private:
     std::shared_ptr<SampleSource<std::complex<float>>> inputSource;
     std::vector<AnnotationLocation> visibleAnnotationLocations;
     std::unique_ptr<FFT> fft;
-    std::unique_ptr<float[]> window;
-    // Time-weighted (t·h(n), centred t = n - (N-1)/2) and derivative (h'(n),
-    // closed form for Hann) windows used by the reassignment path. Allocated
-    // and filled in setFFTSize() alongside the analysis window.
-    std::unique_ptr<float[]> windowTimeWeighted;
-    std::unique_ptr<float[]> windowDerivative;
-    QCache<TileCacheKey, QPixmap> pixmapCache;
-    QCache<TileCacheKey, std::array<float, tileSize>> fftCache;
+    // Rebuilt by rebuildWindows() in setFFTSize() and on window-type toggles.
+    std::shared_ptr<const SpectrogramWindows> windows_;
+    // A tile as 8-bit power indices (see rebuildPalette) and the palette
+    // epoch its colour table was last set at.
+    struct TileImage {
+        QImage image;
+        unsigned paletteEpoch;
+    };
+    // Tiles are computed in float but kept as 16-bit fixed-point dB
+    // (sampleconvert::kDbStep), which fits twice as many in the same quota;
+    // the disk cache stores the same format.
+    using TileData = std::array<float, tileSize>;
+    using PackedTile = std::array<int16_t, tileSize>;
+    // Both caches are costed in KiB and capped by MemoryBudget quotas (see
+    // applyMemoryQuotas).
+    QCache<TileCacheKey, TileImage> imageCache;
+    QCache<TileCacheKey, PackedTile> fftCache;
+    int tileBudgetId_ = 0;
+    int imageBudgetId_ = 0;
+
+    // Async tile jobs, like TracePlot's tile tasks: paintMid draws
+    // what's cached, shows a placeholder for the rest and queues one job per
+    // missing tile; each lands in fftCache through its watcher and triggers
+    // a repaint. tileJobs_ holds the jobs still wanted; a job whose tile
+    // scrolls out of view (or whose key goes stale) is flagged cancelled and
+    // dropped from it, and its result discarded. tileWatchers_ tracks every
+    // watcher not yet finished, cancelled or not, so the destructor can wait
+    // for them.
+    //
+    // Jobs also pack what they compute and quantise it into the tile's
+    // image, so the GUI thread only has to cache both.
+    struct TileResult {
+        std::unique_ptr<PackedTile> data;
+        QImage image;
+    };
+    using TileWatcher = QFutureWatcher<TileResult*>;
+    struct TileJob {
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        std::shared_ptr<std::atomic<bool>> started;
+        TileWatcher *watcher = nullptr;
+        bool prefetch = false;
+    };
+    QHash<TileCacheKey, TileJob> tileJobs_;
+    QSet<TileWatcher*> tileWatchers_;
+
+    // Colour table shared by every tile image: the power window applied to
+    // the fixed index scale. Rebuilt (256 entries) when a power slider
+    // moves; images pick it up, by epoch, when next drawn.
+    QVector<QRgb> palette_;
+    unsigned paletteEpoch_ = 0;
+
+    // Pan tracking for the prefetcher, fed by PlotView::scrollContentsBy.
+    // A pan older than kPanIdleMs counts as stopped.
+    static constexpr qint64 kPanIdleMs = 300;
+    static constexpr double kPrefetchSeconds = 0.5;
+    static constexpr int kMaxPrefetchTiles = 8;
+    QElapsedTimer panClock_;
+    QTimer panIdleTimer_;
+    double panVelocity_ = 0.0;   // samples per second, + = towards the end
     uint colormap[256];
 
     int fftSize;
@@ -209,38 +362,119 @@ private:
     WindowType windowType = WindowType::Hann;
     // Splat method when accumulating reassigned energy.
     SplatMethod splatMethod = SplatMethod::Bilinear;
+    // Spectra averaged per column in Welch / Multitaper mode (segments or
+    // tapers); K× the FFT cost of Standard.
+    int averageCount = 4;
+    // Zoomed-out Standard columns: one frame per column by default; Max and
+    // Mean (opt-in from the dock) transform every frame of the stride.
+    ColumnDecimation columnDecimation = ColumnDecimation::Skip;
     // Annotation index to draw resize handles on (-1 = none). Set by PlotView
     // while hovering/editing an annotation; only affects paintAnnotations.
     int activeAnnotation_ = -1;
 
-    // Worker FFT plan + buffer pool for parallel reassigned tile compute.
-    // Plans must be created on a single thread (FFTW planning isn't
-    // thread-safe), so the pool is grown synchronously on the GUI thread
-    // before workers run; workers only call fftwf_execute (thread-safe).
-    QMutex contextPoolMutex_;
-    std::vector<std::unique_ptr<FftWorkSet>> contextPool_;
-
-    Tuner tuner;
-    std::shared_ptr<TunerTransform> tunerTransform;
-
-    // Tap-design memo: liquid_firdes_kaiser is the dominant per-frame cost
-    // during a tuner drag (an O(N²) Bessel evaluation for narrow cutoffs)
-    // but only depends on the inputs below — pure centre-frequency drags
-    // don't change them, so we skip the redesign entirely when nothing's
-    // moved. -1 sentinel forces a fresh design on the first call.
-    int   lastTapsDeviation_ = -1;
-    int   lastTapsFftSize_   = -1;
-    float lastTapsPowerMax_  = std::numeric_limits<float>::quiet_NaN();
-    // Track the (frequency, deviation) the downstream chain was last told
-    // about so we can skip the invalidate fan-out when neither actually
-    // moved. Prevents Tuner::tunerMoved emits with no real change (e.g.
-    // mouse release within the same pixel after a drag) from triggering
-    // a full demod re-render and worker churn.
-    float lastNotifiedFrequency_ = std::numeric_limits<float>::quiet_NaN();
-    int   lastNotifiedDeviation_ = -1;
-
-    QPixmap* getPixmapTile(size_t tile);
-    float* getFFTTile(size_t tile);
+    // Work-set generation the tile computes ask fftworkset::local() for
+    // (see fftworkset.h); invalidateWorkSetPool takes a new one. Only
+    // touched on the GUI thread: jobs carry their key in TileParams.
+    uint64_t workSetGeneration_ = 0;
+    bool workSetRealInput_ = false;   // whether sets carry r2c plans
+
+    // One tuner channel. Channels share nothing but inputBlocks, so
+    // retuning one never invalidates another's caches or plots.
+    struct TunerChannel {
+        QString name;
+        std::unique_ptr<Tuner> tuner;
+        std::shared_ptr<TunerTransform> transform;
+        // Decimated view of transform for narrowband derived plots; its
+        // factor follows the tuner bandwidth (see retune).
+        std::shared_ptr<TunerDecimator> decimator;
+
+        // Tap-design memo: liquid_firdes_kaiser is the dominant per-frame cost
+        // during a tuner drag (an O(N²) Bessel evaluation for narrow cutoffs)
+        // but only depends on the inputs below — pure centre-frequency drags
+        // don't change them, so we skip the redesign entirely when nothing's
+        // moved. -1 sentinel forces a fresh design on the first call.
+        int   lastTapsDeviation = -1;
+        int   lastTapsFftSize   = -1;
+        float lastTapsPowerMax  = std::numeric_limits<float>::quiet_NaN();
+        // Track the (frequency, deviation) the downstream chain was last told
+        // about so we can skip the invalidate fan-out when neither actually
+        // moved. Prevents Tuner::tunerMoved emits with no real change (e.g.
+        // mouse release within the same pixel after a drag) from triggering
+        // a full demod re-render and worker churn.
+        float lastNotifiedFrequency = std::numeric_limits<float>::quiet_NaN();
+        int   lastNotifiedDeviation = -1;
+    };
+    // Converted input IQ shared by every channel's tuner and decimator.
+    std::shared_ptr<InputBlockCache> inputBlocks;
+    std::vector<std::unique_ptr<TunerChannel>> tuners_;
+    size_t activeTuner_ = 0;
+    int nextTunerNumber_ = 1;   // for the "Tuner N" names
+    bool tunerDecimationEnabled_ = false;
+    TunerChannel &activeTuner() { return *tuners_[activeTuner_]; }
+    TunerChannel &createTuner();
+    bool channelInUse(TunerChannel &channel);
+    // Push a channel's cursor position into its transform and decimator.
+    void retune(TunerChannel &channel);
+
+    // Max-decimated overview for the current FFT size, or null (disabled,
+    // capture too short, source not a file). Standard-mode tiles whose column
+    // stride spans at least two frames are filled from it once the covering
+    // part is built, skipping the per-column FFTs.
+    bool pyramidEnabled_ = true;
+    bool slidingDftEnabled_ = false;
+    std::shared_ptr<PowerPyramid> pyramid_;
+    // InputSource::contentKey() of the open capture, refreshed on every
+    // invalidateEvent; empty when the source has no stable identity (not a
+    // file, or still inflating). Keys the pyramid and the disk tile cache.
+    QByteArray contentKey_;
+
+    // Tile image with the current palette, or null if its packed tile isn't
+    // available yet.
+    QImage* getTileImage(size_t tile);
+    // Packed tile from memory or the pyramid, or null; never computes.
+    const int16_t* peekFFTTile(size_t tile);
+    // Packed tile, computed synchronously on a miss (for one-off readers
+    // such as getSpectrumLine; painting goes through requestTiles).
+    const int16_t* getFFTTile(size_t tile);
+    TileParams tileParams() const;
+    TileParams tileParams(int zoom, int skip) const;
+    // Queue jobs for the tiles in `visible` (and the prefetch set) that
+    // aren't cached or in flight, and cancel in-flight jobs for the rest.
+    void requestTiles(const std::vector<size_t> &visible);
+    // Tiles worth computing before they're needed: while panning, the next
+    // few along the direction of travel; while idle, the visible stretch at
+    // the neighbouring zoom levels.
+    std::vector<TileCacheKey> prefetchKeys(const std::vector<size_t> &visible);
+    void startTileJob(const TileCacheKey &key, bool prefetch);
+    void tileJobFinished(const TileCacheKey &key, TileWatcher *watcher);
+    // Rows a tile image has: fftSize, or fftSize / 2 for real-valued input.
+    int tileRows() const;
+    // Quantise a packed tile into an Indexed8 image of `rows` rows (see
+    // rebuildPalette). Reads only its arguments, so safe on workers.
+    static QImage quantizeTile(const int16_t *tile, int size, int rows);
+    // Compute `tile` in float into a per-thread scratch tile and pack it
+    // into `dest`. Reads only `p` and inputSource, so safe on workers.
+    // False if cancelled part-way.
+    bool computePackedTile(int16_t *dest, size_t tile, const TileParams &p);
+    // This thread's float tile to compute into before packing.
+    static TileData& scratchTile();
+    // Cache `image` as key's tile image; null if the cache refused it.
+    TileImage* insertTileImage(const TileCacheKey &key, const QImage &image);
+    void rebuildPalette();
+    void cancelTileJobs();
+    // Drop all cached tiles and in-flight jobs.
+    void clearTileCaches();
+    void refreshContentKey();
+    // (Re)create pyramid_ if the FFT size or the source contents changed.
+    void updatePyramid();
+    bool pyramidCovers(size_t tile);
+    bool pyramidCovers(size_t tile, int stride);
+    // DiskTileCache entry name for a tile of the open capture, or empty when
+    // tiles of this source can't be persisted.
+    QString diskTileName(const TileCacheKey &key) const;
+    // Hand a freshly computed tile to the disk cache without blocking the
+    // GUI thread on the write.
+    void storeTileOnDisk(const QString &name, const int16_t *data);
     void getLine(float *dest, size_t sample);
     // (Re)compute the analysis window and its companions based on the
     // current `fftSize` and `windowType`. Called from setFFTSize() and on
@@ -250,35 +484,44 @@ private:
     // buffers in `set`. Drop-in replacement for the previous getLine()
     // loop; the work-set indirection lets multiple tiles compute in
     // parallel safely. Output layout matches getFFTTile()'s contract.
-    void computeStandardTile(float *dest, size_t tile, FftWorkSet &set);
+    // Reads only `p` and inputSource. False if cancelled part-way.
+    bool computeStandardTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set);
     // Compute one full reassigned tile: zero-init the destination, then for
     // each frame run three FFTs (h, t·h, h'), compute (t̂, ω̂) per bin and
     // splat |X_h|² into the accumulator. Result is converted to dB so the
     // colormap stage stays unchanged. The work set carries the per-thread
     // FFT plans + buffers so multiple workers can compute tiles in parallel.
-    void computeReassignedTile(float *dest, size_t tile, FftWorkSet &set);
-    // Pool helpers. acquire/release are thread-safe (mutex-guarded).
-    // ensureWorkSetPool grows the pool on the GUI thread before parallel
-    // dispatch so no worker has to do FFTW planning. invalidate clears the
-    // pool when the FFT size changes (plans are size-specific).
-    std::unique_ptr<FftWorkSet> acquireWorkSet();
-    void releaseWorkSet(std::unique_ptr<FftWorkSet> set);
-    void ensureWorkSetPool(int target);
+    bool computeReassignedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set);
+    // Compute one Welch or Multitaper tile: each column's K frames
+    // (offset Hann frames or DPSS-tapered copies of one frame) go through
+    // one batched plan a block of columns at a time, and the column is the
+    // mean of their |X|², in dB.
+    bool computeAveragedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set);
+    // Compute one Standard tile whose columns each cover several frames:
+    // every frame of the stride goes through the batched tile plan, and
+    // each column keeps the per-bin max or mean power of its frames, in dB.
+    bool computeDecimatedTile(float *dest, size_t tile, const TileParams &p, FftWorkSet &set);
+    // Key for the thread-local work sets matching the current FFT size.
+    fftworkset::Key workSetKey() const;
+    // Retire every work set built so far (FFT size, input type or wisdom
+    // changed); each thread builds fresh ones on its next tile.
     void invalidateWorkSetPool();
-    // Compute the cache-miss tile list in parallel and insert results
-    // into fftCache. Dispatches Standard or Reassigned compute based on
-    // the current mode; both modes share the same pool.
-    void prewarmTiles(const std::vector<size_t> &tiles);
     int getStride();
-    float getTunerPhaseInc();
-    std::vector<float> getTunerTaps();
+    float getTunerPhaseInc(Tuner &tuner);
+    std::vector<float> getTunerTaps(Tuner &tuner);
     int linesPerTile();
     void paintFrequencyScale(QPainter &painter, QRect &rect);
     // Live centre-frequency / pass-band-width readout drawn next to the tuner
     // band while it's enabled, so dragging the tuner cursors shows the filter
     // width (e.g. "BW 25 kHz") and centre frequency in Hz instead of pixels.
-    void paintTunerReadout(QPainter &painter, QRect &rect);
+    // Headed with the tuner's name once there is more than one.
+    void paintTunerReadout(QPainter &painter, QRect &rect, TunerChannel &channel);
+    // tunerOffsetHz() / tunerBandwidthHz() for any tuner.
+    double tunerOffsetHz(Tuner &tuner);
+    double tunerBandwidthHz(Tuner &tuner);
     void paintAnnotations(QPainter &painter, QRect &rect, range_t<size_t> sampleRange);
+    // Resize imageCache/fftCache to this plot's MemoryBudget quotas.
+    void applyMemoryQuotas();
 };
 
 class TileCacheKey
@@ -289,7 +532,9 @@ public:
                  SpectrogramMode mode = SpectrogramMode::Standard,
                  int reassignmentFloorDb = 0,
                  WindowType windowType = WindowType::Hann,
-                 SplatMethod splatMethod = SplatMethod::Bilinear) {
+                 SplatMethod splatMethod = SplatMethod::Bilinear,
+                 int averageCount = 0,
+                 ColumnDecimation decimation = ColumnDecimation::Skip) {
         this->fftSize = fftSize;
         this->zoomLevel = zoomLevel;
         this->nfftSkip = nfftSkip;
@@ -301,6 +546,11 @@ public:
         this->reassignmentFloorDb = reassigned ? reassignmentFloorDb : 0;
         this->windowType = reassigned ? windowType : WindowType::Hann;
         this->splatMethod = reassigned ? splatMethod : SplatMethod::Bilinear;
+        const bool averaged = (mode == SpectrogramMode::Welch || mode == SpectrogramMode::Multitaper);
+        this->averageCount = averaged ? averageCount : 0;
+        // Only Standard columns spanning two or more frames are decimated.
+        const bool decimated = (mode == SpectrogramMode::Standard && nfftSkip >= 2 * zoomLevel);
+        this->decimation = decimated ? decimation : ColumnDecimation::Skip;
     }
 
     bool operator==(const TileCacheKey &k2) const {
@@ -311,7 +561,9 @@ public:
                (this->mode == k2.mode) &&
                (this->reassignmentFloorDb == k2.reassignmentFloorDb) &&
                (this->windowType == k2.windowType) &&
-               (this->splatMethod == k2.splatMethod);
+               (this->splatMethod == k2.splatMethod) &&
+               (this->averageCount == k2.averageCount) &&
+               (this->decimation == k2.decimation);
     }
 
     int fftSize;
@@ -322,6 +574,8 @@ public:
     int reassignmentFloorDb;
     WindowType windowType;
     SplatMethod splatMethod;
+    int averageCount;
+    ColumnDecimation decimation;
 };
 
 class AnnotationLocation
@@ -17,8 +17,8 @@
  *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <QCache>
 #include <QDebug>
-#include <QPixmapCache>
 #include <QTextStream>
 #include <QtConcurrent>
 #include <QThreadPool>
@@ -29,9 +29,34 @@
 #include "samplesource.h"
 #include "traceplot.h"
 #include "latencylog.h"
+#include "memorybudget.h"
 
 #define INSPECTRUM_TRACE_DEBUG 0
 
+namespace {
+
+// Rendered tiles of all trace plots (keys carry the plot's address), costed
+// in KiB and capped by the MemoryBudget TracePixmaps quota. GUI thread only.
+// Never destroyed, so no QPixmap outlives QApplication at exit.
+QCache<QString, QPixmap> &tileCache()
+{
+    static QCache<QString, QPixmap> *cache = []() {
+        auto c = new QCache<QString, QPixmap>();
+        auto &budget = MemoryBudget::instance();
+        budget.track(MemoryBudget::TracePixmaps,
+                     [c]() { return static_cast<qint64>(c->totalCost()) << 10; });
+        auto apply = [c]() {
+            c->setMaxCost(static_cast<int>(MemoryBudget::instance().quota(MemoryBudget::TracePixmaps) >> 10));
+        };
+        QObject::connect(&budget, &MemoryBudget::quotasChanged, apply);
+        apply();
+        return c;
+    }();
+    return *cache;
+}
+
+} // namespace
+
 TracePlot::TracePlot(std::shared_ptr<AbstractSampleSource> source) : Plot(source) {
     connect(this, &TracePlot::imageReady, this, &TracePlot::handleImage);
     // debounce timer: batch up rapid tile requests
@@ -478,8 +503,8 @@ QPixmap TracePlot::getTile(size_t tileID, size_t sampleCount, int tileWidthPx)
        << "_" << tileWidthPx;
     currentFrameKeys.insert(key);
     // if we already have a cached pixmap, return it immediately
-    if (QPixmapCache::find(key, &pixmap))
-        return pixmap;
+    if (QPixmap *cached = tileCache().object(key))
+        return *cached;
 
     // schedule a new tile-draw if not already running or pending
     if (!tasks.contains(key) && !pendingInfo.contains(key)) {
@@ -548,11 +573,17 @@ void TracePlot::handleImage(QString key, QImage image)
     // worker was running), drop it without caching.
     if (!currentFrameKeys.contains(key))
         return;
-    auto pixmap = QPixmap::fromImage(image);
-    QPixmapCache::insert(key, pixmap);
+    auto pixmap = new QPixmap(QPixmap::fromImage(image));
+    const size_t bytes = static_cast<size_t>(pixmap->width()) * pixmap->height() * pixmap->depth() / 8;
+    tileCache().insert(key, pixmap, static_cast<int>((bytes + 1023) >> 10));
     emit repaint();
 }
 
+void TracePlot::clearTileCache()
+{
+    tileCache().clear();
+}
+
 void TracePlot::plotTrace(QPainter &painter, const QRect &rect, float *samples,
                           size_t count, int step, double mid, double invRange)
 {
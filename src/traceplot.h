@@ -56,6 +56,9 @@ public:
     // line connecting consecutive peaks so the period is visible at a
     // glance. Pass an empty vector to clear.
     void setPeriodMarkers(std::vector<size_t> peakSamples);
+    // Drop every cached trace tile (all plots). For settings that change
+    // what a tile shows without changing its key, e.g. demod parameters.
+    static void clearTileCache();
 
 signals:
     void imageReady(QString key, QImage image);
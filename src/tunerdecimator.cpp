@@ -0,0 +1,137 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "tunerdecimator.h"
+#include <liquid/liquid.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+TunerDecimator::TunerDecimator(std::shared_ptr<SampleSource<std::complex<float>>> src,
+                               std::shared_ptr<TunerTransform> tuner)
+    : SampleBuffer(src), tuner_(std::move(tuner))
+{
+}
+
+void TunerDecimator::work(void *input, void *output, int count, size_t sampleid)
+{
+    tuner_->work(input, output, count, sampleid);
+}
+
+size_t TunerDecimator::count()
+{
+    const size_t d = static_cast<size_t>(factor_.load(std::memory_order_relaxed));
+    return (src->count() + d - 1) / d;
+}
+
+double TunerDecimator::rate()
+{
+    return src->rate() / factor_.load(std::memory_order_relaxed);
+}
+
+float TunerDecimator::relativeBandwidth()
+{
+    return std::min(1.0f, tuner_->relativeBandwidth() * factor_.load(std::memory_order_relaxed));
+}
+
+size_t TunerDecimator::decimation()
+{
+    return static_cast<size_t>(factor_.load(std::memory_order_relaxed)) * src->decimation();
+}
+
+void TunerDecimator::setDecimation(int factor)
+{
+    factor_.store(std::max(1, factor), std::memory_order_relaxed);
+}
+
+int TunerDecimator::factorFor(float relativeBandwidth)
+{
+    if (!(relativeBandwidth > 0.0f) || relativeBandwidth >= 0.5f)
+        return 1;
+    const int limit = static_cast<int>(std::floor(0.5f / relativeBandwidth));
+    int factor = 1;
+    while (factor * 2 <= limit)
+        factor *= 2;
+    return factor;
+}
+
+std::unique_ptr<std::complex<float>[]> TunerDecimator::getSamples(size_t start, size_t length)
+{
+    const size_t d = static_cast<size_t>(factor_.load(std::memory_order_relaxed));
+    const size_t total = src->count();
+    const size_t outTotal = (total + d - 1) / d;
+    if (length == 0)
+        return std::make_unique<std::complex<float>[]>(0);
+    if (start >= outTotal || length > outTotal - start)
+        return nullptr; // out of range — match the upstream contract
+
+    const TunerTransform::Params params = tuner_->snapshot();
+
+    // firdecim computes each output right after pushing the first of its d
+    // inputs, so output k lands on input k·d when the input run starts on
+    // a multiple of d. Lead in by enough whole outputs to fill the filter,
+    // and read [(start - lead)·d, (start + length)·d); whatever of that lies
+    // before the file start or past its end is zeros, which is what a fresh
+    // filter holds anyway and what the last output never reaches. The run
+    // goes through one filter in chunks of about kChunkInputs, so a long
+    // request at a large factor doesn't hold all of its input at once.
+    const size_t lead = (params.taps.size() + d - 1) / d;
+    const ptrdiff_t first = (static_cast<ptrdiff_t>(start) - static_cast<ptrdiff_t>(lead)) * static_cast<ptrdiff_t>(d);
+    const size_t outputs = lead + length;
+    const size_t chunkOutputs = std::max<size_t>(1, kChunkInputs / d);
+
+    firdecim_crcf decim = firdecim_crcf_create(static_cast<unsigned int>(d),
+                                               const_cast<float*>(params.taps.data()),
+                                               static_cast<unsigned int>(params.taps.size()));
+    auto out = std::make_unique<std::complex<float>[]>(length);
+    std::vector<std::complex<float>> mixed;
+    std::vector<std::complex<float>> filtered;
+    bool ok = true;
+    for (size_t o = 0; o < outputs && ok; o += chunkOutputs) {
+        const size_t n = std::min(chunkOutputs, outputs - o);
+        const ptrdiff_t chunkFirst = first + static_cast<ptrdiff_t>(o * d);
+        const ptrdiff_t chunkEnd = chunkFirst + static_cast<ptrdiff_t>(n * d);
+        mixed.assign(n * d, std::complex<float>(0.0f, 0.0f));
+        const size_t readFrom = static_cast<size_t>(std::max<ptrdiff_t>(chunkFirst, 0));
+        const size_t readTo = static_cast<size_t>(std::min<ptrdiff_t>(chunkEnd, static_cast<ptrdiff_t>(total)));
+        if (readTo > readFrom) {
+            // Borrowed view so a cf32 input is mixed straight out of the mmap.
+            auto raw = src->getSampleView(readFrom, readTo - readFrom);
+            if (!raw) {
+                ok = false;
+                break;
+            }
+            TunerTransform::mixDown(params.frequency, raw.data,
+                                    mixed.data() + (static_cast<ptrdiff_t>(readFrom) - chunkFirst),
+                                    static_cast<int>(readTo - readFrom), readFrom);
+        }
+        filtered.resize(n);
+        firdecim_crcf_execute_block(decim, mixed.data(), static_cast<unsigned int>(n), filtered.data());
+        // Drop the lead-in outputs.
+        for (size_t i = 0; i < n; i++) {
+            if (o + i >= lead)
+                out[o + i - lead] = filtered[i];
+        }
+    }
+    firdecim_crcf_destroy(decim);
+    if (!ok)
+        return nullptr;
+    return out;
+}
@@ -0,0 +1,70 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "samplebuffer.h"
+#include "tunertransform.h"
+#include <atomic>
+#include <memory>
+
+// Decimating (channeliser) output of a TunerTransform for narrowband derived
+// plots. The tuner's own output stays at the input rate even when its pass
+// band is 1/1000 of it, so every demod and trace behind it processed 1000×
+// more samples than the band carries. This runs the tuner's NCO mix and
+// FIR taps as a polyphase decimator (liquid firdecim: one dot product per
+// output sample) and publishes rate() and count() reduced by decimation().
+//
+// Output sample k is the tuner's output at input sample k·decimation(), so
+// a plot maps PlotView's file-sample ranges onto it by dividing (see
+// Plot::sourceRange). The factor follows the tuner bandwidth — set by
+// SpectrogramPlot alongside the tuner's taps — and changes are announced
+// with notifyChanged(), like the tuner's own.
+class TunerDecimator : public SampleBuffer<std::complex<float>, std::complex<float>>
+{
+public:
+    TunerDecimator(std::shared_ptr<SampleSource<std::complex<float>>> src,
+                   std::shared_ptr<TunerTransform> tuner);
+    // Only reached through SampleBuffer::getSamples, which getSamples()
+    // below overrides; produces the tuner's full-rate output.
+    void work(void *input, void *output, int count, size_t sampleid) override;
+    bool workIsReentrant() override { return true; }
+    std::unique_ptr<std::complex<float>[]> getSamples(size_t start, size_t length) override;
+    size_t count() override;
+    double rate() override;
+    float relativeBandwidth() override;
+    size_t decimation() override;
+    // Input samples per output sample (>= 1). Takes effect on the next
+    // read; follow with notifyChanged().
+    void setDecimation(int factor);
+    void notifyChanged() { invalidate(); }
+
+    // Largest power of two that keeps a pass band of `relativeBandwidth`
+    // (fraction of the input rate) inside half the decimated Nyquist, so
+    // the FIR's transition band doesn't alias back into it either.
+    static int factorFor(float relativeBandwidth);
+
+private:
+    // Input samples mixed and filtered per pass.
+    static const size_t kChunkInputs = 1 << 20;
+
+    std::shared_ptr<TunerTransform> tuner_;
+    std::atomic<int> factor_{1};
+};
@@ -18,53 +18,200 @@
  */
 
 #include "tunertransform.h"
-#include <liquid/liquid.h>
+#include <QElapsedTimer>
 #include <QMutexLocker>
 #include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <limits>
+#include <random>
+#include "memorybudget.h"
 #include "util.h"
 
-TunerTransform::TunerTransform(std::shared_ptr<SampleSource<std::complex<float>>> src) : SampleBuffer(src), frequency(0), bandwidth(1.), taps{1.0f}
+namespace {
+
+// Tap counts the crossover measurement tries (doubling), and the run each is
+// timed over. A quarter of a cache block keeps the worst case — the direct
+// form at the top of the range — to some tens of milliseconds.
+constexpr size_t kCalibrateMinTaps = 16;
+constexpr size_t kCalibrateMaxTaps = 4096;
+constexpr size_t kCalibrateSamples = 16384;
+
+struct FirfiltDeleter {
+    void operator()(firfilt_crcf f) const { firfilt_crcf_destroy(f); }
+};
+
+// Fastest of three runs, in nanoseconds, each on a fresh filter from `make`.
+// Only `run` is timed: building an OverlapSaveFir plans an FFT, and that can
+// wait out a background wisdom slice on the planner lock, which would make
+// the overlap form lose at every tap count. A block fill builds its filter
+// once per 64k outputs, so leaving it out costs little accuracy.
+template<typename Make, typename Run>
+qint64 fastestOfThree(Make make, Run run)
+{
+    qint64 best = std::numeric_limits<qint64>::max();
+    for (int i = 0; i < 3; i++) {
+        auto filter = make();
+        QElapsedTimer timer;
+        timer.start();
+        run(filter.get());
+        best = std::min(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+// Smallest tap count at which an OverlapSaveFir filters a run faster than a
+// firfilt_crcf, as TunerTransform builds one per block fill.
+size_t measureFastFirTaps()
 {
+    std::vector<std::complex<float>> input(kCalibrateSamples), output(kCalibrateSamples);
+    std::minstd_rand rng(1);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    for (auto &s : input)
+        s = { noise(rng), noise(rng) };
 
+    for (size_t n = kCalibrateMinTaps; n <= kCalibrateMaxTaps; n *= 2) {
+        std::vector<float> taps(n, 1.0f / n);
+        const qint64 direct = fastestOfThree([&]() {
+            return std::unique_ptr<std::remove_pointer<firfilt_crcf>::type, FirfiltDeleter>(
+                firfilt_crcf_create(taps.data(), static_cast<unsigned int>(n)));
+        }, [&](firfilt_crcf filter) {
+            for (size_t i = 0; i < input.size(); i++) {
+                firfilt_crcf_push(filter, input[i]);
+                firfilt_crcf_execute(filter, &output[i]);
+            }
+        });
+        const qint64 overlap = fastestOfThree([&]() {
+            return std::make_unique<OverlapSaveFir>(taps);
+        }, [&](OverlapSaveFir *filter) {
+            filter->execute(input.data(), output.data(), input.size());
+        });
+        if (overlap < direct)
+            return n;
+    }
+    return kCalibrateMaxTaps * 2;
 }
 
-void TunerTransform::work(void *input, void *output, int count, size_t sampleid)
+} // namespace
+
+TunerTransform::TunerTransform(std::shared_ptr<SampleSource<std::complex<float>>> src) : SampleBuffer(src), frequency(0), bandwidth(1.), taps{1.0f}
 {
-    auto out = static_cast<std::complex<float>*>(output);
-    auto temp = std::make_unique<std::complex<float>[]>(count);
+    budgetId_ = MemoryBudget::instance().track(MemoryBudget::TunerBlocks, [this]() {
+        QMutexLocker lk(&cacheMutex_);
+        return static_cast<qint64>(cachedBytes_);
+    });
+}
 
+TunerTransform::~TunerTransform()
+{
+    MemoryBudget::instance().untrack(budgetId_);
+}
+
+TunerTransform::Params TunerTransform::snapshot()
+{
     // Snapshot parameters under the short-hold paramMutex_ and drop it
     // before the heavy NCO+FIR loop. The base class's `mutex` is not held
-    // here (getSamples is overridden), and the GUI-thread setters use
-    // paramMutex_, so they aren't blocked by this work() running.
-    float freqLocal;
-    std::vector<float> tapsLocal;
-    {
-        QMutexLocker ml(&paramMutex_);
-        freqLocal = frequency;
-        tapsLocal = taps;
-    }
+    // (getSamples is overridden), and the GUI-thread setters use
+    // paramMutex_, so they aren't blocked by a compute running. The setters
+    // bump the epoch under the same lock, so it names exactly these params.
+    QMutexLocker ml(&paramMutex_);
+    return Params{frequency, taps, cacheEpoch_.load(std::memory_order_acquire)};
+}
 
-    // Mix down
+void TunerTransform::mixDown(float frequency, const std::complex<float> *input,
+                             std::complex<float> *output, int count, size_t sampleid)
+{
+    // The phase is seeded from the absolute index in double: in float,
+    // frequency * sampleid loses the phase entirely a few million samples
+    // in, and a continued stream has to line up with the samples already
+    // in its filter.
+    // `input` may be a borrowed view of a read-only mmap, and liquid takes
+    // a non-const input pointer, so copy first and mix in place rather than
+    // hand it the view.
+    if (output != input)
+        std::copy(input, input + count, output);
     nco_crcf mix = nco_crcf_create(LIQUID_NCO);
-    nco_crcf_set_phase(mix, fmodf(freqLocal * sampleid, Tau));
-    nco_crcf_set_frequency(mix, freqLocal);
-    nco_crcf_mix_block_down(mix,
-                            static_cast<std::complex<float>*>(input),
-                            temp.get(),
-                            count);
+    nco_crcf_set_phase(mix, static_cast<float>(fmod(static_cast<double>(frequency) * sampleid, Tau)));
+    nco_crcf_set_frequency(mix, frequency);
+    nco_crcf_mix_block_down(mix, output, output, count);
     nco_crcf_destroy(mix);
+}
+
+size_t TunerTransform::fastFirTaps()
+{
+    // Measured on first use; other workers starting a filter meanwhile wait
+    // for it.
+    static const size_t taps = measureFastFirTaps();
+    return taps;
+}
+
+void TunerTransform::startFilter(const Params &params, Stream &stream)
+{
+    if (params.taps.size() >= fastFirTaps()) {
+        stream.filter.reset();
+        stream.fastFilter.reset(new OverlapSaveFir(params.taps));
+    } else {
+        stream.fastFilter.reset();
+        stream.filter.reset(firfilt_crcf_create(const_cast<float*>(params.taps.data()), params.taps.size()));
+    }
+}
+
+void TunerTransform::mixAndFilter(const Params &params, Stream &stream,
+                                  const std::complex<float> *input, std::complex<float> *output,
+                                  int count, size_t sampleid)
+{
+    auto temp = std::make_unique<std::complex<float>[]>(count);
+    mixDown(params.frequency, input, temp.get(), count, sampleid);
 
     // Filter
-    firfilt_crcf filter = firfilt_crcf_create(tapsLocal.data(), tapsLocal.size());
+    if (stream.fastFilter) {
+        stream.fastFilter->execute(temp.get(), output, count);
+        return;
+    }
     for (int i = 0; i < count; i++)
     {
-        firfilt_crcf_push(filter, temp[i]);
-        firfilt_crcf_execute(filter, &out[i]);
+        firfilt_crcf_push(stream.filter.get(), temp[i]);
+        firfilt_crcf_execute(stream.filter.get(), &output[i]);
+    }
+}
+
+void TunerTransform::work(void *input, void *output, int count, size_t sampleid)
+{
+    const Params params = snapshot();
+    Stream stream;
+    startFilter(params, stream);
+    mixAndFilter(params, stream, static_cast<std::complex<float>*>(input),
+                 static_cast<std::complex<float>*>(output), count, sampleid);
+}
+
+bool TunerTransform::takeStream(size_t start, uint64_t epoch, Stream &stream)
+{
+    QMutexLocker lk(&streamMutex_);
+    for (auto it = streams_.begin(); it != streams_.end(); ++it) {
+        if (it->next != start || it->epoch != epoch)
+            continue;
+        stream = std::move(*it);
+        streams_.erase(it);
+        return true;
+    }
+    return false;
+}
+
+void TunerTransform::parkStream(Stream stream)
+{
+    QMutexLocker lk(&streamMutex_);
+    // Streams of an older epoch can never be continued, and neither can
+    // ours if a worker of a newer one has already parked.
+    for (const auto &s : streams_) {
+        if (s.epoch > stream.epoch)
+            return;
     }
-    firfilt_crcf_destroy(filter);
+    streams_.erase(std::remove_if(streams_.begin(), streams_.end(),
+                                  [&](const Stream &s) { return s.epoch < stream.epoch; }),
+                   streams_.end());
+    streams_.insert(streams_.begin(), std::move(stream));
+    if (streams_.size() > kStreams)
+        streams_.pop_back();
 }
 
 void TunerTransform::setFrequency(float frequency)
@@ -115,53 +262,93 @@ void TunerTransform::bumpEpoch()
 
 void TunerTransform::invalidateEvent()
 {
-    // Upstream changed (new file, etc.): drop the cached blocks. Bump the epoch
-    // BEFORE forwarding so any re-request the fan-out triggers already sees the
-    // advanced epoch and refills.
+    // Upstream changed (new file, etc.): drop the cached blocks, lead-ins
+    // included. Bump the epochs BEFORE forwarding so any re-request the
+    // fan-out triggers already sees them advanced and refills.
+    inputEpoch_.fetch_add(1, std::memory_order_release);
     bumpEpoch();
     SampleBuffer::invalidateEvent();
 }
 
-bool TunerTransform::computeInto(size_t start, size_t length, std::complex<float> *out)
+bool TunerTransform::computeInto(size_t start, size_t length, std::complex<float> *out,
+                                 RawSpan &raw, bool keepLead)
 {
-    // Mirror SampleBuffer::getSamples but lock-free: pull a FIR-history lead-in
-    // on the LEFT (clamped at the file start) so the fresh-FIR cold-start
-    // transient lives in the discarded lead-in, and pass the absolute index of
-    // the first PULLED sample as sampleid so the NCO phase is correct.
-    const size_t history = std::min(start, this->historySize());
-    auto raw = src->getSamples(start - history, length + history);
-    if (!raw)
-        return false;
-    auto temp = std::make_unique<std::complex<float>[]>(length + history);
-    work(raw.get(), temp.get(), static_cast<int>(length + history), start - history);
-    std::memcpy(out, temp.get() + history, length * sizeof(std::complex<float>));
+    const Params params = snapshot();
+    // Borrowed views so a cf32 input (or an InputBlockCache block) is mixed
+    // straight out of its store. The mix only reads its input (the NCO
+    // writes into a scratch buffer), so handing it the const span is safe.
+    if (!raw.body) {
+        raw.body = src->getSampleView(start, length);
+        if (!raw.body)
+            return false;
+    }
+
+    Stream stream;
+    const bool continued = takeStream(start, params.epoch, stream);
+    // A fresh FIR needs a lead-in on the LEFT (clamped at the file start)
+    // so its cold-start transient lives in discarded output. The taps may
+    // have grown since a held lead-in was fetched; top it up then.
+    const size_t history = std::min(start, std::max(static_cast<size_t>(256), params.taps.size()));
+    if ((!continued || keepLead) && raw.lead.length < history) {
+        auto view = src->getSampleView(start - history, history);
+        if (!view)
+            return false;
+        std::shared_ptr<std::complex<float>> copy(new std::complex<float>[history],
+                                                  std::default_delete<std::complex<float>[]>());
+        std::memcpy(copy.get(), view.data, history * sizeof(std::complex<float>));
+        raw.lead.data = copy.get();
+        raw.lead.length = history;
+        raw.lead.keepAlive = std::move(copy);
+    }
+
+    if (!continued) {
+        // Run the lead-in through a fresh filter and throw its output away.
+        // The NCO phase is seeded from each span's absolute first index, so
+        // splitting the pass in two changes nothing.
+        const size_t lead = raw.lead.length;
+        startFilter(params, stream);
+        if (lead > 0) {
+            auto discard = std::make_unique<std::complex<float>[]>(lead);
+            mixAndFilter(params, stream, raw.lead.data, discard.get(),
+                         static_cast<int>(lead), start - lead);
+        }
+    }
+    mixAndFilter(params, stream, raw.body.data, out, static_cast<int>(length), start);
+
+    stream.next = start + length;
+    stream.epoch = params.epoch;
+    parkStream(std::move(stream));
     return true;
 }
 
 std::unique_ptr<std::complex<float>[]> TunerTransform::computeRange(size_t start, size_t length)
 {
     auto out = std::make_unique<std::complex<float>[]>(length);
-    if (!computeInto(start, length, out.get()))
+    RawSpan raw;
+    if (!computeInto(start, length, out.get(), raw, false))
         return nullptr;
     return out;
 }
 
-TunerTransform::Block TunerTransform::computeBlock(size_t blockIdx)
+TunerTransform::Block TunerTransform::computeBlock(size_t blockIdx, RawSpan &raw)
 {
     const size_t total = count();
     const size_t blkStart = blockIdx * kBlock;
     if (blkStart >= total)
         return nullptr;
     const size_t blkLen = std::min(kBlock, total - blkStart);
+    // A block held from before the input grew (still inflating) is short.
+    if (raw.body && raw.body.length != blkLen)
+        raw = RawSpan();
     auto vec = std::make_shared<std::vector<std::complex<float>>>(blkLen);
-    if (!computeInto(blkStart, blkLen, vec->data()))
+    if (!computeInto(blkStart, blkLen, vec->data(), raw, true))
         return nullptr;
     return vec;
 }
 
 void TunerTransform::touchLocked(size_t blockIdx)
 {
-    lru_.remove(blockIdx);     // n <= kMaxBlocks, so O(n) is cheap
+    lru_.remove(blockIdx);     // a few hundred blocks at most, so O(n) is cheap
     lru_.push_front(blockIdx);
 }
 
@@ -176,34 +363,44 @@ std::unique_ptr<std::complex<float>[]> TunerTransform::getSamples(size_t start,
     const size_t b0 = start / kBlock;
     const size_t b1 = (start + length - 1) / kBlock;
 
-    // Large requests bypass the cache: they'd evict everyone else's blocks and
-    // thrash a bounded LRU. Compute directly in one pass, exactly like the
-    // pre-cache path (and like FrequencyDemod's own large batch pull).
-    if (b1 - b0 + 1 > kBypassBlocks)
+    // Large requests (over 3/4 of what the quota holds) bypass the cache:
+    // they'd evict everyone else's blocks and thrash a bounded LRU. Compute
+    // directly in one pass, exactly like the pre-cache path (and like
+    // FrequencyDemod's own large batch pull).
+    const size_t quota = static_cast<size_t>(MemoryBudget::instance().quota(MemoryBudget::TunerBlocks));
+    const size_t blockBytes = kBlock * sizeof(std::complex<float>);
+    if ((b1 - b0 + 1) * blockBytes > quota / 4 * 3)
         return computeRange(start, length);
 
     const uint64_t nowEpoch = cacheEpoch_.load(std::memory_order_acquire);
+    const uint64_t nowInput = inputEpoch_.load(std::memory_order_acquire);
     auto result = std::make_unique<std::complex<float>[]>(length);
 
     for (size_t b = b0; b <= b1; ++b) {
         Block blk;
+        RawSpan raw;
         bool stale = false;
         {
             QMutexLocker lk(&cacheMutex_);
             // Only an OLDER map gets dropped. mapEpoch_ never exceeds the live
-            // cacheEpoch_, so mapEpoch_ > nowEpoch means a newer generation
+            // inputEpoch_, so mapEpoch_ > nowInput means a newer generation
             // already owns the map and *we* are a stale worker draining an old
             // frame — don't clear it (that would ping-pong against the live
             // workers and zero the hit rate); just compute directly.
-            if (mapEpoch_ < nowEpoch) {
+            if (mapEpoch_ < nowInput) {
                 blocks_.clear();
                 lru_.clear();
-                mapEpoch_ = nowEpoch;
+                cachedBytes_ = 0;
+                mapEpoch_ = nowInput;
             }
-            if (mapEpoch_ == nowEpoch) {
+            if (mapEpoch_ == nowInput) {
                 auto it = blocks_.find(b);
                 if (it != blocks_.end()) {
-                    blk = it->second;
+                    // Current: serve it. Stale tuning: re-mix its raw input.
+                    if (it->second.epoch == nowEpoch)
+                        blk = it->second.tuned;
+                    else
+                        raw.lead = it->second.lead;
                     touchLocked(b);
                 }
             } else {
@@ -212,7 +409,7 @@ std::unique_ptr<std::complex<float>[]> TunerTransform::getSamples(size_t start,
         }
         if (!blk) {
             // Miss (or stale): compute OUTSIDE the lock (work() is reentrant).
-            blk = computeBlock(b);
+            blk = computeBlock(b, raw);
             if (!blk)
                 return nullptr;
             if (!stale) {
@@ -221,18 +418,30 @@ std::unique_ptr<std::complex<float>[]> TunerTransform::getSamples(size_t start,
                 // since entry AND the map is still our generation. Otherwise a
                 // repaint under the new generation will supersede this frame.
                 if (cacheEpoch_.load(std::memory_order_acquire) == nowEpoch &&
-                    mapEpoch_ == nowEpoch) {
+                    mapEpoch_ == nowInput) {
                     auto it = blocks_.find(b);
-                    if (it == blocks_.end()) {
-                        blocks_.emplace(b, blk);
+                    if (it != blocks_.end() && it->second.epoch == nowEpoch) {
+                        blk = it->second.tuned; // someone else computed it first; share theirs
+                        touchLocked(b);
+                    } else {
+                        if (it != blocks_.end()) {
+                            cachedBytes_ -= it->second.bytes();
+                            blocks_.erase(it);
+                            lru_.remove(b);
+                        }
+                        Entry entry;
+                        entry.tuned = blk;
+                        entry.lead = std::move(raw.lead);
+                        entry.epoch = nowEpoch;
+                        cachedBytes_ += entry.bytes();
+                        blocks_.emplace(b, std::move(entry));
                         lru_.push_front(b);
-                        while (lru_.size() > kMaxBlocks) {
-                            blocks_.erase(lru_.back());
+                        while (cachedBytes_ > quota && lru_.size() > 1) {
+                            auto victim = blocks_.find(lru_.back());
+                            cachedBytes_ -= victim->second.bytes();
+                            blocks_.erase(victim);
                             lru_.pop_back();
                         }
-                    } else {
-                        blk = it->second; // someone else computed it first; share theirs
-                        touchLocked(b);
                     }
                 }
             }
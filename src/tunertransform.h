@@ -19,12 +19,15 @@
 
 #pragma once
 
+#include "overlapsavefir.h"
 #include "samplebuffer.h"
+#include <liquid/liquid.h>
 #include <QMutex>
 #include <atomic>
 #include <cstdint>
 #include <list>
 #include <memory>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -46,13 +49,17 @@ private:
 
 public:
     TunerTransform(std::shared_ptr<SampleSource<std::complex<float>>> src);
+    ~TunerTransform();
     void work(void *input, void *output, int count, size_t sampleid) override;
     // work() uses only local NCO/FIR objects + a paramMutex_ snapshot, so it's
     // reentrant. getSamples() below is overridden (block cache), so the base
-    // SampleBuffer path is never taken — but the block fills call work() lock-free
-    // and in parallel, so this reentrancy is load-bearing. Safety relies on
+    // SampleBuffer path is never taken — but the block fills run the same mix and
+    // filter lock-free and in parallel (each on a filter it owns, fresh or a
+    // claimed stream), so this reentrancy is load-bearing. Safety relies on
     // liquid-dsp keeping all nco/firfilt/dotprod state per-object (true through
     // >= v1.3.2); revisit if a liquid upgrade adds a shared design cache.
+    // The overlap-save backend owns its FFT buffers and FFTW plans are only
+    // created / destroyed under fftplan's lock, so it keeps the contract.
     bool workIsReentrant() override { return true; }
     void setFrequency(float frequency);
     void setTaps(std::vector<float> taps);
@@ -64,9 +71,10 @@ public:
     // cache is self-invalidating — see the setters — so this is purely the
     // downstream fan-out now.)
     void notifyChanged() { invalidate(); }
-    // The FIR is rebuilt from zero state each call, so the lead-in must cover
-    // at least the tap count or the first output samples will be attenuated
-    // filter transient — visible as noise in downstream demods.
+    // A read that can't continue a parked stream (see below) starts the FIR
+    // from zero state, so its lead-in must cover at least the tap count or
+    // the first output samples will be attenuated filter transient —
+    // visible as noise in downstream demods.
     size_t historySize() override;
 
     // Shared block cache of tuned IQ. Every derived plot pulls the tuned output
@@ -75,29 +83,126 @@ public:
     // BLK-aligned absolute blocks: a hit is a memcpy under a short lock; a miss
     // computes the block lock-free (work() is reentrant) and inserts it. So
     // disjoint consumers fill different blocks in parallel and overlapping ones
-    // (and pans) share warm blocks. Invalidated by bumping cacheEpoch_ (atomic,
-    // non-blocking); the map is lazily dropped when its epoch goes stale.
+    // (and pans) share warm blocks. Capped in bytes by the MemoryBudget
+    // TunerBlocks quota.
+    //
+    // The cache is two stages. Each entry keeps the FIR lead-in it was
+    // tuned from next to the tuned result; the input block itself stays in
+    // the upstream InputBlockCache, which accounts for it. A parameter
+    // change (setters bump cacheEpoch_, atomic and non-blocking) only marks
+    // the tuned data stale: the next read re-mixes and re-filters the held
+    // lead-in and the block borrowed again from that cache, so a tuner drag
+    // costs the NCO + FIR over the visible blocks and doesn't touch the
+    // file while they're resident. On a network mount the reads used to
+    // dominate the drag latency. Only an upstream change (invalidateEvent
+    // bumps inputEpoch_ as well) drops the map.
+    //
+    // Sequential reads stream: every computed range parks its FIR state,
+    // and a compute starting exactly where a parked one stopped (the next
+    // block of an export, a plugin extraction or any other forward pass)
+    // picks it up instead of re-warming the filter on a lead-in. With
+    // narrow pass-bands the FIR runs to thousands of taps, so the lead-in
+    // was a large share of each 64k block. Random access just finds no
+    // stream to continue and takes the stateless lead-in path.
     std::unique_ptr<std::complex<float>[]> getSamples(size_t start, size_t length) override;
     void invalidateEvent() override;
 
+    // Mix frequency and taps as of one epoch, snapshotted together. Also
+    // read by TunerDecimator, which runs the same mix and FIR as a
+    // polyphase decimator.
+    struct Params {
+        float frequency;
+        std::vector<float> taps;
+        uint64_t epoch;
+    };
+    Params snapshot();
+    // NCO-mix `count` samples starting at absolute index `sampleid` down by
+    // `frequency` (radians/sample). Output may alias input.
+    static void mixDown(float frequency, const std::complex<float> *input,
+                        std::complex<float> *output, int count, size_t sampleid);
+
 private:
     using Block = std::shared_ptr<const std::vector<std::complex<float>>>;
     static constexpr size_t kBlock = 65536;       // samples per cache block
-    static constexpr size_t kMaxBlocks = 128;     // ~8.4M samples / ~64 MB cap
-    static constexpr size_t kBypassBlocks = 96;   // larger requests skip the cache
 
-    QMutex                cacheMutex_;             // guards blocks_/lru_/mapEpoch_ only
-    std::atomic<uint64_t> cacheEpoch_{1};
-    uint64_t              mapEpoch_ = 0;           // epoch the current map belongs to
-    std::unordered_map<size_t, Block> blocks_;     // blockIndex -> data
+    // Upstream input for one computed range: `body` is [start, start +
+    // length), `lead` the samples just before it that warm a fresh FIR
+    // (empty until a compute needed them, and at the file start). The
+    // body is usually a view of an InputBlockCache block; the lead is a
+    // small copy so it doesn't pin the whole previous block.
+    struct RawSpan {
+        SampleView<std::complex<float>> lead;
+        SampleView<std::complex<float>> body;
+    };
+    struct Entry {
+        Block tuned;
+        SampleView<std::complex<float>> lead;
+        uint64_t epoch = 0;    // cacheEpoch_ `tuned` was computed under
+        size_t bytes() const { return (tuned->size() + lead.length) * sizeof(std::complex<float>); }
+    };
+    // Parked streams kept; a few forward readers at once (export running
+    // while plots pan) each keep theirs.
+    static constexpr size_t kStreams = 4;
+    // Tap count from which the FIR runs as overlap-save fast convolution
+    // instead of liquid's direct-form dot product. Narrow tuner widths give
+    // Kaiser filters of thousands of taps, where the direct form dominates
+    // every block fill. Where the two cross depends on the CPU and on how
+    // liquid and FFTW were built, so it isn't a constant: the first filter
+    // started in the process times both (see measureFastFirTaps in the .cpp).
+    // tools/tuner_fir_bench prints the whole curve.
+    static size_t fastFirTaps();
+
+    struct FilterDeleter {
+        void operator()(firfilt_crcf f) const { firfilt_crcf_destroy(f); }
+    };
+    using Filter = std::unique_ptr<std::remove_pointer<firfilt_crcf>::type, FilterDeleter>;
+
+    // FIR state left by a finished compute. The mix needs no state: each
+    // compute seeds the NCO phase from its first absolute sample index.
+    // Exactly one of the two filters is set, by startFilter().
+    struct Stream {
+        Filter filter;                              // direct form
+        std::unique_ptr<OverlapSaveFir> fastFilter; // >= fastFirTaps() taps
+        size_t next = 0;      // absolute index of the next input sample
+        uint64_t epoch = 0;   // cacheEpoch_ the taps / mix belong to
+    };
+
+    mutable QMutex        cacheMutex_;             // guards blocks_/lru_/mapEpoch_/cachedBytes_ only
+    std::atomic<uint64_t> cacheEpoch_{1};          // tuner parameters or input changed
+    std::atomic<uint64_t> inputEpoch_{1};          // input changed
+    uint64_t              mapEpoch_ = 0;           // inputEpoch_ the current map belongs to
+    std::unordered_map<size_t, Entry> blocks_;     // blockIndex -> entry
     std::list<size_t>     lru_;                     // front = most-recently-used
+    size_t                cachedBytes_ = 0;        // sum of the blocks_ payloads
+    int                   budgetId_ = 0;
+
+    QMutex                streamMutex_;            // guards streams_ only
+    std::vector<Stream>   streams_;                // parked, most recent first
 
     void bumpEpoch();
-    // Pull upstream IQ with a FIR-history lead-in and run work() into `out`;
-    // [start, start+length). Lock-free (work() reentrant). Returns false on a
+    // Give `stream` a zero-state FIR for `params.taps`, direct form or
+    // overlap-save by tap count.
+    static void startFilter(const Params &params, Stream &stream);
+    // NCO-mix `count` samples starting at absolute index `sampleid` down
+    // and push them through the stream's filter, continuing from its
+    // current state.
+    static void mixAndFilter(const Params &params, Stream &stream,
+                             const std::complex<float> *input, std::complex<float> *output,
+                             int count, size_t sampleid);
+    // Claim the parked stream that stopped at `start` for this epoch, if any.
+    bool takeStream(size_t start, uint64_t epoch, Stream &stream);
+    void parkStream(Stream stream);
+    // Tuned IQ for [start, start+length) into `out`, from `raw` where it
+    // holds the input already (a re-mix) and pulled from upstream into it
+    // otherwise. Continues a parked stream when one stopped at `start`,
+    // otherwise starts a fresh filter on the FIR-history lead-in; with
+    // `keepLead` the lead-in is fetched either way so `raw` can be re-mixed
+    // on its own later. The filter is parked afterwards. Lock-free apart
+    // from the short stream claim (work() reentrant). Returns false on a
     // null upstream read (out-of-range).
-    bool computeInto(size_t start, size_t length, std::complex<float> *out);
+    bool computeInto(size_t start, size_t length, std::complex<float> *out,
+                     RawSpan &raw, bool keepLead);
     std::unique_ptr<std::complex<float>[]> computeRange(size_t start, size_t length);
-    Block computeBlock(size_t blockIdx);
+    Block computeBlock(size_t blockIdx, RawSpan &raw);
     void touchLocked(size_t blockIdx);             // assumes cacheMutex_ held
 };
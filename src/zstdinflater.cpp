@@ -0,0 +1,367 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "zstdinflater.h"
+
+#include <QDebug>
+#include <QFuture>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Frames whose compressed size fits in this window are batch-decoded in
+// parallel (each is buffered whole in memory before being written). Anything
+// larger — typically the single frame of a plain `zstd file` — is streamed.
+constexpr size_t kParallelFrameBytes = 32u << 20;
+// Decoded-size limits for the parallel path, since a batch holds every one of
+// its frames in memory until it's written. A frame that decodes to more than
+// kParallelDecodedBytes is streamed instead; a frame without a recorded
+// content size is charged that much and falls back to streaming if it turns
+// out larger. A batch stops once its frames add up to kBatchDecodedBytes.
+constexpr uint64_t kParallelDecodedBytes = 64u << 20;
+constexpr uint64_t kBatchDecodedBytes = 256u << 20;
+// How much streamed output to accumulate between available() updates. Small
+// enough that the visible prefix grows smoothly, large enough that the
+// atomics and condvar wakeups stay off the profile.
+constexpr uint64_t kPublishBytes = 8u << 20;
+
+constexpr uint32_t kSkippableMagicMask  = 0xFFFFFFF0u;
+constexpr uint32_t kSkippableMagicStart = 0x184D2A50u;
+
+uint32_t readLE32(const uchar *p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+#ifdef HAVE_ZSTD
+struct DecodedFrame {
+    std::vector<char> bytes;
+    QString error;       // empty on success
+    bool tooBig = false; // decoded past kParallelDecodedBytes; stream it instead
+};
+
+// Decoded bytes a frame is charged against the batch: its recorded content
+// size, or the per-frame limit when it has none.
+uint64_t decodedCharge(const uchar *src, size_t cSize)
+{
+    const unsigned long long known = ZSTD_getFrameContentSize(src, cSize);
+    if (known == ZSTD_CONTENTSIZE_UNKNOWN || known == ZSTD_CONTENTSIZE_ERROR)
+        return kParallelDecodedBytes;
+    return known;
+}
+
+// Decode one complete frame. Runs on a pool thread, so everything is local.
+DecodedFrame decodeFrame(const uchar *src, size_t cSize)
+{
+    DecodedFrame out;
+    const unsigned long long known = ZSTD_getFrameContentSize(src, cSize);
+    if (known != ZSTD_CONTENTSIZE_UNKNOWN && known != ZSTD_CONTENTSIZE_ERROR) {
+        out.bytes.resize(known);
+        const size_t got = ZSTD_decompress(out.bytes.data(), out.bytes.size(), src, cSize);
+        if (ZSTD_isError(got))
+            out.error = QString::fromLatin1(ZSTD_getErrorName(got));
+        else if (got != known)
+            out.error = QStringLiteral("frame decoded to an unexpected size");
+        return out;
+    }
+
+    // No recorded size: stream-decode into a growing buffer, giving up once
+    // it passes the limit the batch charged for it.
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (dctx == nullptr) {
+        out.error = QStringLiteral("failed to create decompression context");
+        return out;
+    }
+    const size_t chunk = ZSTD_DStreamOutSize();
+    ZSTD_inBuffer input = { src, cSize, 0 };
+    size_t ret = 1;
+    while (ret != 0) {
+        const size_t have = out.bytes.size();
+        out.bytes.resize(have + chunk);
+        ZSTD_outBuffer output = { out.bytes.data() + have, chunk, 0 };
+        ret = ZSTD_decompressStream(dctx, &output, &input);
+        out.bytes.resize(have + output.pos);
+        if (ZSTD_isError(ret)) {
+            out.error = QString::fromLatin1(ZSTD_getErrorName(ret));
+            break;
+        }
+        if (out.bytes.size() > kParallelDecodedBytes) {
+            out.bytes = std::vector<char>();
+            out.tooBig = true;
+            ZSTD_freeDCtx(dctx);
+            return out;
+        }
+        // Input used up and nothing left to flush: the frame is cut short.
+        if (input.pos == input.size && output.pos == 0)
+            break;
+    }
+    if (out.error.isEmpty() && ret != 0)
+        out.error = QStringLiteral("truncated frame");
+    ZSTD_freeDCtx(dctx);
+    return out;
+}
+#endif
+
+} // namespace
+
+ZstdInflater::ZstdInflater(const QString &src, const QString &dst) : src_(src), dst_(dst)
+{
+    thread_ = std::thread([this]() { run(); });
+}
+
+ZstdInflater::~ZstdInflater()
+{
+    cancel_.store(true, std::memory_order_release);
+    if (thread_.joinable())
+        thread_.join();
+}
+
+QString ZstdInflater::errorString() const
+{
+    std::lock_guard<std::mutex> lk(waitMutex_);
+    return error_;
+}
+
+void ZstdInflater::publish(uint64_t bytes)
+{
+    {
+        std::lock_guard<std::mutex> lk(waitMutex_);
+        available_.store(bytes, std::memory_order_release);
+    }
+    waitCv_.notify_all();
+}
+
+void ZstdInflater::fail(const QString &why)
+{
+    {
+        std::lock_guard<std::mutex> lk(waitMutex_);
+        error_ = why;
+        state_.store(Failed, std::memory_order_release);
+    }
+    waitCv_.notify_all();
+    qWarning() << "zstd: inflating" << src_ << "failed:" << why;
+}
+
+bool ZstdInflater::waitFor(uint64_t bytes)
+{
+    std::unique_lock<std::mutex> lk(waitMutex_);
+    waitCv_.wait(lk, [&]() {
+        return available_.load(std::memory_order_acquire) >= bytes ||
+               state_.load(std::memory_order_acquire) != Running;
+    });
+    return available_.load(std::memory_order_acquire) >= bytes;
+}
+
+bool ZstdInflater::read(uint64_t offset, size_t length, void *dst)
+{
+    const uint64_t avail = available();
+    if (offset > avail || length > avail - offset)
+        return false;
+
+    QMutexLocker lk(&readMutex_);
+    if (!reader_.isOpen()) {
+        reader_.setFileName(dst_);
+        if (!reader_.open(QIODevice::ReadOnly))
+            return false;
+    }
+    if (!reader_.seek(static_cast<qint64>(offset)))
+        return false;
+    return reader_.read(static_cast<char*>(dst), static_cast<qint64>(length)) ==
+           static_cast<qint64>(length);
+}
+
+void ZstdInflater::run()
+{
+#ifndef HAVE_ZSTD
+    fail(QStringLiteral("built without zstd support"));
+#else
+    QFile in(src_);
+    if (!in.open(QIODevice::ReadOnly)) {
+        fail("cannot open " + src_ + ": " + in.errorString());
+        return;
+    }
+    const uint64_t size = static_cast<uint64_t>(in.size());
+    const uchar *data = size ? in.map(0, in.size()) : nullptr;
+    if (data == nullptr) {
+        fail("cannot mmap " + src_);
+        return;
+    }
+    // Unbuffered so every write() lands in the page cache before we publish
+    // it — read() goes through a separate handle.
+    QFile out(dst_);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        fail("cannot write " + dst_ + ": " + out.errorString());
+        return;
+    }
+
+    auto writeAll = [&](const char *p, size_t n) {
+        return out.write(p, static_cast<qint64>(n)) == static_cast<qint64>(n);
+    };
+
+    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    if (dctx == nullptr) {
+        fail(QStringLiteral("failed to create decompression context"));
+        return;
+    }
+    std::vector<char> outBuf(ZSTD_DStreamOutSize());
+    const int batchMax = std::max(1, QThreadPool::globalInstance()->maxThreadCount());
+
+    uint64_t pos = 0, written = 0;
+    QString error;
+    // Set when the frame at pos has to be streamed even though it fit the
+    // compressed window (it decoded past kParallelDecodedBytes).
+    bool streamNext = false;
+    while (pos < size && !cancel_.load(std::memory_order_acquire)) {
+        // Gather a batch of consecutive frames that each fit the parallel
+        // window. findFrameCompressedSize over a bounded window fails fast on
+        // a frame that doesn't, rather than walking a 100 GB frame's blocks.
+        std::vector<std::pair<uint64_t, size_t>> batch;
+        uint64_t scan = pos;
+        uint64_t batchBytes = 0;
+        while (!streamNext && (int)batch.size() < batchMax && scan < size) {
+            const uint64_t remaining = size - scan;
+            if (remaining >= 8 && (readLE32(data + scan) & kSkippableMagicMask) == kSkippableMagicStart) {
+                const uint64_t skip = 8 + static_cast<uint64_t>(readLE32(data + scan + 4));
+                if (skip > remaining)
+                    break;
+                scan += skip;
+                continue;
+            }
+            const size_t window = static_cast<size_t>(std::min<uint64_t>(remaining, kParallelFrameBytes));
+            const size_t cSize = ZSTD_findFrameCompressedSize(data + scan, window);
+            if (ZSTD_isError(cSize))
+                break;
+            const uint64_t charge = decodedCharge(data + scan, cSize);
+            if (charge > kParallelDecodedBytes)
+                break;
+            if (!batch.empty() && batchBytes + charge > kBatchDecodedBytes)
+                break;
+            batch.emplace_back(scan, cSize);
+            batchBytes += charge;
+            scan += cSize;
+        }
+
+        if (!batch.empty()) {
+            std::vector<QFuture<DecodedFrame>> futures;
+            futures.reserve(batch.size());
+            for (const auto &f : batch) {
+                const uchar *p = data + f.first;
+                const size_t n = f.second;
+                futures.push_back(QtConcurrent::run([p, n]() { return decodeFrame(p, n); }));
+            }
+            // Write strictly in order; later frames keep decoding meanwhile.
+            uint64_t next = scan;
+            for (size_t i = 0; i < futures.size(); i++) {
+                DecodedFrame frame = futures[i].result();
+                if (!error.isEmpty() || streamNext)
+                    continue;   // drain the rest before bailing out
+                if (frame.tooBig) {
+                    // Stream it, and redo whatever followed it in the batch.
+                    streamNext = true;
+                    next = batch[i].first;
+                    continue;
+                }
+                if (!frame.error.isEmpty()) {
+                    error = frame.error;
+                    continue;
+                }
+                if (!writeAll(frame.bytes.data(), frame.bytes.size())) {
+                    error = "write failed: " + out.errorString();
+                    continue;
+                }
+                written += frame.bytes.size();
+                publish(written);
+            }
+            if (!error.isEmpty())
+                break;
+            pos = next;
+            continue;
+        }
+
+        if (pos != scan) {
+            // Only skippable frames were consumed (e.g. trailing metadata).
+            pos = scan;
+            continue;
+        }
+
+        // One big frame: stream it, publishing as the output grows.
+        streamNext = false;
+        ZSTD_DCtx_reset(dctx, ZSTD_reset_session_only);
+        ZSTD_inBuffer input = { data + pos, static_cast<size_t>(size - pos), 0 };
+        uint64_t sincePublish = 0;
+        size_t ret = 1;
+        while (ret != 0 && !cancel_.load(std::memory_order_acquire)) {
+            ZSTD_outBuffer output = { outBuf.data(), outBuf.size(), 0 };
+            ret = ZSTD_decompressStream(dctx, &output, &input);
+            if (ZSTD_isError(ret)) {
+                error = QString::fromLatin1(ZSTD_getErrorName(ret));
+                break;
+            }
+            if (input.pos == input.size && output.pos == 0)
+                break;
+            if (!writeAll(outBuf.data(), output.pos)) {
+                error = "write failed: " + out.errorString();
+                break;
+            }
+            written += output.pos;
+            sincePublish += output.pos;
+            if (sincePublish >= kPublishBytes) {
+                publish(written);
+                sincePublish = 0;
+            }
+        }
+        if (error.isEmpty() && ret != 0 && !cancel_.load(std::memory_order_acquire))
+            error = QStringLiteral("truncated or incomplete input stream");
+        if (!error.isEmpty())
+            break;
+        publish(written);
+        pos += input.pos;
+    }
+    ZSTD_freeDCtx(dctx);
+    in.unmap(const_cast<uchar*>(data));
+
+    if (cancel_.load(std::memory_order_acquire))
+        return;   // partial output, no marker: the next open restarts
+    if (!error.isEmpty()) {
+        fail(error);
+        return;
+    }
+    out.close();
+
+    QFile marker(dst_ + ".done");
+    if (marker.open(QIODevice::WriteOnly))
+        marker.close();
+
+    {
+        std::lock_guard<std::mutex> lk(waitMutex_);
+        state_.store(Done, std::memory_order_release);
+    }
+    waitCv_.notify_all();
+#endif
+}
@@ -0,0 +1,87 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+// Background inflate of a .zst that ZstdSeekable can't serve (single huge
+// frame, frames without a recorded content size) into the zst-cache file.
+//
+// The old path ran the whole decompression synchronously inside openFile, so
+// the window froze until the last byte was written. This runs it on its own
+// thread and publishes a monotonically growing available() byte count; the
+// prefix below it is already on disk and can be read while the rest streams
+// in, so InputSource can open — and the spectrogram can draw — immediately.
+//
+// Runs of independent, modestly-sized frames (pzstd output, concatenated
+// streams, …) are decoded in parallel batches on the global thread pool and
+// written in order, each batch capped by its total decoded size; a frame too
+// big to buffer is streamed sequentially with progressive publishing. On
+// success a "<dst>.done" marker is written so the next open reuses the file.
+class ZstdInflater
+{
+public:
+    ZstdInflater(const QString &src, const QString &dst);
+    // Cancels an unfinished inflate and joins the worker. The partial output
+    // stays without a .done marker, so the next open starts over.
+    ~ZstdInflater();
+
+    // Decompressed bytes already written to dst (and readable via read()).
+    uint64_t available() const { return available_.load(std::memory_order_acquire); }
+    bool finished() const { return state_.load(std::memory_order_acquire) == Done; }
+    bool failed() const { return state_.load(std::memory_order_acquire) == Failed; }
+    QString errorString() const;
+    QString outputPath() const { return dst_; }
+
+    // Block until `bytes` are available or the inflate ends. True if they are.
+    bool waitFor(uint64_t bytes);
+    // Copy [offset, offset+length) of the output into dst. Only succeeds for
+    // ranges already below available(). Thread-safe.
+    bool read(uint64_t offset, size_t length, void *dst);
+
+private:
+    enum State { Running, Done, Failed };
+
+    void run();
+    void publish(uint64_t bytes);
+    void fail(const QString &why);
+
+    const QString src_;
+    const QString dst_;
+    std::atomic<uint64_t> available_{0};
+    std::atomic<int> state_{Running};
+    std::atomic<bool> cancel_{false};
+
+    mutable std::mutex waitMutex_;   // guards error_; pairs with waitCv_
+    std::condition_variable waitCv_;
+    QString error_;
+
+    QMutex readMutex_;               // guards reader_ (seek + read)
+    QFile reader_;
+
+    std::thread thread_;
+};
@@ -0,0 +1,356 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "zstdseekable.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+// Values from the zstd frame format / contrib/seekable_format spec. Spelled
+// out rather than taken from zstd.h so the seek-table reader has no
+// dependency on the experimental API.
+constexpr uint32_t kSkippableMagicMask  = 0xFFFFFFF0u;
+constexpr uint32_t kSkippableMagicStart = 0x184D2A50u;
+constexpr uint32_t kSeekTableMagic      = 0x184D2A5Eu;
+constexpr uint32_t kSeekableFooterMagic = 0x8F92EAB1u;
+constexpr size_t   kSeekFooterSize      = 9;
+
+// On-disk index cache header. Bump kIndexVersion if Frame's layout changes.
+constexpr char     kIndexMagic[4] = { 'I', 'Z', 'I', 'X' };
+constexpr uint32_t kIndexVersion  = 1;
+
+uint32_t readLE32(const uchar *p)
+{
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+} // namespace
+
+std::shared_ptr<ZstdSeekable> ZstdSeekable::open(const QString &path,
+                                                 const QString &indexCachePath,
+                                                 QString *whyNot)
+{
+#ifndef HAVE_ZSTD
+    (void)path;
+    (void)indexCachePath;
+    if (whyNot) *whyNot = QStringLiteral("built without zstd support");
+    return nullptr;
+#else
+    std::shared_ptr<ZstdSeekable> z(new ZstdSeekable());
+    z->file_.setFileName(path);
+    if (!z->file_.open(QIODevice::ReadOnly)) {
+        if (whyNot) *whyNot = z->file_.errorString();
+        return nullptr;
+    }
+    z->fileSize_ = static_cast<uint64_t>(z->file_.size());
+    if (z->fileSize_ == 0) {
+        if (whyNot) *whyNot = QStringLiteral("empty file");
+        return nullptr;
+    }
+    z->data_ = z->file_.map(0, z->file_.size());
+    if (z->data_ == nullptr) {
+        if (whyNot) *whyNot = QStringLiteral("cannot mmap compressed file");
+        return nullptr;
+    }
+
+    bool indexed = z->readSeekTable();
+    if (!indexed && !indexCachePath.isEmpty())
+        indexed = z->loadIndex(indexCachePath);
+    if (!indexed) {
+        if (!z->scanFrames(whyNot))
+            return nullptr;
+        if (!indexCachePath.isEmpty())
+            z->saveIndex(indexCachePath);
+    }
+
+    if (z->frames_.empty()) {
+        if (whyNot) *whyNot = QStringLiteral("no data frames");
+        return nullptr;
+    }
+    for (const Frame &f : z->frames_) {
+        if (f.dSize > kMaxFrameBytes) {
+            if (whyNot) *whyNot = QStringLiteral("frame too large for random access");
+            return nullptr;
+        }
+    }
+    const Frame &last = z->frames_.back();
+    z->totalSize_ = last.dOffset + last.dSize;
+    return z;
+#endif
+}
+
+ZstdSeekable::~ZstdSeekable()
+{
+    if (data_ != nullptr)
+        file_.unmap(const_cast<uchar*>(data_));
+}
+
+bool ZstdSeekable::readSeekTable()
+{
+    if (fileSize_ < kSeekFooterSize + 8)
+        return false;
+    const uchar *footer = data_ + fileSize_ - kSeekFooterSize;
+    if (readLE32(footer + 5) != kSeekableFooterMagic)
+        return false;
+
+    const uint64_t numFrames = readLE32(footer);
+    const uint8_t descriptor = footer[4];
+    const uint64_t entrySize = (descriptor & 0x80) ? 12 : 8;
+    const uint64_t tableSize = 8 + numFrames * entrySize + kSeekFooterSize;
+    if (tableSize > fileSize_)
+        return false;
+
+    const uchar *table = data_ + fileSize_ - tableSize;
+    if (readLE32(table) != kSeekTableMagic || readLE32(table + 4) != tableSize - 8)
+        return false;
+
+    std::vector<Frame> frames;
+    frames.reserve(numFrames);
+    uint64_t cpos = 0, dpos = 0;
+    const uchar *entry = table + 8;
+    for (uint64_t i = 0; i < numFrames; i++, entry += entrySize) {
+        const uint64_t cSize = readLE32(entry);
+        const uint64_t dSize = readLE32(entry + 4);
+        if (dSize > 0)
+            frames.push_back({ cpos, cSize, dpos, dSize });
+        cpos += cSize;
+        dpos += dSize;
+    }
+    // The table must account for every byte before it. Anything else (e.g.
+    // frames appended after the table by a later metadata save) means the
+    // table no longer describes the file; fall back to a scan.
+    if (cpos != fileSize_ - tableSize)
+        return false;
+
+    frames_ = std::move(frames);
+    return true;
+}
+
+bool ZstdSeekable::scanFrames(QString *whyNot)
+{
+#ifdef HAVE_ZSTD
+    // Walk frame by frame. The content-size check runs first because it only
+    // reads the frame header: a single-frame stream (plain `zstd file`) is
+    // rejected immediately instead of after walking every block of a huge
+    // frame.
+    std::vector<Frame> frames;
+    uint64_t pos = 0, dpos = 0;
+    while (pos < fileSize_) {
+        const uint64_t remaining = fileSize_ - pos;
+        const uchar *p = data_ + pos;
+        if (remaining >= 8 && (readLE32(p) & kSkippableMagicMask) == kSkippableMagicStart) {
+            const uint64_t skip = 8 + static_cast<uint64_t>(readLE32(p + 4));
+            if (skip > remaining) {
+                if (whyNot) *whyNot = QStringLiteral("truncated skippable frame");
+                return false;
+            }
+            pos += skip;
+            continue;
+        }
+
+        const unsigned long long dSize = ZSTD_getFrameContentSize(p, remaining);
+        if (dSize == ZSTD_CONTENTSIZE_ERROR) {
+            if (whyNot) *whyNot = QStringLiteral("invalid zstd frame header");
+            return false;
+        }
+        if (dSize == ZSTD_CONTENTSIZE_UNKNOWN) {
+            if (whyNot) *whyNot = QStringLiteral("frame has no recorded content size");
+            return false;
+        }
+        if (dSize > kMaxFrameBytes) {
+            if (whyNot) *whyNot = QStringLiteral("frame too large for random access");
+            return false;
+        }
+        const size_t cSize = ZSTD_findFrameCompressedSize(p, remaining);
+        if (ZSTD_isError(cSize)) {
+            if (whyNot) *whyNot = QString::fromLatin1(ZSTD_getErrorName(cSize));
+            return false;
+        }
+        if (dSize > 0)
+            frames.push_back({ pos, cSize, dpos, dSize });
+        pos += cSize;
+        dpos += dSize;
+    }
+    frames_ = std::move(frames);
+    return true;
+#else
+    if (whyNot) *whyNot = QStringLiteral("built without zstd support");
+    return false;
+#endif
+}
+
+bool ZstdSeekable::loadIndex(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t fileSize = 0, count = 0;
+    if (f.read(magic, 4) != 4 || memcmp(magic, kIndexMagic, 4) != 0)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&version), sizeof(version)) != sizeof(version) ||
+        version != kIndexVersion)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&fileSize), sizeof(fileSize)) != sizeof(fileSize) ||
+        fileSize != fileSize_)
+        return false;
+    if (f.read(reinterpret_cast<char*>(&count), sizeof(count)) != sizeof(count))
+        return false;
+    // The cache key already folds in size + mtime; this just guards against a
+    // truncated or corrupt index file.
+    if (count == 0 || count > fileSize_ ||
+        static_cast<uint64_t>(f.size() - f.pos()) != count * sizeof(Frame))
+        return false;
+
+    std::vector<Frame> frames(count);
+    const qint64 bytes = static_cast<qint64>(count * sizeof(Frame));
+    if (f.read(reinterpret_cast<char*>(frames.data()), bytes) != bytes)
+        return false;
+    uint64_t dpos = 0;
+    for (const Frame &fr : frames) {
+        if (fr.cOffset + fr.cSize > fileSize_ || fr.dOffset != dpos)
+            return false;
+        dpos += fr.dSize;
+    }
+    frames_ = std::move(frames);
+    return true;
+}
+
+void ZstdSeekable::saveIndex(const QString &path) const
+{
+    // Best effort: a failed write only costs a rescan on the next open.
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly))
+        return;
+    const uint64_t count = frames_.size();
+    f.write(kIndexMagic, 4);
+    f.write(reinterpret_cast<const char*>(&kIndexVersion), sizeof(kIndexVersion));
+    f.write(reinterpret_cast<const char*>(&fileSize_), sizeof(fileSize_));
+    f.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    f.write(reinterpret_cast<const char*>(frames_.data()),
+            static_cast<qint64>(count * sizeof(Frame)));
+    if (!f.commit())
+        qDebug() << "zstd: could not write frame index" << path << f.errorString();
+}
+
+size_t ZstdSeekable::frameFor(uint64_t offset) const
+{
+    auto it = std::upper_bound(frames_.begin(), frames_.end(), offset,
+                               [](uint64_t off, const Frame &f) { return off < f.dOffset; });
+    return static_cast<size_t>(it - frames_.begin()) - 1;
+}
+
+ZstdSeekable::Decoded ZstdSeekable::frame(size_t idx)
+{
+    {
+        QMutexLocker lk(&cacheMutex_);
+        auto it = cache_.find(idx);
+        if (it != cache_.end()) {
+            lru_.remove(idx);
+            lru_.push_front(idx);
+            return it->second;
+        }
+    }
+
+#ifdef HAVE_ZSTD
+    // Miss: decode outside the lock so other readers (and other frames) aren't
+    // serialised behind it. Two readers racing on the same frame both decode;
+    // the loser adopts the winner's copy below.
+    const Frame &f = frames_[idx];
+    auto buf = std::make_shared<std::vector<char>>(f.dSize);
+    const size_t got = ZSTD_decompress(buf->data(), buf->size(), data_ + f.cOffset, f.cSize);
+    if (ZSTD_isError(got) || got != f.dSize) {
+        qDebug() << "zstd: frame" << idx << "failed to decode:"
+                 << (ZSTD_isError(got) ? ZSTD_getErrorName(got) : "short output");
+        return nullptr;
+    }
+
+    QMutexLocker lk(&cacheMutex_);
+    auto it = cache_.find(idx);
+    if (it != cache_.end())
+        return it->second;
+    Decoded decoded = std::move(buf);
+    cache_.emplace(idx, decoded);
+    lru_.push_front(idx);
+    cachedBytes_ += decoded->size();
+    // Always keep at least the frame just decoded, even if it alone exceeds
+    // the budget.
+    while (cachedBytes_ > kCacheBytes && lru_.size() > 1) {
+        auto victim = cache_.find(lru_.back());
+        cachedBytes_ -= victim->second->size();
+        cache_.erase(victim);
+        lru_.pop_back();
+    }
+    return decoded;
+#else
+    return nullptr;
+#endif
+}
+
+bool ZstdSeekable::read(uint64_t offset, size_t length, void *dst)
+{
+    if (length == 0)
+        return true;
+    if (offset > totalSize_ || length > totalSize_ - offset)
+        return false;
+
+    char *out = static_cast<char*>(dst);
+    size_t idx = frameFor(offset);
+    while (length > 0) {
+        Decoded d = frame(idx);
+        if (!d)
+            return false;
+        const Frame &f = frames_[idx];
+        const size_t within = static_cast<size_t>(offset - f.dOffset);
+        const size_t n = std::min(length, static_cast<size_t>(f.dSize) - within);
+        memcpy(out, d->data() + within, n);
+        out += n;
+        offset += n;
+        length -= n;
+        idx++;
+    }
+    return true;
+}
+
+const char *ZstdSeekable::borrow(uint64_t offset, size_t length, std::shared_ptr<const void> &keepAlive)
+{
+    if (length == 0 || offset > totalSize_ || length > totalSize_ - offset)
+        return nullptr;
+    const size_t idx = frameFor(offset);
+    const Frame &f = frames_[idx];
+    if (offset + length > f.dOffset + f.dSize)
+        return nullptr;
+    Decoded d = frame(idx);
+    if (!d)
+        return nullptr;
+    const char *p = d->data() + (offset - f.dOffset);
+    keepAlive = std::move(d);
+    return p;
+}
@@ -0,0 +1,106 @@
+/*
+ *  Copyright (C) 2015, Mike Walters <mike@flomp.net>
+ *
+ *  This file is part of inspectrum.
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Random access into a multi-frame zstd stream without inflating it to disk.
+//
+// zstd frames are independently decodable, so once we know where each frame
+// starts (compressed offset) and how much it decodes to, any byte range of
+// the decompressed stream can be served by decoding just the frames that
+// cover it. The frame index comes from, in order of preference:
+//   1. the zstd "seekable format" seek table (a skippable frame at the end of
+//      the file, written by `zstd --seekable`/t2sz and friends) — O(1) open;
+//   2. a previously-built index cached under the app's cache dir;
+//   3. a one-off scan of the frame headers, whose result is then cached.
+// Decoded frames live in a byte-bounded LRU shared by all readers.
+//
+// A stream only qualifies when every frame records its content size and no
+// frame decodes to more than kMaxFrameBytes — a plain `zstd file` produces
+// one frame for the whole capture, which can't be randomly accessed, so
+// open() declines it and InputSource falls back to inflate-to-cache.
+//
+// read()/borrow() are thread-safe; decoding runs outside the cache lock so
+// tile workers touching different frames decode in parallel.
+class ZstdSeekable
+{
+public:
+    static constexpr size_t kMaxFrameBytes = 64u << 20;    // per-frame decode cap
+    static constexpr size_t kCacheBytes    = 256u << 20;   // decoded-frame LRU budget
+
+    // Open and index `path`. `indexCachePath` is where a scanned index is
+    // persisted (and looked up on the next open); empty disables that.
+    // Returns nullptr with *whyNot set if the stream isn't seekable (or this
+    // build has no zstd).
+    static std::shared_ptr<ZstdSeekable> open(const QString &path,
+                                              const QString &indexCachePath,
+                                              QString *whyNot = nullptr);
+    ~ZstdSeekable();
+
+    // Total decompressed size in bytes.
+    uint64_t size() const { return totalSize_; }
+    size_t frameCount() const { return frames_.size(); }
+
+    // Copy decompressed bytes [offset, offset+length) into dst. Returns false
+    // if the range runs past the end or a frame fails to decode.
+    bool read(uint64_t offset, size_t length, void *dst);
+
+    // Zero-copy variant: when [offset, offset+length) lies inside a single
+    // frame, return a pointer into the cached decoded frame and set
+    // keepAlive to the token that keeps it valid. nullptr otherwise (callers
+    // then use read()).
+    const char *borrow(uint64_t offset, size_t length, std::shared_ptr<const void> &keepAlive);
+
+private:
+    struct Frame {
+        uint64_t cOffset;   // compressed byte offset of the frame in the file
+        uint64_t cSize;     // compressed frame size (incl. header)
+        uint64_t dOffset;   // decompressed byte offset of the frame's content
+        uint64_t dSize;     // decompressed content size
+    };
+    using Decoded = std::shared_ptr<const std::vector<char>>;
+
+    ZstdSeekable() = default;
+    bool readSeekTable();
+    bool scanFrames(QString *whyNot);
+    bool loadIndex(const QString &path);
+    void saveIndex(const QString &path) const;
+    size_t frameFor(uint64_t offset) const;
+    Decoded frame(size_t idx);
+
+    QFile file_;
+    const uchar *data_ = nullptr;   // mmap of the compressed file
+    uint64_t fileSize_ = 0;
+    uint64_t totalSize_ = 0;
+    std::vector<Frame> frames_;
+
+    QMutex cacheMutex_;             // guards cache_/lru_/cachedBytes_
+    std::unordered_map<size_t, Decoded> cache_;
+    std::list<size_t> lru_;         // front = most-recently-used
+    size_t cachedBytes_ = 0;
+};
@@ -0,0 +1,179 @@
+// Micro-benchmark for the standard spectrogram tile FFT path.
+//
+// Computes one 65536-float tile (tileSize / N columns of N bins, columns
+// abutting as at zoom 1) three ways for each FFT size:
+//
+//   per-column  the old computeStandardTile loop: scalar window into a
+//               scratch buffer, FFT::process (copy in, execute, copy out)
+//               once per column
+//   batched     the current loop: the active sampleconvert window kernel
+//               straight into a batched FFT's input, one execute per tile
+//   r2c         the real-input variant of batched: real parts windowed into
+//               a batched RealFFT, positive half mirrored into the tile
+//
+// All three include the fftshift + log-power pass so the numbers are per-tile
+// compute, not just FFT time. The batched tile is checked against the
+// per-column result, and the r2c tile against a c2c tile of the same real
+// signal (max |dB difference|, which should be at float rounding level).
+//
+// Build:
+//   cmake --build build --target fft_batch_bench
+// Run:
+//   ./build/tools/fft_batch_bench [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "fft.h"
+#include "sampleconvert.h"
+
+namespace {
+
+const int kTileSize = 65536;   // SpectrogramPlot::tileSize
+
+double timeIt(const std::function<void()> &fn, int iters)
+{
+    fn(); // warm caches and page in the output buffer
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+        fn();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+void logPower(const std::complex<float> *spectrum, int N, float *lineDest)
+{
+    const float invFFTSize = 1.0f / N;
+    const float logMultiplier = 10.0f / log2f(10.0f);
+    for (int i = 0; i < N; i++) {
+        int k = i ^ (N >> 1);
+        auto s = spectrum[k] * invFFTSize;
+        float power = s.real() * s.real() + s.imag() * s.imag();
+        lineDest[i] = log2f(power) * logMultiplier;
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int iters = argc > 1 ? atoi(argv[1]) : 200;
+    if (iters <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    // Noise plus a tone, so no bin is exactly zero and the log stays finite.
+    std::vector<std::complex<float>> samples(kTileSize + 8192);
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+    for (size_t i = 0; i < samples.size(); i++)
+        samples[i] = std::polar(1.0f, 0.3f * i) + std::complex<float>(noise(rng), noise(rng));
+    std::vector<float> tileRef(kTileSize), tileOut(kTileSize);
+    // The same signal with the imaginary part dropped, as the Real* input
+    // adapters deliver it.
+    std::vector<std::complex<float>> realSamples(samples.size());
+    for (size_t i = 0; i < samples.size(); i++)
+        realSamples[i] = { samples[i].real(), 0.0f };
+    std::vector<float> tileRealRef(kTileSize), tileRealOut(kTileSize);
+
+    printf("tile=%d floats iterations=%d window=%s\n", kTileSize, iters,
+           sampleconvert::isaName(sampleconvert::active().isa));
+    printf("%6s %5s %12s %12s %8s %10s %12s %8s %10s\n",
+           "fft", "cols", "per-col us", "batched us", "speedup", "dB err",
+           "r2c us", "vs c2c", "dB err");
+
+    for (int N = 64; N <= 8192; N *= 2) {
+        const int cols = kTileSize / N;
+        std::vector<float> window(N);
+        for (int i = 0; i < N; i++)
+            window[i] = 0.5f * (1.0f - cosf(2.0f * M_PI * i / (N - 1)));
+
+        FFT single(N);
+        std::vector<std::complex<float>> buf(N), out(N);
+        auto perColumn = [&]() {
+            for (int c = 0; c < cols; c++) {
+                const std::complex<float> *in = samples.data() + static_cast<size_t>(c) * N;
+                for (int i = 0; i < N; i++)
+                    buf[i] = in[i] * window[i];
+                single.process(out.data(), buf.data());
+                logPower(out.data(), N, tileRef.data() + static_cast<size_t>(c) * N);
+            }
+        };
+
+        FFT batch(N, cols);
+        const auto &kernels = sampleconvert::active();
+        auto batched = [&]() {
+            auto *frames = reinterpret_cast<std::complex<float>*>(batch.input());
+            for (int c = 0; c < cols; c++)
+                kernels.window(samples.data() + static_cast<size_t>(c) * N, window.data(), N,
+                               frames + static_cast<size_t>(c) * N);
+            batch.execute();
+            const auto *spectra = reinterpret_cast<const std::complex<float>*>(batch.output());
+            for (int c = 0; c < cols; c++)
+                logPower(spectra + static_cast<size_t>(c) * N, N, tileOut.data() + static_cast<size_t>(c) * N);
+        };
+
+        RealFFT real(N, cols);
+        std::vector<float> half(N / 2 + 1);
+        auto realBatched = [&]() {
+            for (int c = 0; c < cols; c++)
+                kernels.windowReal(realSamples.data() + static_cast<size_t>(c) * N, window.data(), N,
+                                   real.input() + static_cast<size_t>(c) * N);
+            real.execute();
+            const int bins = real.getBins();
+            const auto *spectra = reinterpret_cast<const std::complex<float>*>(real.output());
+            for (int c = 0; c < cols; c++) {
+                const std::complex<float> *spectrum = spectra + static_cast<size_t>(c) * bins;
+                float *lineDest = tileRealOut.data() + static_cast<size_t>(c) * N;
+                const float invFFTSize = 1.0f / N;
+                const float logMultiplier = 10.0f / log2f(10.0f);
+                for (int k = 0; k < bins; k++) {
+                    auto s = spectrum[k] * invFFTSize;
+                    half[k] = log2f(s.real() * s.real() + s.imag() * s.imag()) * logMultiplier;
+                }
+                for (int k = 0; k < N / 2; k++)
+                    lineDest[N / 2 + k] = half[k];
+                for (int k = 1; k <= N / 2; k++)
+                    lineDest[N / 2 - k] = half[k];
+            }
+        };
+
+        perColumn();
+        batched();
+        float maxErr = 0.0f;
+        for (int i = 0; i < kTileSize; i++)
+            maxErr = std::max(maxErr, std::abs(tileRef[i] - tileOut[i]));
+
+        const double perColumnUs = timeIt(perColumn, iters) / iters * 1e6;
+        const double batchedUs = timeIt(batched, iters) / iters * 1e6;
+
+        // c2c reference for the real signal, then the r2c path against it.
+        auto *frames = reinterpret_cast<std::complex<float>*>(batch.input());
+        for (int c = 0; c < cols; c++)
+            kernels.window(realSamples.data() + static_cast<size_t>(c) * N, window.data(), N,
+                           frames + static_cast<size_t>(c) * N);
+        batch.execute();
+        for (int c = 0; c < cols; c++)
+            logPower(reinterpret_cast<const std::complex<float>*>(batch.output()) + static_cast<size_t>(c) * N,
+                     N, tileRealRef.data() + static_cast<size_t>(c) * N);
+        realBatched();
+        float realErr = 0.0f;
+        for (int i = 0; i < kTileSize; i++)
+            realErr = std::max(realErr, std::abs(tileRealRef[i] - tileRealOut[i]));
+        const double realUs = timeIt(realBatched, iters) / iters * 1e6;
+
+        printf("%6d %5d %12.1f %12.1f %7.2fx %10.2e %12.1f %7.2fx %10.2e\n",
+               N, cols, perColumnUs, batchedUs, perColumnUs / batchedUs, maxErr,
+               realUs, batchedUs / realUs, realErr);
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Micro-benchmark for the TunerTransform FIR backends.
+//
+// Filters a noise block with a Kaiser low-pass of each tap count two ways:
+//
+//   direct    firfilt_crcf push/execute per sample, the liquid dot product
+//             TunerTransform uses for short filters
+//   overlap   OverlapSaveFir, the FFT fast convolution it switches to at
+//             TunerTransform::fastFirTaps()
+//
+// Each run builds a fresh filter per block, as a random-access block fill
+// does, so plan creation and the tap transform are in the overlap-save
+// numbers. The overlap-save output is checked against direct form (max
+// |difference| relative to the output peak, which should be at float
+// rounding level). The last lines give the smallest tap count at which
+// overlap-save wins for each block size. TunerTransform measures the same
+// crossover for itself on first use; this shows the curve around it.
+//
+// Build:
+//   cmake --build build --target tuner_fir_bench
+// Run:
+//   ./build/tools/tuner_fir_bench [iterations]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include <liquid/liquid.h>
+
+#include "overlapsavefir.h"
+
+namespace {
+
+double timeIt(const std::function<void()> &fn, int iters)
+{
+    fn(); // warm caches and page in the output buffer
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++)
+        fn();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int iters = argc > 1 ? atoi(argv[1]) : 5;
+    if (iters <= 0) {
+        fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    const size_t blockSizes[] = { 4096, 65536, 1 << 20 };
+    const size_t maxBlock = 1 << 20;
+    std::vector<std::complex<float>> input(maxBlock);
+    std::mt19937 rng(1234);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+    for (auto &x : input)
+        x = { noise(rng), noise(rng) };
+    std::vector<std::complex<float>> direct(maxBlock), fast(maxBlock);
+
+    printf("iterations=%d\n", iters);
+    printf("%6s %8s %6s %12s %12s %8s %10s\n",
+           "taps", "block", "fft", "direct ns/S", "overlap ns/S", "speedup", "rel err");
+
+    std::vector<size_t> crossover(sizeof(blockSizes) / sizeof(blockSizes[0]), 0);
+    for (size_t taps = 16; taps <= 8192; taps *= 2) {
+        std::vector<float> h(taps);
+        liquid_firdes_kaiser(taps, 0.25f, 60.0f, 0.0f, h.data());
+
+        for (size_t b = 0; b < crossover.size(); b++) {
+            const size_t block = blockSizes[b];
+            auto runDirect = [&]() {
+                firfilt_crcf f = firfilt_crcf_create(h.data(), h.size());
+                for (size_t i = 0; i < block; i++) {
+                    firfilt_crcf_push(f, input[i]);
+                    firfilt_crcf_execute(f, &direct[i]);
+                }
+                firfilt_crcf_destroy(f);
+            };
+            auto runOverlap = [&]() {
+                OverlapSaveFir f(h);
+                f.execute(input.data(), fast.data(), block);
+            };
+
+            // Scale the iteration count so small blocks still time over a
+            // useful interval.
+            const int n = iters * static_cast<int>(maxBlock / block);
+            const double directNs = timeIt(runDirect, n) / n / block * 1e9;
+            const double overlapNs = timeIt(runOverlap, n) / n / block * 1e9;
+
+            float err = 0.0f, peak = 0.0f;
+            for (size_t i = 0; i < block; i++) {
+                err = std::max(err, std::abs(direct[i] - fast[i]));
+                peak = std::max(peak, std::abs(direct[i]));
+            }
+
+            printf("%6zu %8zu %6d %12.2f %12.2f %7.2fx %10.2e\n",
+                   taps, block, OverlapSaveFir::fftSizeFor(taps), directNs, overlapNs,
+                   directNs / overlapNs, err / peak);
+            if (!crossover[b] && overlapNs < directNs)
+                crossover[b] = taps;
+        }
+    }
+
+    for (size_t b = 0; b < crossover.size(); b++) {
+        if (crossover[b])
+            printf("block %zu: overlap-save faster from %zu taps\n", blockSizes[b], crossover[b]);
+        else
+            printf("block %zu: direct form faster at every tap count\n", blockSizes[b]);
+    }
+    return 0;
+}
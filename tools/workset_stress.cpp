@@ -0,0 +1,178 @@
+// Stress harness for the thread-local spectrogram work sets (fftworkset).
+//
+// Mimics SpectrogramPlot under heavy use: a pool of worker threads
+// computes "tiles" flat out, each through fftworkset::local() for whatever
+// key is current when it picks the tile up, while a controller thread keeps
+// retiring that key (new generation, random FFT size, real/complex input)
+// the way setFFTSize and wisdom updates do, and also plans and drops FFTs
+// of its own as the GUI thread does. Every tile goes the way
+// SpectrogramPlot::computeStandardTile takes it — a tone in each column,
+// Hann-windowed by the sampleconvert kernel into the set's batched c2c
+// plan, or its r2c plan for real input — and checks the tone's bin comes
+// out on top, so a set shared between threads, or built for the wrong
+// shape, shows up as a failure rather than just a crash.
+//
+// Registered with CTest (a short run); run it longer by hand after
+// touching fftworkset or the tile computes.
+//
+// Build:
+//   cmake --build build --target workset_stress
+// Run:
+//   ./build/tools/workset_stress [threads] [seconds]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "fft.h"
+#include "fftworkset.h"
+#include "sampleconvert.h"
+
+namespace {
+
+const int kTileSize = 65536;   // SpectrogramPlot::tileSize
+
+// Current key, packed so workers can read it in one load:
+// generation << 8 | log2(size) << 1 | realInput.
+std::atomic<uint64_t> currentKey{0};
+std::atomic<bool> stop{false};
+std::atomic<long> tiles{0};
+std::atomic<long> failures{0};
+
+fftworkset::Key unpack(uint64_t packed)
+{
+    fftworkset::Key key;
+    key.generation = packed >> 8;
+    key.size = 1 << ((packed >> 1) & 0x7f);
+    key.cols = kTileSize / key.size;
+    key.realInput = packed & 1;
+    return key;
+}
+
+uint64_t pack(uint64_t generation, int log2Size, bool realInput)
+{
+    return generation << 8 | static_cast<uint64_t>(log2Size) << 1 | (realInput ? 1 : 0);
+}
+
+// Index of the strongest of `count` bins.
+int peakBin(const std::complex<float> *bins, int count)
+{
+    auto peak = std::max_element(bins, bins + count, [](const std::complex<float> &a, const std::complex<float> &b) {
+        return std::norm(a) < std::norm(b);
+    });
+    return static_cast<int>(peak - bins);
+}
+
+// One tile through `set`, as computeStandardTile does it: a tone at a
+// different bin in each column, windowed into the batched plan (r2c for
+// real input), whose bin must be the strongest of that column's spectrum.
+bool runTile(FftWorkSet &set, const fftworkset::Key &key, std::mt19937 &rng)
+{
+    if (set.size != key.size || !set.fftTile || set.fftTile->getBatch() != key.cols ||
+        (key.realInput && !set.fftTileReal) || (!key.realInput && set.fftTileReal))
+        return false;
+    const int N = key.size;
+    const auto &kernels = sampleconvert::active();
+    std::vector<float> window(N);
+    for (int n = 0; n < N; n++)
+        window[n] = 0.5f * (1.0f - cosf(static_cast<float>(2 * M_PI * n / (N - 1))));
+    // Two bins clear of DC and Nyquist: the Hann window spreads a tone over
+    // its neighbours, and a real tone next to DC ties with its mirror there.
+    std::uniform_int_distribution<int> pick(2, N / 2 - 2);
+    std::vector<int> bins(key.cols);
+    for (auto &b : bins)
+        b = pick(rng);
+
+    std::vector<std::complex<float>> samples(N);
+    for (int c = 0; c < key.cols; c++) {
+        for (int n = 0; n < N; n++)
+            samples[n] = std::polar(1.0f, static_cast<float>(2 * M_PI * bins[c] * n / N));
+        if (key.realInput)
+            kernels.windowReal(samples.data(), window.data(), N,
+                               set.fftTileReal->input() + static_cast<size_t>(c) * N);
+        else
+            kernels.window(samples.data(), window.data(), N,
+                           reinterpret_cast<std::complex<float>*>(set.fftTile->input()) + static_cast<size_t>(c) * N);
+    }
+
+    if (key.realInput) {
+        RealFFT &real = *set.fftTileReal;
+        real.execute();
+        const int count = real.getBins();
+        const auto *half = reinterpret_cast<const std::complex<float>*>(real.output());
+        for (int c = 0; c < key.cols; c++) {
+            if (peakBin(half + static_cast<size_t>(c) * count, count) != bins[c])
+                return false;
+        }
+        return true;
+    }
+
+    set.fftTile->execute();
+    const auto *spectra = reinterpret_cast<const std::complex<float>*>(set.fftTile->output());
+    for (int c = 0; c < key.cols; c++) {
+        if (peakBin(spectra + static_cast<size_t>(c) * N, N) != bins[c])
+            return false;
+    }
+    return true;
+}
+
+void worker(unsigned seed)
+{
+    std::mt19937 rng(seed);
+    while (!stop.load(std::memory_order_relaxed)) {
+        const fftworkset::Key key = unpack(currentKey.load(std::memory_order_acquire));
+        if (!runTile(fftworkset::local(key), key, rng))
+            failures.fetch_add(1, std::memory_order_relaxed);
+        tiles.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int threads = argc > 1 ? atoi(argv[1]) : static_cast<int>(std::max(2u, std::thread::hardware_concurrency() * 2));
+    const double seconds = argc > 2 ? atof(argv[2]) : 10.0;
+    if (threads <= 0 || seconds <= 0) {
+        fprintf(stderr, "usage: %s [threads] [seconds]\n", argv[0]);
+        return 1;
+    }
+
+    // The app plans FFTW_ESTIMATE on a wisdom miss; measuring every shape
+    // would make the churn below mostly planner time.
+    fftplan::setLevel(FFTPlanLevel::Estimate);
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pickSize(4, 16);   // 16 .. 65536, the FFT size slider's range
+    std::bernoulli_distribution pickReal(0.3);
+    currentKey.store(pack(fftworkset::newGeneration(), pickSize(rng), pickReal(rng)));
+
+    std::vector<std::thread> pool;
+    for (int i = 0; i < threads; i++)
+        pool.emplace_back(worker, 1000u + i);
+
+    long changes = 0;
+    const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        const int log2Size = pickSize(rng);
+        currentKey.store(pack(fftworkset::newGeneration(), log2Size, pickReal(rng)), std::memory_order_release);
+        changes++;
+        // Planning on this thread too, against the workers' plans.
+        FFT gui(1 << log2Size);
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    stop = true;
+    for (auto &t : pool)
+        t.join();
+
+    printf("threads=%d seconds=%.1f key changes=%ld tiles=%ld failures=%ld\n",
+           threads, seconds, changes, tiles.load(), failures.load());
+    return failures.load() == 0 ? 0 : 1;
+}